@@ -0,0 +1,149 @@
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/parallel/omp/omp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "AsyncOutputWriter.h"
+#include "DistributedFields.h"
+#include "../util/FieldFiles.h"
+#include "../util/ThreadLayout.h"
+
+namespace pifo {
+    namespace app  {
+        AsyncOutputWriter::AsyncOutputWriter(const atlas::RegularGrid& pGrid, 
+            const atlas::functionspace::StructuredColumns& pFunctionSpace, size_t pMaxBytes, bool pFloat32,
+            const ChunkedFieldEncoding& pEncoding, const std::vector<int>& pCpus)
+            : grid(pGrid), functionSpace(pFunctionSpace), maxBytes(pMaxBytes), float32(pFloat32), encoding(pEncoding),
+            cpus(pCpus), root(atlas::mpi::comm().rank()==0)
+        {
+            if (root)
+            {
+                writer = std::thread(&AsyncOutputWriter::writeJobs, this);
+            }
+        }
+
+        AsyncOutputWriter::~AsyncOutputWriter()
+        {
+            if (root)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                changed.notify_all();
+                writer.join();
+            }
+        }
+
+        void AsyncOutputWriter::write(const std::string& file, const atlas::Field& field, double time)
+        {
+            size_t bytes = (size_t)grid.size()*sizeof(double);
+            if (root)
+            {
+                // the memory for the gathered field, before the gather
+                auto start = std::chrono::steady_clock::now();
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return !error.empty() || pendingBytes==0 || pendingBytes+bytes<=maxBytes; });
+                throwError();
+                pendingBytes += bytes;
+                peakBytes = std::max(peakBytes, pendingBytes);
+                stallTime += std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+            }
+
+            atlas::Field global = gatherDistributedField(functionSpace, field);
+
+            if (root)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    jobs.push_back(Job{ file, global, time, bytes });
+                }
+                changed.notify_all();
+            }
+        }
+
+        void AsyncOutputWriter::flush()
+        {
+            if (root)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return !error.empty() || pendingBytes==0; });
+                throwError();
+            }
+        }
+
+        void AsyncOutputWriter::throwError()
+        {
+            if (!error.empty())
+            {
+                std::string message = error;
+                error.clear();
+                throw std::runtime_error("writing the outputs failed : "+message);
+            }
+        }
+
+        void AsyncOutputWriter::writeJobs()
+        {
+            // a single thread encodes, not to take the cores of the model
+            // (the chunks take encoding.threads). The thread inherited the
+            // cpu of the pinned master thread, its encoding threads inherit
+            // the cpus set here.
+            atlas_omp_set_num_threads(1);
+            bool pinned = ThreadLayout::pinThread(cpus);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!pinned)
+            {
+                error = "could not pin the writer thread";
+            }
+            while (true)
+            {
+                changed.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                {
+                    return;
+                }
+                Job job = jobs.front();
+                jobs.pop_front();
+                lock.unlock();
+                std::string failure;
+                size_t stored = 0, raw = 0;
+                try
+                {
+                    if (FieldFiles::isChunked(job.file))
+                    {
+                        auto& store = stores[job.file];
+                        if (!store)
+                        {
+                            store.reset(new ChunkedFieldWriter(job.file, grid, encoding));
+                        }
+                        size_t size = store->size();
+                        store->write(job.global, job.time);
+                        stored = store->size()-size;
+                        raw = (size_t)grid.size()*sizeof(double);
+                    }
+                    else
+                    {
+                        FieldFiles::writeField(job.file, grid, job.global, job.time, float32);
+                    }
+                }
+                catch (const std::exception& ex)
+                {
+                    failure = ex.what();
+                }
+                // the memory of the field is released before the others wait
+                job.global = atlas::Field();
+                lock.lock();
+                if (!failure.empty() && error.empty())
+                {
+                    error = failure;
+                }
+                pendingBytes -= job.bytes;
+                chunkedBytes += stored;
+                chunkedRawBytes += raw;
+                changed.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atlas/grid.h"
+#include "atlas/field.h"
+#include "atlas/functionspace/StructuredColumns.h"
+
+#include "../util/ChunkedFieldStore.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Writes the fields of the model in a background thread, so that the
+         * time loop only waits for their gather on the first task and not
+         * for their encoding and writing.
+         *
+         * <p>write() gathers the field (a collective operation, called by
+         * all the tasks in the same order) into a new global field, which
+         * the writer thread of the first task encodes with FieldFiles and
+         * writes. The gathered fields waiting to be written take at most
+         * maxBytes : beyond, write() waits for the writer (a single field
+         * larger than the bound is written alone). An error of the writer
+         * is thrown by the next write() or flush().</p>
+         *
+         * <p>The fields written to a file of ChunkedFieldStore are appended
+         * to it, with the encoding given : the first write of a file in the
+         * run creates it, the next ones add their time.</p>
+         *
+         * <p>The writer thread and the threads encoding the chunks run on
+         * the cpus given (see ThreadLayout::getSpareCpus), or on those of
+         * the thread that creates the writer if none.</p>
+         */
+        class AsyncOutputWriter {
+        public:
+            AsyncOutputWriter(const atlas::RegularGrid& grid, const atlas::functionspace::StructuredColumns& functionSpace,
+                size_t maxBytes, bool float32 = false, const ChunkedFieldEncoding& encoding = ChunkedFieldEncoding(),
+                const std::vector<int>& cpus = std::vector<int>());
+
+            /**
+             * Waits for the fields not yet written.
+             */
+            ~AsyncOutputWriter();
+
+            AsyncOutputWriter(const AsyncOutputWriter&) = delete;
+            AsyncOutputWriter& operator=(const AsyncOutputWriter&) = delete;
+
+            /**
+             * Queue a field of type double or float, with the model time.
+             */
+            void write(const std::string& file, const atlas::Field& field, double time);
+
+            /**
+             * Wait until the queued fields are written.
+             */
+            void flush();
+
+            /**
+             * Seconds write() waited for the memory of the buffers.
+             */
+            double getStallTime() const
+            {
+                return stallTime;
+            }
+
+            /**
+             * Largest memory taken by the fields waiting to be written.
+             */
+            size_t getPeakBytes() const
+            {
+                return peakBytes;
+            }
+
+            /**
+             * Bytes of the chunked files, and of their values as doubles.
+             */
+            size_t getChunkedBytes() const
+            {
+                return chunkedBytes;
+            }
+
+            size_t getChunkedRawBytes() const
+            {
+                return chunkedRawBytes;
+            }
+
+        private:
+            struct Job {
+                std::string file;
+                atlas::Field global;
+                double time;
+                size_t bytes;
+            };
+
+            void writeJobs();
+            void throwError();
+
+            const atlas::RegularGrid& grid;
+            const atlas::functionspace::StructuredColumns& functionSpace;
+            size_t maxBytes;
+            bool float32;
+            ChunkedFieldEncoding encoding;
+            std::vector<int> cpus;
+            bool root;
+            // the chunked files, used by the writer thread only
+            std::map<std::string, std::unique_ptr<ChunkedFieldWriter>> stores;
+
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::deque<Job> jobs;
+            // the queued fields and the one being written
+            size_t pendingBytes = 0;
+            size_t peakBytes = 0;
+            size_t chunkedBytes = 0;
+            size_t chunkedRawBytes = 0;
+            double stallTime = 0;
+            bool stopping = false;
+            // message of the first error of the writer not yet thrown
+            std::string error;
+            std::thread writer;
+        };
+    }
+}
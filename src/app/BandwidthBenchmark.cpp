@@ -0,0 +1,110 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/runtime/Trace.h"
+#include "atlas/parallel/omp/omp.h"
+#include "eckit/filesystem/PathName.h"
+
+#include <memory>
+#include <set>
+#include <algorithm>
+#include <iomanip>
+
+#include "../util/ThreadLayout.h"
+
+#include "BandwidthBenchmark.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Best bandwidth of the triad in GB/s, the arrays being first written
+         * in parallel (with the static schedule of the triad) or serially.
+         */
+        static double triad(long size, bool parallelInit, int repeat)
+        {
+            // new without initializer doesn't touch the pages
+            std::unique_ptr<double[]> a(new double[size]);
+            std::unique_ptr<double[]> b(new double[size]);
+            std::unique_ptr<double[]> c(new double[size]);
+            if (parallelInit)
+            {
+                #pragma omp parallel for schedule(static)
+                for (long i=0;i<size;i++)
+                {
+                    a[i] = 0.0;
+                    b[i] = 1.0;
+                    c[i] = 2.0;
+                }
+            }
+            else
+            {
+                for (long i=0;i<size;i++)
+                {
+                    a[i] = 0.0;
+                    b[i] = 1.0;
+                    c[i] = 2.0;
+                }
+            }
+
+            double best = 0;
+            for (int r=0;r<repeat;r++)
+            {
+                atlas::Trace timer( Here(), "bandwidth benchmark" );
+                timer.start();
+                #pragma omp parallel for schedule(static)
+                for (long i=0;i<size;i++)
+                {
+                    a[i] = b[i] + 3.0*c[i];
+                }
+                timer.stop();
+                best = std::max(best, 3.0*size*sizeof(double)/timer.elapsed()*1e-9);
+            }
+            return best;
+        }
+
+        void BandwidthBenchmark::run()
+        {
+            atlas::util::Config config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+            // 3 arrays of 128 MB by default
+            long size = config.getLong("bandwidth_points", 1L<<24);
+            const int repeat = 10;
+            ThreadLayout full(config);
+
+            atlas::Log::info() << "triad bandwidth on 3x" << size*sizeof(double)/(1<<20) << " MB, " 
+                << full.describe() << std::endl;
+            atlas::Log::info() << std::setw(8) << "threads" << std::setw(9) << "sockets" 
+                << std::setw(14) << "serial GB/s" << std::setw(19) << "first-touch GB/s" << std::endl;
+
+            for (int threads=1;;threads=std::min(2*threads, full.getThreads()))
+            {
+                atlas::util::Config layoutConfig(config);
+                layoutConfig.set("threads", threads);
+                ThreadLayout layout(layoutConfig);
+                layout.apply();
+                std::set<int> sockets(layout.getSockets().begin(), layout.getSockets().end());
+
+                double serial = triad(size, false, repeat);
+                double firstTouch = triad(size, true, repeat);
+                atlas::Log::info() << std::setw(8) << threads << std::setw(9);
+                if (sockets.empty())
+                {
+                    atlas::Log::info() << "-";
+                }
+                else
+                {
+                    atlas::Log::info() << sockets.size();
+                }
+                atlas::Log::info() << std::setw(14) << std::fixed << std::setprecision(2) << serial
+                    << std::setw(19) << firstTouch << std::endl;
+                if (threads==full.getThreads())
+                {
+                    break;
+                }
+            }
+            full.apply();
+        }
+    }
+}
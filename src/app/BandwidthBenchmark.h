@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Measures the memory bandwidth of a triad a = b + s c on arrays much
+         * larger than the caches, for an increasing number of threads placed
+         * by the ThreadLayout of model.yml. The arrays are either first 
+         * written by the master thread, all their pages then being on its 
+         * socket, or by the threads that use them, as the fields of ModelT :
+         * only the latter scales across the sockets.
+         */
+        class BandwidthBenchmark : public Application {
+        public:
+            BandwidthBenchmark() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
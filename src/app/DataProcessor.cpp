@@ -19,9 +19,11 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <vector>
 
 #include "../util/GribFile.h"
 #include "../util/WGribFormat.h"
+#include "../util/BinaryFieldFormat.h"
 #include "../util/Regridding.h"
 
 #include "DataProcessor.h"
@@ -135,9 +137,12 @@ namespace pifo {
             latlon_fields.add(*latlon_u);
             latlon_fields.add(*latlon_v);
 
-            double* latlon_data = new double[latlon_grid.size()];
-            double* latlon_lats = new double[latlon_grid.size()];
-            double* latlon_lons = new double[latlon_grid.size()];
+            std::vector<double> latlon_data_buffer(latlon_grid.size());
+            std::vector<double> latlon_lats_buffer(latlon_grid.size());
+            std::vector<double> latlon_lons_buffer(latlon_grid.size());
+            double* latlon_data = latlon_data_buffer.data();
+            double* latlon_lats = latlon_lats_buffer.data();
+            double* latlon_lons = latlon_lons_buffer.data();
 
             auto latlon_pressure = atlas::array::make_view<double, 1>(*latlon_prmsl);
             idx_t nb_lats = 0;
@@ -177,9 +182,12 @@ namespace pifo {
             mercator_fields.add(*mercator_v);
             mercator_fields.add(*mercator_phi);
 
-            double* mercator_data = new double[mercator_grid.size()];
-            double* mercator_lats = new double[mercator_grid.size()];
-            double* mercator_lons = new double[mercator_grid.size()];
+            std::vector<double> mercator_data_buffer(mercator_grid.size());
+            std::vector<double> mercator_lats_buffer(mercator_grid.size());
+            std::vector<double> mercator_lons_buffer(mercator_grid.size());
+            double* mercator_data = mercator_data_buffer.data();
+            double* mercator_lats = mercator_lats_buffer.data();
+            double* mercator_lons = mercator_lons_buffer.data();
             k=0;
             for (idx_t j=0;j<mercator_grid.ny();j++)
             {
@@ -197,11 +205,11 @@ namespace pifo {
 
                 atlas::Log::info () << "calculating m" << std::endl ;
                 calcScalingFactor(mercator_grid, *mercator_m);
-                WGribFormat::writeField("m.txt", mercator_grid, *mercator_m);
+                BinaryFieldFormat::writeField("m.fld", mercator_grid, *mercator_m);
 
                 atlas::Log::info () << "calculating f" << std::endl ;
                 calcCoriolisFactor(mercator_grid, *mercator_f);
-                WGribFormat::writeField("f.txt", mercator_grid, *mercator_f);
+                BinaryFieldFormat::writeField("f.fld", mercator_grid, *mercator_f);
 
                 atlas::Log::info () << "loading prmsl" << std::endl ;
                 grb.getData("prmsl", "meanSea", 0, latlon_data);
@@ -209,7 +217,7 @@ namespace pifo {
                 Log :: info () << "interpolating prmsl" << std::endl ;
                 Regridding::bilinearRegrid(latlon_lons, nb_lons, latlon_lats, nb_lats, latlon_data, latlon_grid.size(), true, mercator_lons, mercator_lats, mercator_data, mercator_grid.size());
                 dataToField(mercator_data, mercator_grid, *mercator_prmsl);
-                WGribFormat::writeField("prmsl.txt", mercator_grid, *mercator_prmsl);
+                BinaryFieldFormat::writeField("prmsl.fld", mercator_grid, *mercator_prmsl);
 
                 atlas::Log::info () << "loading z500" << std::endl ;
                 grb.getData("gh", "isobaricInhPa", 500, latlon_data);
@@ -219,7 +227,7 @@ namespace pifo {
                 dataToField(mercator_data, mercator_grid, *mercator_phi);
                 multiplyConst(mercator_grid, *mercator_phi, 9.8066);
                 addConst(mercator_grid, *mercator_phi, -40000);
-                WGribFormat::writeField("phi.txt", mercator_grid, *mercator_phi);
+                BinaryFieldFormat::writeField("phi.fld", mercator_grid, *mercator_phi);
                
                 atlas::Log::info () << "loading u500" << std::endl ;
                 grb.getData("u", "isobaricInhPa", 500, latlon_data);
@@ -228,7 +236,7 @@ namespace pifo {
                 Regridding::bilinearRegrid(latlon_lons, nb_lons, latlon_lats, nb_lats, latlon_data, latlon_grid.size(), true, mercator_lons, mercator_lats, mercator_data, mercator_grid.size());
                 dataToField(mercator_data, mercator_grid, *mercator_u);
                 scaleField(mercator_grid, *mercator_u, *mercator_m);
-                WGribFormat::writeField("U.txt", mercator_grid, *mercator_u);
+                BinaryFieldFormat::writeField("U.fld", mercator_grid, *mercator_u);
 
                 atlas::Log::info () << "loading v500" << std::endl ;
                 grb.getData("v", "isobaricInhPa", 500, latlon_data);
@@ -237,7 +245,7 @@ namespace pifo {
                 Regridding::bilinearRegrid(latlon_lons, nb_lons, latlon_lats, nb_lats, latlon_data, latlon_grid.size(), true, mercator_lons, mercator_lats, mercator_data, mercator_grid.size());
                 dataToField(mercator_data, mercator_grid, *mercator_v);
                 scaleField(mercator_grid, *mercator_v, *mercator_m);
-                WGribFormat::writeField("V.txt", mercator_grid, *mercator_v);
+                BinaryFieldFormat::writeField("V.fld", mercator_grid, *mercator_v);
 
                 WGribFormat::writeLonLat("lons.txt", "lats.txt", mercator_grid);
             }
@@ -247,14 +255,6 @@ namespace pifo {
             }
 
             atlas::Log::info() << std::endl;
-
-            delete latlon_data;
-            delete latlon_lats;
-            delete latlon_lons;
-
-            delete mercator_data;
-            delete mercator_lats;
-            delete mercator_lons;            
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "atlas/array/DataType.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/option.h"
+
+#include "../util/FieldFiles.h"
+
+#include "DistributedFields.h"
+
+namespace pifo {
+    namespace app  {
+        static void copyToFloat(const atlas::Field& from, atlas::Field& to)
+        {
+            auto x = (const double*)from.storage();
+            auto y = (float*)to.storage();
+            for (atlas::idx_t i=0;i<from.size();i++)
+            {
+                y[i] = (float)x[i];
+            }
+        }
+
+        static void copyToDouble(const atlas::Field& from, atlas::Field& to)
+        {
+            auto x = (const float*)from.storage();
+            auto y = (double*)to.storage();
+            for (atlas::idx_t i=0;i<from.size();i++)
+            {
+                y[i] = x[i];
+            }
+        }
+
+        void readDistributedField(const std::string& file, const atlas::RegularGrid& grid,
+            const atlas::functionspace::StructuredColumns& functionSpace, atlas::Field& field)
+        {
+            atlas::Field global = functionSpace.createField<double>(atlas::option::name(field.name()) | atlas::option::global());
+            if (atlas::mpi::comm().rank()==0)
+            {
+                FieldFiles::readField(file, grid, global);
+            }
+            if (field.datatype()==atlas::array::make_datatype<float>())
+            {
+                atlas::Field globalFloat = functionSpace.createField<float>(atlas::option::name(field.name()) | atlas::option::global());
+                if (atlas::mpi::comm().rank()==0)
+                {
+                    copyToFloat(global, globalFloat);
+                }
+                global = globalFloat;
+            }
+            functionSpace.scatter(global, field);
+            field.set_dirty();
+            functionSpace.haloExchange(field);
+        }
+
+        atlas::Field gatherDistributedField(const atlas::functionspace::StructuredColumns& functionSpace,
+            const atlas::Field& field)
+        {
+            atlas::Field global = functionSpace.createField<double>(atlas::option::name(field.name()) | atlas::option::global());
+            if (field.datatype()==atlas::array::make_datatype<float>())
+            {
+                atlas::Field globalFloat = functionSpace.createField<float>(atlas::option::name(field.name()) | atlas::option::global());
+                functionSpace.gather(field, globalFloat);
+                if (atlas::mpi::comm().rank()==0)
+                {
+                    copyToDouble(globalFloat, global);
+                }
+            }
+            else
+            {
+                functionSpace.gather(field, global);
+            }
+            return global;
+        }
+
+        void writeDistributedField(const std::string& file, const atlas::RegularGrid& grid,
+            const atlas::functionspace::StructuredColumns& functionSpace, const atlas::Field& field,
+            double time, bool float32)
+        {
+            atlas::Field global = gatherDistributedField(functionSpace, field);
+            if (atlas::mpi::comm().rank()==0)
+            {
+                FieldFiles::writeField(file, grid, global, time, float32);
+            }
+        }
+    }
+}
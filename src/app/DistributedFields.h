@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+#include "atlas/grid.h"
+#include "atlas/field.h"
+#include "atlas/runtime/Log.h"
+#include "atlas/functionspace/StructuredColumns.h"
+
+#include "../model/Model.h"
+#include "../util/FieldFiles.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Read a field on the first task and scatter it on the partitions,
+         * halo included. The field may be of type double or float. The
+         * format of the file is given by its extension (see FieldFiles).
+         */
+        void readDistributedField(const std::string& file, const atlas::RegularGrid& grid,
+            const atlas::functionspace::StructuredColumns& functionSpace, atlas::Field& field);
+
+        /**
+         * Gather a field of type double or float into a new global field of
+         * type double, whose values are on the first task.
+         */
+        atlas::Field gatherDistributedField(const atlas::functionspace::StructuredColumns& functionSpace,
+            const atlas::Field& field);
+
+        /**
+         * Gather a field of type double or float on the first task and write it,
+         * with the model time and as float if float32 in the binary format.
+         */
+        void writeDistributedField(const std::string& file, const atlas::RegularGrid& grid,
+            const atlas::functionspace::StructuredColumns& functionSpace, const atlas::Field& field,
+            double time = 0, bool float32 = false);
+
+        /**
+         * Read the pronostic and parameter fields of a model from the files
+         * <name>.fld, mapped in memory, or <name>.txt if there is no binary
+         * file (see the convert application).
+         */
+        template <typename Precision>
+        void readModelFields(ModelT<Precision>& model, const atlas::RegularGrid& grid)
+        {
+            for (auto fieldSet : { &model.pronosticFieldSet(), &model.parameterFieldSet() })
+            {
+                auto fields = fieldSet->field_names();
+                for (long unsigned int i=0;i<fields.size();i++)
+                {
+                    std::string file = FieldFiles::find(fields[i]);
+                    atlas::Log::info () << "loading " << file << std::endl ;
+                    readDistributedField(file, grid, model.getFunctionSpace(), fieldSet->field(fields[i]));
+                }
+            }
+        }
+    }
+}
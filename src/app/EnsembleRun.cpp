@@ -0,0 +1,166 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/field.h"
+#include "atlas/runtime/Trace.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/option.h"
+#include "eckit/filesystem/PathName.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+
+#include "../util/BinaryFieldFormat.h"
+#include "../util/FieldFiles.h"
+
+#include "EnsembleRun.h"
+#include "DistributedFields.h"
+#include "../model/Model.h"
+
+namespace pifo {
+    namespace app  {
+        static std::string memberName(int member)
+        {
+            char name[16];
+            std::snprintf(name, sizeof(name), "%03d", member);
+            return name;
+        }
+
+        /**
+         * Scatter a global field of the first task in a member of an ensemble field.
+         */
+        static void scatterMember(const atlas::functionspace::StructuredColumns& functionSpace,
+            const atlas::Field& global, atlas::Field& field, int member, int members)
+        {
+            atlas::Field local = functionSpace.createField<double>(atlas::option::name(field.name()));
+            functionSpace.scatter(global, local);
+            auto x = (const double*)local.storage();
+            auto y = (double*)field.storage();
+            for (atlas::idx_t i=0;i<local.size();i++)
+            {
+                y[i*members+member] = x[i];
+            }
+        }
+
+        /**
+         * Gather a member of an ensemble field in a global field of the first task.
+         */
+        static void gatherMember(const atlas::functionspace::StructuredColumns& functionSpace,
+            const atlas::Field& field, atlas::Field& global, int member, int members)
+        {
+            atlas::Field local = functionSpace.createField<double>(atlas::option::name(field.name()));
+            auto x = (const double*)field.storage();
+            auto y = (double*)local.storage();
+            for (atlas::idx_t i=0;i<local.size();i++)
+            {
+                y[i] = x[i*members+member];
+            }
+            functionSpace.gather(local, global);
+        }
+
+        void EnsembleRun::run()
+        {
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+
+            atlas::util::Config model_config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                atlas::Log::info () << "loading model configuration" << std::endl ;
+                model_config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+            if (!model_config.has("members"))
+            {
+                model_config.set("members", 20);
+            }
+            double amplitude = model_config.getDouble("perturbation", 10.0);
+
+            Model model(mercator_grid, model_config);
+            model.setStopTime(3*3600);
+            int members = model.getMembers();
+            const auto& functionSpace = model.getFunctionSpace();
+            bool root = atlas::mpi::comm().rank()==0;
+
+            // the parameters are shared by all the members
+            auto fields = model.parameterFieldSet().field_names();
+            for (long unsigned int i=0;i<fields.size();i++)
+            {
+                std::string file = FieldFiles::find(fields[i]);
+                atlas::Log::info () << "loading " << file << std::endl ;
+                readDistributedField(file, mercator_grid, functionSpace, model.parameterFieldSet().field(fields[i]));
+            }
+
+            auto& pronostics = model.pronosticFieldSet();
+            for (atlas::idx_t v=0;v<pronostics.size();v++)
+            {
+                auto& field = pronostics.field(v);
+                std::string name = field.name();
+                atlas::Field control = functionSpace.createField<double>(atlas::option::name(name) | atlas::option::global());
+                atlas::Field global = functionSpace.createField<double>(atlas::option::name(name) | atlas::option::global());
+                bool controlLoaded = false;
+                for (int member=0;member<members;member++)
+                {
+                    std::string memberFile = FieldFiles::find("member"+memberName(member)+"/"+name);
+                    if (root && eckit::PathName(memberFile).exists())
+                    {
+                        atlas::Log::info () << "loading " << memberFile << std::endl ;
+                        FieldFiles::readField(memberFile, mercator_grid, global);
+                    }
+                    else if (root)
+                    {
+                        if (!controlLoaded)
+                        {
+                            std::string controlFile = FieldFiles::find(name);
+                            atlas::Log::info () << "loading " << controlFile << std::endl ;
+                            FieldFiles::readField(controlFile, mercator_grid, control);
+                            controlLoaded = true;
+                        }
+                        auto x = (const double*)control.storage();
+                        auto y = (double*)global.storage();
+                        std::mt19937 generator(member);
+                        std::uniform_real_distribution<double> noise(-amplitude, amplitude);
+                        bool perturbed = name=="phi" && member>0;
+                        for (atlas::idx_t i=0;i<global.size();i++)
+                        {
+                            y[i] = perturbed ? x[i]+noise(generator) : x[i];
+                        }
+                    }
+                    scatterMember(functionSpace, global, field, member, members);
+                }
+                field.set_dirty();
+                functionSpace.haloExchange(field);
+            }
+
+            atlas::Trace timer( Here(), "ensemble" );
+            timer.start();
+            while (model.getTime()<3*3600)
+            {
+                int remainingSteps = (int)std::ceil((3*3600-model.getTime())/model.getDt());
+                model.advance(std::min(remainingSteps, model.getBlockSteps()));
+            }
+            timer.stop();
+            long steps = model.getSteps();
+            atlas::Log::info () << "ensemble of " << members << " members, " << steps << " steps in "
+                << timer.elapsed() << "s : " << members*steps/timer.elapsed() << " member-steps/s" << std::endl ;
+
+            for (atlas::idx_t v=0;v<pronostics.size();v++)
+            {
+                auto& field = pronostics.field(v);
+                atlas::Field global = functionSpace.createField<double>(atlas::option::name(field.name()) | atlas::option::global());
+                for (int member=0;member<members;member++)
+                {
+                    gatherMember(functionSpace, field, global, member, members);
+                    if (root)
+                    {
+                        std::string file = field.name()+"_001_"+memberName(member)+BinaryFieldFormat::extension();
+                        atlas::Log::info () << "writing " << file << std::endl ;
+                        FieldFiles::writeField(file, mercator_grid, global, model.getTime());
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Runs an ensemble of forecasts in a single Model, the members being
+         * the innermost dimension of the fields.
+         * 
+         * <p>The number of members is the members key of model.yml (default
+         * 20). The initial state of the member k is read from the directory 
+         * memberkkk if it exists, else it is the control state U, V, phi 
+         * with phi perturbed by a random noise of amplitude given by 
+         * the perturbation key (default 10 m2/s2, none for the member 0). The 
+         * parameters are read once for all the members. The fields are read
+         * from the binary files U.fld etc., or the text files U.txt etc. if
+         * there is no binary file. The forecasts are written to 
+         * U_001_kkk.fld etc., and the throughput is reported in 
+         * member-steps per second.</p>
+         */
+        class EnsembleRun : public Application {
+        public:
+            EnsembleRun() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
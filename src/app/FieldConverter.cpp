@@ -0,0 +1,100 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/field.h"
+#include "atlas/array.h"
+#include "atlas/parallel/mpi/mpi.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "FieldConverter.h"
+#include "../util/BinaryFieldFormat.h"
+#include "../util/FieldFiles.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Names of the files of the directory with the extension, without it.
+         */
+        static std::vector<std::string> filesWithExtension(const std::string& directory, const std::string& extension)
+        {
+            std::vector<std::string> names;
+            DIR* dir = opendir(directory.c_str());
+            if (dir==nullptr)
+            {
+                throw std::runtime_error("could not list "+directory);
+            }
+            while (dirent* entry = readdir(dir))
+            {
+                std::string file = entry->d_name;
+                if (file.size()>extension.size() && file.compare(file.size()-extension.size(), extension.size(), extension)==0)
+                {
+                    names.push_back(file.substr(0, file.size()-extension.size()));
+                }
+            }
+            closedir(dir);
+            std::sort(names.begin(), names.end());
+            return names;
+        }
+
+        // true if to does not exist or is older than from
+        static bool outdated(const std::string& from, const std::string& to)
+        {
+            struct stat fromStatus, toStatus;
+            if (stat(to.c_str(), &toStatus)!=0)
+            {
+                return true;
+            }
+            return stat(from.c_str(), &fromStatus)==0 && fromStatus.st_mtime>toStatus.st_mtime;
+        }
+
+        static void convert(const std::string& from, const std::string& to, const atlas::RegularGrid& grid, atlas::Field& field)
+        {
+            try
+            {
+                FieldFiles::readField(from, grid, field);
+            }
+            catch (const std::runtime_error& ex)
+            {
+                atlas::Log::info () << "skipping " << from << " : " << ex.what() << std::endl ;
+                return;
+            }
+            atlas::Log::info () << "converting " << from << " to " << to << std::endl ;
+            FieldFiles::writeField(to, grid, field);
+        }
+
+        void FieldConverter::run()
+        {
+            if (atlas::mpi::comm().rank()!=0)
+            {
+                return;
+            }
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+            atlas::Field field("field", atlas::array::make_datatype<double>(), atlas::array::make_shape(mercator_grid.size()));
+
+            std::string binary = BinaryFieldFormat::extension();
+            for (const std::string& name : filesWithExtension(".", ".txt"))
+            {
+                if (outdated(name+".txt", name+binary))
+                {
+                    convert(name+".txt", name+binary, mercator_grid, field);
+                }
+            }
+            for (const std::string& name : filesWithExtension(".", binary))
+            {
+                if (outdated(name+binary, name+".txt"))
+                {
+                    convert(name+binary, name+".txt", mercator_grid, field);
+                }
+            }
+        }
+    }
+}
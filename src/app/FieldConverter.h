@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Converts the field files of the working directory between the text
+         * format of WGribFormat and the binary format of BinaryFieldFormat :
+         * a file <name>.txt of the dimensions of the grid is written to 
+         * <name>.fld, for the model, and a file <name>.fld to <name>.txt, for
+         * the plotting scripts, when the other file does not exist or is 
+         * older. The text files of other dimensions are left alone.
+         */
+        class FieldConverter : public Application {
+        public:
+            FieldConverter() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
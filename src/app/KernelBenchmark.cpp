@@ -0,0 +1,289 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/runtime/Trace.h"
+#include "atlas/parallel/omp/omp.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <iomanip>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../model/fdm/simd/StencilKernels.h"
+#include "../util/AlignedBuffer.h"
+
+#include "KernelBenchmark.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Data TLB load misses of the threads of the OpenMP team, counted
+         * with a perf event opened by each thread. Not available outside of
+         * Linux or if perf_event_paranoid forbids it.
+         */
+        class TlbMissCounter {
+        public:
+            TlbMissCounter() : fds(atlas_omp_get_max_threads(), -1)
+            {
+#ifdef __linux__
+                #pragma omp parallel
+                {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = PERF_TYPE_HW_CACHE;
+                    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ<<8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+                    attr.disabled = 1;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    fds[atlas_omp_get_thread_num()] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+                }
+#endif
+            }
+
+            ~TlbMissCounter()
+            {
+#ifdef __linux__
+                for (int fd : fds)
+                {
+                    if (fd>=0) close(fd);
+                }
+#endif
+            }
+
+            bool available() const
+            {
+                for (int fd : fds)
+                {
+                    if (fd<0) return false;
+                }
+                return true;
+            }
+
+            void start()
+            {
+#ifdef __linux__
+                for (int fd : fds)
+                {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+#endif
+            }
+
+            long stop()
+            {
+                long total = 0;
+#ifdef __linux__
+                for (int fd : fds)
+                {
+                    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                    long long count = 0;
+                    if (read(fd, &count, sizeof(count))==sizeof(count)) total += count;
+                }
+#endif
+                return total;
+            }
+
+        private:
+            std::vector<int> fds;
+        };
+
+        /**
+         * U, V, phi, m, f, K, zeta and an output field of ny rows of nx
+         * points, stride points apart, filled with non-trivial values to
+         * avoid denormals. The rows are first written by the threads of the
+         * sweeps.
+         */
+        class BenchmarkArrays {
+        public:
+            BenchmarkArrays(atlas::idx_t nx, atlas::idx_t ny, atlas::idx_t pStride, const AllocationPolicy& policy)
+                : stride(pStride)
+            {
+                for (int b=0;b<8;b++)
+                {
+                    buffers.emplace_back(new AlignedBuffer(sizeof(double)*stride*ny, policy));
+                    double* data = (double*)buffers.back()->data();
+                    #pragma omp parallel for
+                    for (atlas::idx_t y=0;y<ny;++y)
+                    {
+                        for (atlas::idx_t x=0;x<stride;x++)
+                        {
+                            long k = (long)y*nx+std::min(x, nx-1);
+                            data[y*stride+x] = 1.0+0.001*((k+b)%1000);
+                        }
+                    }
+                }
+            }
+
+            double* operator[](int b) const
+            {
+                return (double*)buffers[b]->data();
+            }
+
+            const atlas::idx_t stride;
+
+        private:
+            std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+        };
+
+        // name, number of arrays streamed per point, row sweep
+        typedef std::vector<std::tuple<std::string, int, std::function<void(atlas::idx_t)>>> Benchmarks;
+
+        static Benchmarks kernelBenchmarks(const simd::StencilKernels* kernels, const BenchmarkArrays& arrays, atlas::idx_t nx)
+        {
+            const double* U = arrays[0];
+            const double* V = arrays[1];
+            const double* phi = arrays[2];
+            const double* m = arrays[3];
+            const double* f = arrays[4];
+            const double* K = arrays[5];
+            const double* zeta = arrays[6];
+            double* out = arrays[7];
+            double dx2 = 2.0e4;
+            double dy2 = 2.0e4;
+            atlas::idx_t stride = arrays.stride;
+
+            return {
+                std::make_tuple("K", 4, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->calcK(U+i, V+i, m+i, out+i, 1, nx-1);
+                }),
+                std::make_tuple("zeta", 4, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->calcZeta(U+i-stride, U+i+stride, V+i, m+i, dx2, dy2, out+i, 1, nx-1);
+                }),
+                std::make_tuple("U_tdcy", 6, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->calcU_tdcy(V+i, phi+i, zeta+i, K+i, f+i, dx2, out+i, 1, nx-1);
+                }),
+                std::make_tuple("V_tdcy", 6, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->calcV_tdcy(U+i, phi+i-stride, phi+i+stride, zeta+i, K+i-stride, K+i+stride, f+i, dy2, out+i, 1, nx-1);
+                }),
+                std::make_tuple("phi_tdcy", 5, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->calcphi_tdcy(U+i, V+i-stride, V+i+stride, phi+i, phi+i-stride, phi+i+stride, m+i, dx2, dy2, out+i, 1, nx-1);
+                }),
+                std::make_tuple("a_bc", 3, [=](atlas::idx_t y) {
+                    atlas::idx_t i = y*stride;
+                    kernels->a_bc(U+i, V+i, 30.0, out+i, nx);
+                })
+            };
+        }
+
+        /**
+         * Seconds taken by repeat sweeps of the interior rows.
+         */
+        static double sweep(const std::function<void(atlas::idx_t)>& row, atlas::idx_t ny, int repeat)
+        {
+            atlas::Trace timer( Here(), "kernel benchmark" );
+            timer.start();
+            for (int r=0;r<repeat;r++)
+            {
+                #pragma omp parallel for
+                for(atlas::idx_t y=1;y<ny-1;++y)
+                {
+                    row(y);
+                }
+            }
+            timer.stop();
+            return timer.elapsed();
+        }
+
+        void KernelBenchmark::run()
+        {
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+            atlas::idx_t nx = mercator_grid.nx();
+            atlas::idx_t ny = mercator_grid.ny();
+            const int repeat = 20;
+            double points = (double)repeat*(nx-2)*(ny-2);
+
+            BenchmarkArrays arrays(nx, ny, nx, AllocationPolicy());
+
+            atlas::Log::info() << "kernel throughput on " << nx << "x" << ny << " points, "
+                << atlas_omp_get_max_threads() << " threads" << std::endl;
+            atlas::Log::info() << std::setw(8) << "isa" << std::setw(12) << "kernel"
+                << std::setw(12) << "Mpoints/s" << std::setw(10) << "GB/s" << std::endl;
+
+            for (auto kernels : simd::availableKernels())
+            {
+                for (auto& benchmark : kernelBenchmarks(kernels, arrays, nx))
+                {
+                    double seconds = sweep(std::get<2>(benchmark), ny, repeat);
+                    atlas::Log::info() << std::setw(8) << kernels->name << std::setw(12) << std::get<0>(benchmark)
+                        << std::setw(12) << std::fixed << std::setprecision(1) << points/seconds*1e-6
+                        << std::setw(10) << std::setprecision(2) << points*std::get<1>(benchmark)*sizeof(double)/seconds*1e-9
+                        << std::endl;
+                }
+            }
+
+            // all the kernels of the best instruction set, for each page size
+            // and with the rows padded to a multiple of the alignment or not
+            const simd::StencilKernels* kernels = &simd::selectKernels("auto");
+            TlbMissCounter tlbMisses;
+            atlas::Log::info() << "memory layouts (" << kernels->name << " kernels, dTLB load misses "
+                << (tlbMisses.available() ? "from perf events" : "not available") << ")" << std::endl;
+            atlas::Log::info() << std::setw(12) << "huge pages" << std::setw(8) << "stride"
+                << std::setw(12) << "Mpoints/s" << std::setw(10) << "GB/s" << std::setw(16) << "dTLB miss/kpt" << std::endl;
+            for (std::string hugePages : { "none", "transparent", "explicit" })
+            {
+                for (bool padded : { false, true })
+                {
+                    atlas::util::Config policyConfig("huge_pages", hugePages);
+                    AllocationPolicy policy(policyConfig);
+                    atlas::idx_t stride = padded ? policy.paddedStride(nx, sizeof(double)) : nx;
+                    std::unique_ptr<BenchmarkArrays> layoutArrays;
+                    try
+                    {
+                        layoutArrays.reset(new BenchmarkArrays(nx, ny, stride, policy));
+                    }
+                    catch (const std::runtime_error& ex)
+                    {
+                        atlas::Log::info() << std::setw(12) << hugePages << std::setw(8) << stride
+                            << "  not available : " << ex.what() << std::endl;
+                        continue;
+                    }
+
+                    double seconds = 0;
+                    double bytes = 0;
+                    tlbMisses.start();
+                    for (auto& benchmark : kernelBenchmarks(kernels, *layoutArrays, nx))
+                    {
+                        seconds += sweep(std::get<2>(benchmark), ny, repeat);
+                        bytes += points*std::get<1>(benchmark)*sizeof(double);
+                    }
+                    long misses = tlbMisses.stop();
+                    double allPoints = 6*points;
+                    atlas::Log::info() << std::setw(12) << hugePages << std::setw(8) << stride
+                        << std::setw(12) << std::fixed << std::setprecision(1) << allPoints/seconds*1e-6
+                        << std::setw(10) << std::setprecision(2) << bytes/seconds*1e-9
+                        << std::setw(16) << std::setprecision(3);
+                    if (tlbMisses.available())
+                    {
+                        atlas::Log::info() << misses/allPoints*1000;
+                    }
+                    else
+                    {
+                        atlas::Log::info() << "-";
+                    }
+                    atlas::Log::info() << std::endl;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Measures the throughput of the stencil kernels for each instruction 
+         * set supported by the CPU, on the size of the regional mercator grid.
+         * Then measures the throughput and the data TLB misses of all the 
+         * kernels for each page size of AllocationPolicy, with contiguous 
+         * rows or rows padded to the alignment.
+         */
+        class KernelBenchmark : public Application {
+        public:
+            KernelBenchmark() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
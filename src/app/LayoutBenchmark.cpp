@@ -0,0 +1,113 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/runtime/Trace.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/array.h"
+#include "eckit/filesystem/PathName.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+
+#include "LayoutBenchmark.h"
+#include "DistributedFields.h"
+#include "../model/Model.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Largest difference of the owned values of the pronostic fields of
+         * two models, on all the tasks.
+         */
+        static double maxDifference(Model& a, Model& b)
+        {
+            auto& fieldsA = a.pronosticFieldSet();
+            auto& fieldsB = b.pronosticFieldSet();
+            atlas::idx_t owned = a.getFunctionSpace().sizeOwned();
+            double result = 0;
+            for (atlas::idx_t v=0;v<fieldsA.size();v++)
+            {
+                // the views follow the strides of the interleaved fields
+                auto x = atlas::array::make_view<double, 1>(fieldsA.field(v));
+                auto y = atlas::array::make_view<double, 1>(fieldsB.field(fieldsA.field(v).name()));
+                for (atlas::idx_t i=0;i<owned;i++)
+                {
+                    result = std::max(result, std::abs(x(i)-y(i)));
+                }
+            }
+            atlas::mpi::comm().allReduceInPlace(result, eckit::mpi::max());
+            return result;
+        }
+
+        void LayoutBenchmark::run()
+        {
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+
+            atlas::util::Config base_config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                base_config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+            // the layouts are compared with the explicit scheme of fixed dt
+            base_config.set("time_scheme", "explicit");
+            base_config.set("adaptive_dt", false);
+            base_config.set("temporal_blocking", 1);
+            base_config.set("task_graph", false);
+            base_config.set("persistent_region", false);
+            base_config.set("halo_exchange", "blocking");
+
+            const int steps = 100;
+            std::vector<std::pair<std::string, std::string>> runs = {
+                { "separate", "agrid" }, { "separate", "agrid_fused" },
+                { "interleaved", "agrid" }, { "interleaved", "agrid_interleaved" }
+            };
+
+            std::unique_ptr<Model> reference;
+            std::vector<std::string> results;
+            for (auto& run : runs)
+            {
+                atlas::util::Config config(base_config);
+                config.set("layout", run.first);
+                config.set("dynamics", run.second);
+                std::unique_ptr<Model> model(new Model(mercator_grid, config));
+                readModelFields(*model, mercator_grid);
+                // the first steps allocate the buffers of the halo exchanges
+                model->advance(2);
+
+                atlas::Trace timer( Here(), "layoutbench" );
+                timer.start();
+                model->advance(steps);
+                timer.stop();
+                double elapsed = timer.elapsed();
+                atlas::mpi::comm().allReduceInPlace(elapsed, eckit::mpi::max());
+
+                std::stringstream line;
+                line << std::setw(12) << run.first << std::setw(18) << run.second << " : "
+                    << elapsed/steps << "s per step, "
+                    << (double)mercator_grid.size()*steps/elapsed*1e-6 << " Mpoints/s";
+                if (reference)
+                {
+                    line << ", max difference " << maxDifference(*reference, *model);
+                }
+                else
+                {
+                    reference = std::move(model);
+                }
+                results.push_back(line.str());
+            }
+
+            atlas::Log::info() << "cost per step on " << mercator_grid.nx() << "x" << mercator_grid.ny() << " points :" << std::endl;
+            for (auto& line : results)
+            {
+                atlas::Log::info() << line << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Measures the cost per step of the model with its fields in
+         * separate arrays or interleaved in one array, for the A-grid
+         * dynamics that accept each layout, on the grid and from the initial
+         * state of ModelRun, and checks that the layouts give the same state.
+         */
+        class LayoutBenchmark : public Application {
+        public:
+            LayoutBenchmark() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
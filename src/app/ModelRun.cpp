@@ -17,62 +17,233 @@
 #include "atlas/interpolation/method/MethodFactory.h"
 #include "atlas/runtime/Trace.h"
 #include "atlas/parallel/omp/omp.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/option.h"
+#include "eckit/filesystem/PathName.h"
 
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <cmath>
-
-#include "../util/WGribFormat.h"
+#include <algorithm>
+#include <chrono>
 
 #include "ModelRun.h"
+#include "DistributedFields.h"
+#include "AsyncOutputWriter.h"
 #include "../model/Model.h"
+#include "../util/ThreadLayout.h"
+#include "../util/BinaryFieldFormat.h"
+#include "../util/ChunkedFieldStore.h"
 
 namespace pifo {
     namespace app  {
-        void ModelRun::run()
+        static std::string outputExtension(const atlas::util::Config& model_config)
         {
-            atlas::Log::info() << "max threads : " << atlas_omp_get_max_threads() << std::endl;
-            atlas_omp_set_num_threads(atlas_omp_get_max_threads()/2);
-
-            atlas::Log::info () << "loading mercator grid" << std::endl ;
-            atlas::util::Config mercator_config("regional_mercator.yml");
-            atlas::RegularGrid mercator_grid(mercator_config);
-            Model model(mercator_grid);
-            
-            auto fields = model.pronosticFieldSet().field_names();
-            for (long unsigned int i=0;i<fields.size();i++)
+            std::string format = model_config.getString("output_format", "binary");
+            if (format=="binary")
+            {
+                return BinaryFieldFormat::extension();
+            }
+            else if (format=="text")
             {
-                atlas::Log::info () << "loading " << fields[i] << std::endl ;
-                WGribFormat::readField(fields[i]+".txt", mercator_grid, model.pronosticFieldSet().field(fields[i]));
+                return ".txt";
             }
+            else if (format=="chunked")
+            {
+                return ChunkedFieldStore::extension();
+            }
+            throw std::runtime_error("unknown output_format '"+format+"'");
+        }
 
-            fields = model.parameterFieldSet().field_names();
-            for (long unsigned int i=0;i<fields.size();i++)
+        template <typename Precision>
+        static void runModel(const atlas::RegularGrid& mercator_grid, const atlas::util::Config& model_config,
+            const ThreadLayout& layout)
+        {
+            std::string extension = outputExtension(model_config);
+            bool float32 = model_config.getBool("output_float32", false);
+            // a chunked file holds all the times of a field
+            bool chunked = extension==ChunkedFieldStore::extension();
+            ChunkedFieldEncoding encoding;
+            encoding.chunkNx = encoding.chunkNy = model_config.getInt("output_chunk", 256);
+            encoding.keepBits = model_config.getInt("output_keep_bits", float32 ? 23 : 0);
+            encoding.level = model_config.getInt("output_compression_level", 1);
+            encoding.threads = model_config.getInt("output_threads", 1);
+            ModelT<Precision> model(mercator_grid, model_config);
+            readModelFields(model, mercator_grid);
+            model.setStopTime(3*3600);
+
+            // each task writes its partition to its own checkpoint file
+            std::string checkpointFile = model_config.getString("checkpoint", "checkpoint")
+                +"_"+std::to_string(atlas::mpi::comm().rank())+".ckp";
+            double checkpointInterval = model_config.getDouble("checkpoint_interval", 0);
+            double checkpointWallInterval = model_config.getDouble("checkpoint_wall_interval", 0);
+            if (checkpointWallInterval>0 && model_config.getBool("persistent_region", false))
+            {
+                throw std::runtime_error("checkpoint_wall_interval needs the steps outside of a persistent_region, use checkpoint_interval");
+            }
+            if (model_config.getBool("restart", false))
             {
-                atlas::Log::info () << "loading " << fields[i] << std::endl ;
-                WGribFormat::readField(fields[i]+".txt", mercator_grid, model.parameterFieldSet().field(fields[i]));
+                atlas::Log::info () << "restarting from " << checkpointFile << std::endl ;
+                model.readCheckpoint(checkpointFile);
+                // a run killed while the tasks renamed their files
+                long minSteps = model.getSteps();
+                long maxSteps = model.getSteps();
+                atlas::mpi::comm().allReduceInPlace(minSteps, eckit::mpi::min());
+                atlas::mpi::comm().allReduceInPlace(maxSteps, eckit::mpi::max());
+                if (minSteps!=maxSteps)
+                {
+                    throw std::runtime_error("the checkpoints of the tasks are not of the same step");
+                }
+                atlas::Log::info () << "restarted at " << model.getTime() << "s after " << model.getSteps() << " steps" << std::endl ;
             }
+            auto writeCheckpoint = [&]()
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                size_t bytes = model.writeCheckpoint(checkpointFile);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+                atlas::mpi::comm().allReduceInPlace(seconds, eckit::mpi::max());
+                atlas::Log::info () << "checkpoint at " << model.getTime() << "s : " << bytes/(1024.0*1024.0) 
+                    << " MB per task in " << seconds << "s (" << bytes/(1024.0*1024.0)/seconds << " MB/s, slowest task)" << std::endl ;
+            };
+
+            const double stopTime = 3*3600;
+            double outputInterval = model_config.getDouble("output_interval", 0);
+            AsyncOutputWriter writer(mercator_grid, model.getFunctionSpace(),
+                (size_t)(model_config.getDouble("output_buffer_mb", 256)*1024*1024), float32, encoding,
+                layout.getSpareCpus());
+            auto fields = model.pronosticFieldSet().field_names();
+            auto writeFields = [&](const std::string& suffix)
+            {
+                for (long unsigned int i=0;i<fields.size();i++)
+                {
+                    writer.write(fields[i]+(chunked ? "" : suffix)+extension, model.pronosticFieldSet().field(fields[i]), model.getTime());
+                }
+            };
 
             atlas::Trace timer( Here(), "barotrope" );
             timer.start();
             double prevTime = 0.0;
-            while (model.getTime()<3*3600)//  3*3600
+            auto lastCheckpoint = std::chrono::steady_clock::now();
+            // the snapshots and checkpoints are taken at the first step at or
+            // after their time : dt is not shortened for them, the forecast 
+            // is the same with or without them, and after a restart
+            auto nextMultiple = [&](double interval)
+            {
+                return interval>0 ? (std::floor(model.getTime()/interval)+1)*interval : stopTime;
+            };
+            double nextOutput = nextMultiple(outputInterval);
+            double nextCheckpoint = nextMultiple(checkpointInterval);
+            while (model.getTime()<stopTime)
             {
-                model.step();
-                timer.pause();
-                atlas::Log::info () << "time " << model.getTime() << "s (elapsed : " << (timer.elapsed()-prevTime) << "s)" << std::endl ;
-                prevTime = timer.elapsed();
-                timer.resume();
+                model.advanceUntil(std::min({ nextOutput, nextCheckpoint, stopTime }), [&](double time)
+                {
+                    timer.pause();
+                    atlas::Log::info () << "time " << time << "s (elapsed : " << (timer.elapsed()-prevTime) << "s)";
+                    if (model.isAdaptiveDt())
+                    {
+                        atlas::Log::info () << " dt=" << model.getDt() << "s courant=" << model.getCourant();
+                    }
+                    atlas::Log::info () << std::endl ;
+                    if (checkpointWallInterval>0)
+                    {
+                        // the tasks agree to checkpoint the same step
+                        int due = std::chrono::duration<double>(std::chrono::steady_clock::now()-lastCheckpoint).count()>=checkpointWallInterval;
+                        atlas::mpi::comm().allReduceInPlace(due, eckit::mpi::max());
+                        if (due && time<stopTime)
+                        {
+                            writeCheckpoint();
+                            lastCheckpoint = std::chrono::steady_clock::now();
+                        }
+                    }
+                    prevTime = timer.elapsed();
+                    timer.resume();
+                });
+                if (model.getTime()>=nextOutput && model.getTime()<stopTime)
+                {
+                    atlas::Log::info () << "snapshot at " << model.getTime() << "s" << std::endl ;
+                    writeFields("_"+std::to_string(std::lround(nextOutput))+"s");
+                    nextOutput = nextMultiple(outputInterval);
+                }
+                if (model.getTime()>=nextCheckpoint && model.getTime()<stopTime)
+                {
+                    writeCheckpoint();
+                    nextCheckpoint = nextMultiple(checkpointInterval);
+                }
             }
             timer.stop();
             atlas::Log::info () << "iteration finished. Total time : " << timer.elapsed() << "s)" << std::endl ;
 
-            fields = model.pronosticFieldSet().field_names();
-            for (long unsigned int i=0;i<fields.size();i++)
+            double haloExchangeTime = model.getHaloExchangeTime();
+            double haloOverlapTime = model.getHaloOverlapTime();
+            atlas::mpi::comm().allReduceInPlace(haloExchangeTime, eckit::mpi::max());
+            atlas::mpi::comm().allReduceInPlace(haloOverlapTime, eckit::mpi::min());
+            atlas::Log::info () << "halo exchange : " << haloExchangeTime << "s on the critical path (slowest task), " 
+                << haloOverlapTime << "s of computation overlapped with the exchange (fastest task)" << std::endl ;
+            if (model.isAdaptiveDt())
+            {
+                atlas::Log::info () << "adaptive time step : " << model.getSteps() << " steps, " 
+                    << model.getDtChanges() << " changes of dt, mean dt " << model.getTime()/model.getSteps() << "s" << std::endl ;
+            }
+            if (model.getSolverIterations()>0)
+            {
+                atlas::Log::info () << "semi-implicit solver : " 
+                    << (double)model.getSolverIterations()/model.getSteps() 
+                    << " iterations per step" << std::endl ;
+            }
+            if (model.getSubsteps()>0)
+            {
+                atlas::Log::info () << "split-explicit : " 
+                    << (double)model.getSubsteps()/model.getSteps() 
+                    << " sub-steps per step" << std::endl ;
+            }
+
+            atlas::Log::info () << "writing the forecast" << std::endl ;
+            writeFields("_001");
+            writer.flush();
+            atlas::Log::info () << "outputs : " << writer.getStallTime() << "s waiting for the writer, at most "
+                << writer.getPeakBytes()/(1024.0*1024.0) << " MB buffered" << std::endl ;
+            if (writer.getChunkedBytes()>0)
+            {
+                atlas::Log::info () << "chunked outputs : " << writer.getChunkedBytes()/(1024.0*1024.0) << " MB, "
+                    << (double)writer.getChunkedRawBytes()/writer.getChunkedBytes() << " times smaller than doubles" << std::endl ;
+            }
+        }
+
+        void ModelRun::run()
+        {
+            // optional model configuration, see ModelRun for the keys
+            atlas::util::Config model_config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                atlas::Log::info () << "loading model configuration" << std::endl ;
+                model_config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+
+            atlas::Log::info() << "max threads : " << atlas_omp_get_max_threads() << std::endl;
+            ThreadLayout layout(model_config);
+            layout.apply();
+            atlas::Log::info() << "threads : " << layout.describe() << std::endl;
+
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+            std::string precision = model_config.getString("precision", "double");
+            if (precision=="double")
+            {
+                runModel<DoublePrecision>(mercator_grid, model_config, layout);
+            }
+            else if (precision=="single")
+            {
+                runModel<SinglePrecision>(mercator_grid, model_config, layout);
+            }
+            else if (precision=="mixed")
+            {
+                runModel<MixedPrecision>(mercator_grid, model_config, layout);
+            }
+            else
             {
-                atlas::Log::info () << "writing " << fields[i] << std::endl ;
-                WGribFormat::writeField(fields[i]+"_001.txt", mercator_grid, model.pronosticFieldSet().field(fields[i]));
+                throw std::runtime_error("unknown precision '"+precision+"'");
             }
         }
     }
@@ -4,6 +4,43 @@
 
 namespace pifo {
     namespace app  {
+        /**
+         * Forecast of 3 hours from the fields of DataProcessor, configured
+         * by the optional model.yml.
+         *
+         * <p>Configuration keys, besides those of Model and of
+         * ThreadLayout (the placement of the threads) :</p>
+         * <ul>
+         * <li>precision : working precision, double (default), single or
+         * mixed, see Precision.h.</li>
+         * <li>output_format : format of the forecasts, binary (default,
+         * U_001.fld, see BinaryFieldFormat), text (U_001.txt) or chunked 
+         * (U.cfs with all the times of U, see ChunkedFieldStore).</li>
+         * <li>output_float32 : store the binary forecasts as float 
+         * (default false).</li>
+         * <li>output_chunk, output_threads, output_compression_level : 
+         * chunks of the chunked format, of output_chunk points square 
+         * (default 256), encoded by output_threads threads (default 1) at
+         * this deflate level (default 1).</li>
+         * <li>output_keep_bits : bits of mantissa the chunked values are 
+         * rounded to, for a relative error of at most 2^-(bits+1) (default
+         * 0, lossless, or 23 with output_float32).</li>
+         * <li>output_interval : interval of the snapshots U_3600s.fld etc.
+         * in s (default none), written by a background thread while the 
+         * model steps, see AsyncOutputWriter.</li>
+         * <li>output_buffer_mb : most memory of the fields waiting to be 
+         * written (default 256).</li>
+         * <li>checkpoint_interval, checkpoint_wall_interval : intervals of
+         * the checkpoints in model s and in wall-clock s (not with 
+         * persistent_region), default none. The state of the model is 
+         * written to checkpoint_N.ckp by the task N, see 
+         * Model::writeCheckpoint.</li>
+         * <li>checkpoint : prefix of the checkpoint files (default 
+         * checkpoint).</li>
+         * <li>restart : continue from the checkpoint files the run that 
+         * wrote them, bit for bit (default false).</li>
+         * </ul>
+         */
         class ModelRun : public Application {
         public:
             ModelRun() : Application()
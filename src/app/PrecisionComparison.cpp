@@ -0,0 +1,114 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "eckit/filesystem/PathName.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "PrecisionComparison.h"
+#include "DistributedFields.h"
+#include "../model/Model.h"
+
+namespace pifo {
+    namespace app  {
+        namespace {
+            /**
+             * Owned values of the pronostic fields at the end of a forecast.
+             */
+            struct Forecast {
+                std::vector<std::string> names;
+                std::vector<std::vector<double>> values;
+                double elapsed;
+            };
+        }
+
+        template <typename Precision>
+        static Forecast runForecast(const atlas::RegularGrid& grid, const atlas::util::Config& config, double duration)
+        {
+            ModelT<Precision> model(grid, config);
+            readModelFields(model, grid);
+
+            auto t0 = std::chrono::steady_clock::now();
+            while (model.getTime()<duration)
+            {
+                int remainingSteps = (int)std::ceil((duration-model.getTime())/model.getDt());
+                model.advance(std::min(remainingSteps, model.getBlockSteps()));
+            }
+
+            Forecast forecast;
+            forecast.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+            atlas::mpi::comm().allReduceInPlace(forecast.elapsed, eckit::mpi::max());
+            auto& fields = model.pronosticFieldSet();
+            atlas::idx_t owned = model.getFunctionSpace().sizeOwned();
+            for (atlas::idx_t v=0;v<fields.size();v++)
+            {
+                auto data = (const typename Precision::value_type*)fields.field(v).storage();
+                forecast.names.push_back(fields.field(v).name());
+                forecast.values.push_back(std::vector<double>(data, data+owned));
+            }
+            atlas::Log::info() << Precision::name() << " forecast : " << forecast.elapsed << "s" << std::endl;
+            return forecast;
+        }
+
+        static void report(const Forecast& reference, const Forecast& forecast, const std::string& precision)
+        {
+            for (long unsigned int v=0;v<reference.names.size();v++)
+            {
+                const auto& x = reference.values[v];
+                const auto& y = forecast.values[v];
+                double maxDiff = 0;
+                double sumDiff2 = 0;
+                double sumRef2 = 0;
+                double count = x.size();
+                for (long unsigned int i=0;i<x.size();i++)
+                {
+                    double d = y[i]-x[i];
+                    maxDiff = std::max(maxDiff, std::abs(d));
+                    sumDiff2 += d*d;
+                    sumRef2 += x[i]*x[i];
+                }
+                const auto& comm = atlas::mpi::comm();
+                comm.allReduceInPlace(maxDiff, eckit::mpi::max());
+                comm.allReduceInPlace(sumDiff2, eckit::mpi::sum());
+                comm.allReduceInPlace(sumRef2, eckit::mpi::sum());
+                comm.allReduceInPlace(count, eckit::mpi::sum());
+
+                double rmsDiff = std::sqrt(sumDiff2/count);
+                double rmsRef = std::sqrt(sumRef2/count);
+                atlas::Log::info() << precision << " " << reference.names[v]
+                    << " : max |diff| " << maxDiff
+                    << ", rms diff " << rmsDiff
+                    << ", relative rms diff " << (rmsRef>0 ? rmsDiff/rmsRef : 0.0) << std::endl;
+            }
+            atlas::Log::info() << precision << " speedup : " << reference.elapsed/forecast.elapsed << std::endl;
+        }
+
+        void PrecisionComparison::run()
+        {
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+
+            atlas::util::Config model_config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                model_config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+            // the lower precisions only have the reference dynamics, and the
+            // values are compared as contiguous arrays of the owned points
+            model_config.set("dynamics", "agrid");
+            model_config.set("temporal_blocking", 1);
+            model_config.set("layout", "separate");
+
+            const double duration = 3*3600;
+            Forecast reference = runForecast<DoublePrecision>(mercator_grid, model_config, duration);
+            report(reference, runForecast<SinglePrecision>(mercator_grid, model_config, duration), SinglePrecision::name());
+            report(reference, runForecast<MixedPrecision>(mercator_grid, model_config, duration), MixedPrecision::name());
+        }
+    }
+}
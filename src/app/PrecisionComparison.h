@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Runs the forecast of ModelRun in double, single and mixed precision
+         * from the same initial state, and reports the difference of the 
+         * single and mixed forecasts against the double one, field by field.
+         */
+        class PrecisionComparison : public Application {
+        public:
+            PrecisionComparison() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
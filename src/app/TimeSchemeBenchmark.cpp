@@ -0,0 +1,105 @@
+#include "atlas/runtime/Log.h"
+#include "atlas/util/Config.h"
+#include "atlas/grid.h"
+#include "atlas/runtime/Trace.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "eckit/filesystem/PathName.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+
+#include "TimeSchemeBenchmark.h"
+#include "DistributedFields.h"
+#include "../model/Model.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * True if the owned values of the pronostic fields are finite on all the tasks.
+         */
+        static bool isFinite(Model& model)
+        {
+            auto& fields = model.pronosticFieldSet();
+            atlas::idx_t owned = model.getFunctionSpace().sizeOwned();
+            int finite = 1;
+            for (atlas::idx_t v=0;v<fields.size();v++)
+            {
+                auto data = (const double*)fields.field(v).storage();
+                for (atlas::idx_t i=0;i<owned;i++)
+                {
+                    if (!std::isfinite(data[i])) finite = 0;
+                }
+            }
+            atlas::mpi::comm().allReduceInPlace(finite, eckit::mpi::min());
+            return finite==1;
+        }
+
+        void TimeSchemeBenchmark::run()
+        {
+            atlas::Log::info () << "loading mercator grid" << std::endl ;
+            atlas::util::Config mercator_config("regional_mercator.yml");
+            atlas::RegularGrid mercator_grid(mercator_config);
+
+            atlas::util::Config base_config;
+            if (eckit::PathName("model.yml").exists())
+            {
+                base_config = atlas::util::Config(eckit::PathName("model.yml"));
+            }
+
+            const double duration = 3600;
+            std::vector<std::pair<std::string, double>> runs = {
+                { "explicit", 15 }, { "explicit", 30 }, { "explicit", 60 },
+                { "split_explicit", 60 }, { "split_explicit", 120 }, { "split_explicit", 240 },
+                { "semi_implicit", 60 }, { "semi_implicit", 120 }, { "semi_implicit", 240 }
+            };
+
+            std::vector<std::string> results;
+            for (auto& run : runs)
+            {
+                atlas::util::Config config(base_config);
+                config.set("time_scheme", run.first);
+                config.set("dt", run.second);
+                Model model(mercator_grid, config);
+                model.setStopTime(duration);
+                readModelFields(model, mercator_grid);
+
+                atlas::Trace timer( Here(), "schemebench" );
+                timer.start();
+                while (model.getTime()<duration && isFinite(model))
+                {
+                    int remainingSteps = (int)std::ceil((duration-model.getTime())/model.getDt());
+                    model.advance(std::min(remainingSteps, 10));
+                }
+                timer.stop();
+                double elapsed = timer.elapsed();
+                atlas::mpi::comm().allReduceInPlace(elapsed, eckit::mpi::max());
+                bool stable = isFinite(model) && model.getTime()>=duration;
+                long steps = model.getSteps();
+
+                std::stringstream line;
+                line << std::setw(16) << run.first << " dt=" << std::setw(5) << run.second << "s : ";
+                if (stable)
+                {
+                    line << elapsed*3600/duration << "s per simulated hour";
+                    if (model.getSubsteps()>0) line << ", " << (double)model.getSubsteps()/steps << " sub-steps per step";
+                    if (model.getSolverIterations()>0) line << ", " << (double)model.getSolverIterations()/steps << " solver iterations per step";
+                }
+                else
+                {
+                    line << "unstable after " << model.getTime() << "s";
+                }
+                results.push_back(line.str());
+            }
+
+            atlas::Log::info() << "cost per simulated hour :" << std::endl;
+            for (auto& line : results)
+            {
+                atlas::Log::info() << line << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Application.h"
+
+namespace pifo {
+    namespace app  {
+        /**
+         * Measures the cost per simulated hour of the time schemes of Model
+         * (explicit leapfrog, split-explicit and semi-implicit) for several 
+         * time steps, from the initial state of ModelRun, and tells which 
+         * runs stayed stable.
+         */
+        class TimeSchemeBenchmark : public Application {
+        public:
+            TimeSchemeBenchmark() : Application()
+            {
+
+            }
+
+            virtual void run();
+        };
+    }
+}
@@ -6,6 +6,13 @@
 #include "app/Application.h"
 #include "app/DataProcessor.h"
 #include "app/ModelRun.h"
+#include "app/KernelBenchmark.h"
+#include "app/PrecisionComparison.h"
+#include "app/EnsembleRun.h"
+#include "app/TimeSchemeBenchmark.h"
+#include "app/BandwidthBenchmark.h"
+#include "app/LayoutBenchmark.h"
+#include "app/FieldConverter.h"
 #include "app/ApplicationFactory.h"
 
 // #include <eckit/config/YAMLConfiguration.h>
@@ -34,8 +41,17 @@ namespace pifo {
             pifo::app::ApplicationFactory appFactory;
             appFactory.registerType<pifo::app::DataProcessor>("dataprocessor");
             appFactory.registerType<pifo::app::ModelRun>("run");
+            appFactory.registerType<pifo::app::KernelBenchmark>("kernelbench");
+            appFactory.registerType<pifo::app::PrecisionComparison>("precisiondiff");
+            appFactory.registerType<pifo::app::EnsembleRun>("ensemble");
+            appFactory.registerType<pifo::app::TimeSchemeBenchmark>("schemebench");
+            appFactory.registerType<pifo::app::BandwidthBenchmark>("bandwidth");
+            appFactory.registerType<pifo::app::LayoutBenchmark>("layoutbench");
+            appFactory.registerType<pifo::app::FieldConverter>("convert");
 
-            auto app = appFactory.create("run");
+            // the application to launch can be given as first argument
+            std::string appName = argc()>1 ? argv()[1] : "run";
+            auto app = appFactory.create(appName);
             app->run();
 
             atlas::Library::instance().finalise();            
@@ -0,0 +1,64 @@
+#include "model/BandHaloExchange.h"
+#include "atlas/array/ArrayView.h"
+#include "atlas/array/DataType.h"
+#include "atlas/parallel/mpi/mpi.h"
+
+namespace pifo {
+    BandHaloExchange::BandHaloExchange(const ConformalProjectionFiniteDifferenceMethod& pFdm)
+        : fdm(pFdm)
+    {
+        auto& functionSpace = fdm.getFunctionSpace();
+        auto partition = atlas::array::make_view<int, 1>(functionSpace.partition());
+        firstRow = functionSpace.j_begin();
+        lastRow = functionSpace.j_end()-1;
+        prevRank = firstRow>0 ? partition(fdm.getRowIndex(firstRow-1)) : -1;
+        nextRank = lastRow<fdm.getNy()-1 ? partition(fdm.getRowIndex(lastRow+1)) : -1;
+    }
+
+    void BandHaloExchange::start(atlas::FieldSet& fields)
+    {
+        requests.clear();
+        for (atlas::idx_t v=0;v<fields.size();v++)
+        {
+            auto& field = fields.field(v);
+            // values per point, the number of members of an ensemble
+            size_t width = field.size()/fdm.getFunctionSpace().size();
+            if (field.datatype()==atlas::array::make_datatype<float>())
+            {
+                startRows((float*)field.storage(), width, v);
+            }
+            else
+            {
+                startRows((double*)field.storage(), width, v);
+            }
+        }
+    }
+
+    template <typename T>
+    void BandHaloExchange::startRows(T* data, size_t width, int v)
+    {
+        const auto& comm = atlas::mpi::comm();
+        size_t count = fdm.getNx()*width;
+        // tag 2v : row sent to the previous band, 2v+1 : row sent to the next band
+        if (prevRank>=0)
+        {
+            requests.push_back(comm.iReceive(data+fdm.getRowIndex(firstRow-1)*width, count, prevRank, 2*v+1));
+            requests.push_back(comm.iSend(data+fdm.getRowIndex(firstRow)*width, count, prevRank, 2*v));
+        }
+        if (nextRank>=0)
+        {
+            requests.push_back(comm.iReceive(data+fdm.getRowIndex(lastRow+1)*width, count, nextRank, 2*v));
+            requests.push_back(comm.iSend(data+fdm.getRowIndex(lastRow)*width, count, nextRank, 2*v+1));
+        }
+    }
+
+    void BandHaloExchange::finish()
+    {
+        const auto& comm = atlas::mpi::comm();
+        for (auto& request : requests)
+        {
+            comm.wait(request);
+        }
+        requests.clear();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
+#include "eckit/mpi/Comm.h"
+#include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
+
+namespace pifo {
+    /**
+     * Non-blocking exchange of the one-row halos of a partition in bands of rows.
+     * 
+     * <p>start() posts the receives of the halo rows and the sends of the 
+     * first and last owned rows, directly from and to the fields (rows are 
+     * contiguous, so nothing is packed). The fields can be read on the rows 
+     * that don't need the halos until finish() returns, but must not be 
+     * modified.</p>
+     * 
+     * <p>Only the points x in [0, nx) of the halo rows are exchanged, which 
+     * is what the finite difference stencils use. Fields may be of type 
+     * double or float, with several members per point.</p>
+     */
+    class BandHaloExchange {
+    public:
+        BandHaloExchange(const ConformalProjectionFiniteDifferenceMethod& fdm);
+
+        void start(atlas::FieldSet& fields);
+
+        void finish();
+
+    private:
+        template <typename T>
+        void startRows(T* data, size_t width, int v);
+
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        // ranks owning the rows before and after the partition, or -1
+        int prevRank;
+        int nextRank;
+        atlas::idx_t firstRow;
+        atlas::idx_t lastRow;
+        std::vector<eckit::mpi::Request> requests;
+    };
+}
@@ -1,4 +1,6 @@
 #include "model/BarotropicDynamics.h"
+#include <stdexcept>
+#include <algorithm>
 
 namespace pifo {
     BarotropicDynamicsImpl::BarotropicDynamicsImpl(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
@@ -9,6 +11,61 @@ namespace pifo {
     
     BarotropicDynamicsImpl::~BarotropicDynamicsImpl() = default;
 
+    void BarotropicDynamicsImpl::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        calcK(U, V, K);
+        calcZeta(U, V, zeta);
+        calcU_tdcy(V, phi, zeta, K, U_tdcy);
+        calcV_tdcy(U, phi, zeta, K, V_tdcy);
+        calcphi_tdcy(U, V, phi, phi_tdcy);
+    }
+
+    void BarotropicDynamicsImpl::calcTendencies(
+        const atlas::Field&,
+        const atlas::Field&,
+        const atlas::Field&,
+        atlas::Field&,
+        atlas::Field&,
+        atlas::Field&,
+        atlas::Field&,
+        atlas::Field&,
+        atlas::idx_t,
+        atlas::idx_t) const
+    {
+        throw std::runtime_error("this barotropic dynamics can't compute the tendencies on a subset of rows");
+    }
+
+    void BarotropicDynamicsImpl::prepareStep(const atlas::FieldSet&, double)
+    {
+    }
+
+    double BarotropicDynamicsImpl::takeCourantRate() const
+    {
+        double rate = courantRate;
+        courantRate = -1;
+        return rate;
+    }
+
+    void BarotropicDynamicsImpl::setCourantRateNeeded(bool needed)
+    {
+        courantRateNeeded = needed;
+    }
+
+    void BarotropicDynamicsImpl::reduceCourantRate(double rate) const
+    {
+        // the kernels may run concurrently on different rows
+        #pragma omp critical (pifo_courant_rate)
+        courantRate = std::max(courantRate, rate);
+    }
+
 
     void BarotropicDynamics::calcU_tdcy(
         const atlas::Field& V, 
@@ -54,4 +111,17 @@ namespace pifo {
     {
         impl->calcZeta(U, V, zeta);
     }
+
+    void BarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        impl->calcTendencies(U, V, phi, K, zeta, U_tdcy, V_tdcy, phi_tdcy);
+    }
 }
\ No newline at end of file
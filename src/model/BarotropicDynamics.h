@@ -3,6 +3,7 @@
 #include "eckit/config/Parametrisation.h"
 #include "atlas/numerics/Method.h"
 #include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
 
 namespace pifo
 {
@@ -42,8 +43,80 @@ namespace pifo
             const atlas::Field& V,
             atlas::Field& zeta) const = 0;
 
+        /**
+         * Compute the three tendencies of a step.
+         * 
+         * <p>The default implementation calls calcK, calcZeta, calcU_tdcy,
+         * calcV_tdcy and calcphi_tdcy in sequence. Implementations may 
+         * override it with a fused kernel, in which case K and zeta are 
+         * not necessarily written.</p>
+         */
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        /**
+         * Compute the three tendencies on the rows [yBegin, yEnd) of the 
+         * partition only, which allows to overlap the halo exchange with the 
+         * computation of the rows that don't need the halos.
+         * 
+         * <p>The default implementation throws : not all the implementations 
+         * can work on a subset of rows.</p>
+         */
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        /**
+         * Called by the model before calcTendencies with the time level 
+         * previous and the time step tau of the update X(n+1) = previous + 
+         * tau T : the level n-1 and 2dt for a leapfrog step, the level n and
+         * dt for a forward step. The tendencies of semi-Lagrangian dynamics
+         * depend on them, the default implementation ignores them.
+         */
+        virtual void prepareStep(const atlas::FieldSet& previous, double tau);
+
+        /**
+         * Largest advective Courant number per second, m2 (|U|/dx + |V|/dy),
+         * over the points of the partition where K was computed since the 
+         * last call, which resets it. The kernels computing K may reduce it 
+         * on the fly with reduceCourantRate() if the model asked for it 
+         * with setCourantRateNeeded(), the value is negative if they didn't.
+         */
+        double takeCourantRate() const;
+
+        /**
+         * Whether the model reads takeCourantRate() (adaptive dt), false by
+         * default : the kernels then skip the reduction.
+         */
+        void setCourantRateNeeded(bool needed);
+
+    protected:
+        bool isCourantRateNeeded() const
+        {
+            return courantRateNeeded;
+        }
+
+        void reduceCourantRate(double rate) const;
+
     private:
         const atlas::numerics::Method& method;
+        bool courantRateNeeded = false;
+        mutable double courantRate = -1;
     };
 
     class BarotropicDynamics
@@ -81,6 +154,16 @@ namespace pifo
             const atlas::Field& U,
             const atlas::Field& V,
             atlas::Field& zeta) const;
+
+        void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
     private:
         BarotropicDynamicsImpl* impl = nullptr;
     };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "eckit/config/Parametrisation.h"
+#include "atlas/numerics/Method.h"
+#include "util/Factory.h"
+#include "model/BarotropicDynamics.h"
+#include "model/fdm/AGridBarotropicDynamics.h"
+#include "model/fdm/FusedAGridBarotropicDynamics.h"
+#include "model/fdm/SimdAGridBarotropicDynamics.h"
+#include "model/fdm/EnsembleAGridBarotropicDynamics.h"
+#include "model/fdm/SemiLagrangianBarotropicDynamics.h"
+#include "model/fdm/InterleavedAGridBarotropicDynamics.h"
+#include "model/fdm/ExpressionAGridBarotropicDynamics.h"
+
+namespace pifo {
+    /**
+     * Factory of the BarotropicDynamicsImpl variants, selected by name at runtime.
+     * 
+     * <ul>
+     * <li>agrid : reference A-grid kernels, one sweep per kernel.</li>
+     * <li>agrid_fused : A-grid kernels fused in a single sweep.</li>
+     * <li>agrid_simd : vectorized A-grid kernels, see the simd key of Model.</li>
+     * <li>agrid_ensemble : A-grid kernels on fields holding several members,
+     * see the members key of Model.</li>
+     * <li>agrid_sl : semi-Lagrangian advection on the A-grid, with 
+     * sl_iterations iterations of the trajectories (default 3). The 
+     * departure points must be within the halo, Model builds it with 
+     * sl_halo rows (default 3) for this dynamics.</li>
+     * <li>agrid_interleaved : A-grid kernels fused in a single sweep of the
+     * interleaved layout, see the layout key of Model.</li>
+     * <li>agrid_expression : A-grid tendencies written as stencil 
+     * expressions, evaluated in a single sweep.</li>
+     * </ul>
+     */
+    class BarotropicDynamicsFactory : public Factory<BarotropicDynamicsImpl, const atlas::numerics::Method&, const eckit::Parametrisation&>
+    {
+    public:
+        BarotropicDynamicsFactory()
+        {
+            registerType<AGridBarotropicDynamics>("agrid");
+            registerType<FusedAGridBarotropicDynamics>("agrid_fused");
+            registerType<SimdAGridBarotropicDynamics>("agrid_simd");
+            registerType<EnsembleAGridBarotropicDynamics>("agrid_ensemble");
+            registerType<SemiLagrangianBarotropicDynamics>("agrid_sl");
+            registerType<InterleavedAGridBarotropicDynamics>("agrid_interleaved");
+            registerType<ExpressionAGridBarotropicDynamics>("agrid_expression");
+        }
+    };
+}
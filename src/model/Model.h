@@ -1,66 +1,284 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <algorithm>
 
 #include "atlas/runtime/Log.h"
 #include "atlas/grid.h"
 #include "atlas/array/ArrayView.h"
+#include "atlas/array/ArraySpec.h"
 #include "atlas/functionspace/StructuredColumns.h"
+#include "atlas/grid/Partitioner.h"
+#include "atlas/option.h"
+#include "atlas/parallel/mpi/mpi.h"
 //#include "atlas/meshgenerator.h"
 //#include "atlas/mesh.h"
 #include "atlas/field.h"
 #include "atlas/field/FieldSet.h"
 #include "atlas/parallel/omp/omp.h"
+#include "atlas/util/Config.h"
 #include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
-#include "model/fdm/AGridBarotropicDynamics.h"
+#include "model/BarotropicDynamicsFactory.h"
+#include "model/Precision.h"
+#include "model/BandHaloExchange.h"
+#include "model/SteppingStrategy.h"
+#include "model/fdm/simd/StencilKernels.h"
+#include "util/AlignedBuffer.h"
+#include "util/DirectFile.h"
 
 namespace pifo {
-    class Model {
+    /**
+     * Barotropic model on a regional conformal grid.
+     * 
+     * <p>The grid is partitioned in bands of complete rows, one per MPI task,
+     * with a halo of one row (sl_halo rows with the agrid_sl dynamics). The
+     * halos of the pronostic fields are exchanged at the beginning of each
+     * step, the parameter fields must be exchanged once loaded.</p>
+     * 
+     * <p>The pronostic fields are held in a ring of three time levels (n-1, n
+     * and n+1) rotated at the end of each step, pronosticFieldSet() is the 
+     * level n and changes from a step to the next. Field handles are resolved
+     * once at construction.</p>
+     * 
+     * <p>The model is templated on the working precision (see Precision.h) :
+     * the pronostic and parameter fields are stored in Precision::value_type,
+     * the diagnostics and the tendencies in Precision::tendency_type, in 
+     * which the time stepping is computed. Only the agrid dynamics support 
+     * other precisions than double.</p>
+     * 
+     * <p>Configuration keys :</p>
+     * <ul>
+     * <li>dynamics : name of the BarotropicDynamicsImpl to use, see 
+     * BarotropicDynamicsFactory (default agrid).</li>
+     * <li>simd : instruction set of the vectorized kernels (auto, scalar, 
+     * sse2, avx2, avx512), used by the time stepping and by agrid_simd 
+     * (default auto).</li>
+     * <li>array_access : checked (default) or raw, access of the kernels 
+     * of the agrid dynamics to the fields, see AGridBarotropicDynamicsT. 
+     * raw needs the separate layout.</li>
+     * <li>halo_exchange : blocking (default) exchanges the halos before 
+     * computing the tendencies. overlap starts a non-blocking exchange, 
+     * computes the rows that don't need the halos, then finishes the first
+     * and last rows of the band once the halos arrived. overlap needs a 
+     * halo of one row.</li>
+     * <li>temporal_blocking : number of steps advanced in one sweep of the 
+     * grid by advance(), each by a group of the threads (default 1, no 
+     * blocking). Needs the agrid_fused dynamics and a single MPI task, see
+     * TemporalBlocking.</li>
+     * <li>alignment, huge_pages : allocation of the fields, see 
+     * AllocationPolicy (default 64 bytes and the pages of the system). The 
+     * rows of StructuredColumns are contiguous, only the start of each 
+     * field is aligned.</li>
+     * <li>layout : separate (default) stores each field in its own array.
+     * interleaved stores U, V and phi of a time level in a single array, 
+     * point by point, and likewise K and zeta, and the three tendencies : 
+     * the fields are strided views of these arrays. The kernels then read 
+     * a few streams instead of one per variable. Needs the agrid dynamics 
+     * (through its strided views) or agrid_interleaved (see 
+     * InterleavedAGridBarotropicDynamics), a single member, the explicit 
+     * scheme, blocking halo exchanges, a fixed dt, and no temporal 
+     * blocking, task graph or persistent region.</li>
+     * <li>members : number of ensemble members held in the model (default 
+     * 1). With more than one member, the pronostic, diagnostic and tendency
+     * fields have the shape (points, members) and the dynamics must be 
+     * agrid_ensemble (the default then), m and f are shared.</li>
+     * <li>dt : time step in s (default 15).</li>
+     * <li>time_scheme : explicit (default) or semi_implicit, which treats
+     * the gravity waves implicitly and allows much longer time steps, see
+     * SemiImplicitSolver. semi_implicit_phi is the reference geopotential
+     * (default the maximum of the initial phi), solver_tolerance and 
+     * solver_max_iterations control the Helmholtz solver (default 1e-8 and
+     * 200). split_explicit sub-steps the gravity-wave terms, see 
+     * SplitExplicitIntegrator, with substeps sub-steps per step (default 0,
+     * the smallest stable number). The implicit and split schemes need 
+     * double precision and a single member.</li>
+     * <li>adaptive_dt : if true, dt is adapted at each step to the largest
+     * Courant number, dt (m2 (|U|/dx + |V|/dy) + c), where c is the gravity
+     * wave term m sqrt(phi) sqrt(1/dx2 + 1/dy2) of the explicit scheme and 0
+     * with the other ones. dt is set to courant_target/rate (default 0.5)
+     * when the Courant number goes over courant_max (default 0.8) or under
+     * courant_target/1.25, within [dt_min, dt_max] (default dt/10 and 
+     * 10 dt), and the leapfrog restarts with a forward step. Not available
+     * with temporal blocking or the agrid_sl dynamics. The advective rate is
+     * reduced in calcK by the dynamics that support it, see 
+     * BarotropicDynamicsImpl::takeCourantRate().</li>
+     * <li>task_graph : if true, the tendencies and the update of the 
+     * explicit scheme are a graph of OpenMP tasks on blocks of task_rows 
+     * rows (default 16), see TaskGraphT. Needs the explicit scheme, blocking
+     * halo exchanges, a fixed dt and the row kernels of the A-grid 
+     * dynamics (all but agrid_sl, agrid_fused then uses the unfused ones).</li>
+     * <li>persistent_region : if true, advanceUntil() runs all its steps in
+     * one OpenMP parallel region, each thread on a fixed band of rows, see
+     * PersistentRegion. Needs the agrid_fused dynamics in double precision,
+     * a single MPI task and member, the explicit scheme, a fixed dt and no 
+     * temporal blocking.</li>
+     * </ul>
+     *
+     * <p>The time scheme and the execution mode are a SteppingStrategyT, 
+     * which checks their requirements : at most one of temporal_blocking,
+     * task_graph, persistent_region and the semi_implicit or split_explicit
+     * schemes.</p>
+     */
+    template <typename Precision>
+    class ModelT {
     public:
-        Model(atlas::RegularGrid pgrid)
+        typedef typename Precision::value_type value_type;
+        typedef typename Precision::tendency_type tendency_type;
+
+        ModelT(atlas::RegularGrid pgrid, const atlas::util::Config& config = atlas::util::Config())
             : grid(atlas::RegularGrid(pgrid)),
-            functionSpace(atlas::functionspace::StructuredColumns(pgrid)) // , atlas::option::halo(1)
+            functionSpace(atlas::functionspace::StructuredColumns(pgrid, bandsPartitioner(), atlas::option::halo(haloRows(config))))
         {
-            pronosticFields = atlas::FieldSet("pronostics");
-            pronosticFields.add(functionSpace.createField<double>(atlas::option::name("U")));
-            pronosticFields.add(functionSpace.createField<double>(atlas::option::name("V")));
-            pronosticFields.add(functionSpace.createField<double>(atlas::option::name("phi")));
+            members = std::max(config.getInt("members", 1), 1);
+            allocationPolicy = AllocationPolicy(config);
+            std::string layout = config.getString("layout", "separate");
+            if (layout!="separate" && layout!="interleaved")
+            {
+                throw std::runtime_error("unknown layout '"+layout+"'");
+            }
+            interleaved = layout=="interleaved";
+            if (interleaved && members>1)
+            {
+                throw std::runtime_error("the interleaved layout needs a single member");
+            }
+            for (auto& level : timeLevels)
+            {
+                level.fields = atlas::FieldSet("pronostics");
+                auto fields = createFields<value_type>({ "U", "V", "phi" });
+                level.U = level.fields.add(fields[0]);
+                level.V = level.fields.add(fields[1]);
+                level.phi = level.fields.add(fields[2]);
+            }
+            current = 0;
 
             parameterFields = atlas::FieldSet("parameters");
-            parameterFields.add(functionSpace.createField<double>(atlas::option::name("m")));
-            parameterFields.add(functionSpace.createField<double>(atlas::option::name("f")));
+            parameterFields.add(createField<value_type>("m", 1));
+            parameterFields.add(createField<value_type>("f", 1));
 
             diagnosticFields = atlas::FieldSet("diagnostics");
-            diagnosticFields.add(functionSpace.createField<double>(atlas::option::name("K")));
-            diagnosticFields.add(functionSpace.createField<double>(atlas::option::name("zeta")));
+            for (auto& field : createFields<tendency_type>({ "K", "zeta" }))
+            {
+                diagnosticFields.add(field);
+            }
 
             internalFields = atlas::FieldSet("internal");
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("U_t")));
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("V_t")));
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("phi_t")));
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("U_tdcy")));
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("V_tdcy")));
-            internalFields.add(functionSpace.createField<double>(atlas::option::name("phi_tdcy")));
+            for (auto& field : createFields<tendency_type>({ "U_tdcy", "V_tdcy", "phi_tdcy" }))
+            {
+                internalFields.add(field);
+            }
+
+            K = diagnosticFields.field("K");
+            zeta = diagnosticFields.field("zeta");
+            U_tdcy = internalFields.field("U_tdcy");
+            V_tdcy = internalFields.field("V_tdcy");
+            phi_tdcy = internalFields.field("phi_tdcy");
             
             method = std::unique_ptr<ConformalProjectionFiniteDifferenceMethod>(
                 new ConformalProjectionFiniteDifferenceMethod(
                     functionSpace, 
                     parameterFields.field("f"), 
                     parameterFields.field("m")));
-            dynamics = std::unique_ptr<AGridBarotropicDynamics>(new AGridBarotropicDynamics(*method));
+            for (auto& buffer : buffers)
+            {
+                firstTouch(*buffer);
+            }
+            std::string dynamicsName = config.getString("dynamics", members>1 ? "agrid_ensemble" : "agrid");
+            if (members>1 && dynamicsName!="agrid_ensemble")
+            {
+                throw std::runtime_error("an ensemble needs the agrid_ensemble dynamics");
+            }
+            if (std::is_same<Precision, DoublePrecision>::value)
+            {
+                dynamics = BarotropicDynamicsFactory().create(dynamicsName, *method, config);
+            }
+            else if (dynamicsName=="agrid")
+            {
+                dynamics = std::unique_ptr<BarotropicDynamicsImpl>(new AGridBarotropicDynamicsT<Precision>(*method, config));
+            }
+            else
+            {
+                throw std::runtime_error("dynamics '"+dynamicsName+"' is only available in double precision");
+            }
+            kernels = &simd::selectKernels(config.getString("simd", "auto"));
+
+            std::string haloExchangeMode = config.getString("halo_exchange", "blocking");
+            if (haloExchangeMode=="overlap")
+            {
+                if (functionSpace.halo()>1)
+                {
+                    throw std::runtime_error("halo_exchange overlap exchanges a halo of one row, not the sl_halo rows of agrid_sl");
+                }
+                bandHaloExchange = std::unique_ptr<BandHaloExchange>(new BandHaloExchange(*method));
+            }
+            else if (haloExchangeMode!="blocking")
+            {
+                throw std::runtime_error("unknown halo_exchange mode '"+haloExchangeMode+"'");
+            }
+
+            dt = config.getDouble("dt", 15);
+            adaptiveDt = config.getBool("adaptive_dt", false);
+            if (adaptiveDt && dynamic_cast<const SemiLagrangianBarotropicDynamics*>(dynamics.get()))
+            {
+                // the advection isn't limited by the Courant number, and the
+                // tendencies depend on dt
+                throw std::runtime_error("adaptive_dt is not available with the agrid_sl dynamics");
+            }
+            // the kernels computing K only reduce the Courant rate for adaptDt
+            dynamics->setCourantRateNeeded(adaptiveDt);
+            courantTarget = config.getDouble("courant_target", 0.5);
+            courantMax = config.getDouble("courant_max", 0.8);
+            dtMin = config.getDouble("dt_min", dt/10);
+            dtMax = config.getDouble("dt_max", 10*dt);
+            if (interleaved != (dynamicsName=="agrid_interleaved") && dynamicsName!="agrid")
+            {
+                throw std::runtime_error("the interleaved layout needs the agrid or agrid_interleaved dynamics, and agrid_interleaved the interleaved layout");
+            }
+            if (interleaved && config.getString("array_access", "checked")=="raw")
+            {
+                throw std::runtime_error("the interleaved layout needs the checked array_access");
+            }
+            if (interleaved && (bandHaloExchange || adaptiveDt))
+            {
+                throw std::runtime_error("the interleaved layout needs blocking halo exchanges and a fixed dt");
+            }
+
+            // the time scheme and the execution mode, which check their
+            // own requirements
+            SteppingContext context = { *dynamics, *method, *kernels, members, interleaved, !bandHaloExchange, adaptiveDt };
+            stepping = SteppingStrategyT<Precision>::create(config, context);
 
-            dt = 15;
             atlas::Log::info() << "init model for dx=" << method->getDx() 
                 << " dy=" << method->getDy() 
                 << " dt=" << dt 
                 << " nx=" << grid.nx() 
                 << " ny=" << grid.ny()
+                << " precision=" << Precision::name()
+                << " members=" << members
+                << " layout=" << layout
+                << " allocation=(" << allocationPolicy.describe() << ")"
+                << " partition=" << atlas::mpi::comm().rank() << "/" << atlas::mpi::comm().size()
                 << " halo=" << functionSpace.halo() 
-                << " size=" << functionSpace.size() << "/" << pronosticFields.field("U").size()
+                << " size=" << functionSpace.size() << "/" << timeLevel(0).U.size()
                 << " sizeHalo=" << functionSpace.sizeHalo()
+                << " dynamics=" << dynamicsName
+                << " simd=" << kernels->name
+                << " halo_exchange=" << haloExchangeMode
+                << " " << stepping->describe()
+                << " adaptive_dt=" << adaptiveDt
                 << std::endl;
             atlas::Log::info() << "iterate i : " 
-                << "(" << functionSpace.i_begin(0) << "," << functionSpace.i_begin_halo(0) << "," << functionSpace.i_end_halo(0) << "," << functionSpace.i_end(0) << ")"
+                << "(" << functionSpace.i_begin(functionSpace.j_begin()) << "," << functionSpace.i_begin_halo(functionSpace.j_begin()) 
+                << "," << functionSpace.i_end_halo(functionSpace.j_begin()) << "," << functionSpace.i_end(functionSpace.j_begin()) << ")"
                 << std::endl;
             atlas::Log::info() << "iterate j : " 
                 << "(" << functionSpace.j_begin() << "," << functionSpace.j_begin_halo() << "," << functionSpace.j_end_halo() << "," << functionSpace.j_end() << ")"
@@ -70,7 +288,7 @@ namespace pifo {
             time = 0;
         }
 
-        ~Model()
+        ~ModelT()
         {
         }
 
@@ -79,13 +297,26 @@ namespace pifo {
             return grid;        
         }
 
+        const atlas::functionspace::StructuredColumns& getFunctionSpace()
+        {
+            return functionSpace;
+        }
+
+        /**
+         * Pronostic fields at the current time (level n of the ring).
+         */
         atlas::FieldSet& pronosticFieldSet()
         {
-            return pronosticFields;
+            return timeLevel(0).fields;
         }
 
+        /**
+         * Parameter fields (m and f). The method scans them again before the
+         * next step, as they may be written through this reference.
+         */
         atlas::FieldSet& parameterFieldSet()
         {
+            metricsUpToDate = false;
             return parameterFields;
         }
 
@@ -104,161 +335,704 @@ namespace pifo {
             return dt;
         }
 
+        /**
+         * Change the time step, the leapfrog restarts with a forward step if
+         * it differs.
+         */
         void setDt(double pdt)
         {
+            if (pdt!=dt)
+            {
+                startLeapFrog = true;
+            }
             dt = pdt;
         }
 
+        /**
+         * With adaptive_dt, the step reaching this time is shortened to end 
+         * on it. Negative (the default) for none.
+         */
+        void setStopTime(double pStopTime)
+        {
+            stopTime = pStopTime;
+        }
+
         double getTime()
         {
             return time;
         }
 
+        /**
+         * Number of steps done, which differs from getTime()/getDt() with 
+         * adaptive_dt.
+         */
+        long getSteps()
+        {
+            return steps;
+        }
+
+        bool isAdaptiveDt()
+        {
+            return adaptiveDt;
+        }
+
+        /**
+         * Largest Courant number of the last step (with adaptive_dt only).
+         */
+        double getCourant()
+        {
+            return courant;
+        }
+
+        /**
+         * Number of changes of the time step by the adaptive_dt controller.
+         */
+        long getDtChanges()
+        {
+            return dtChanges;
+        }
+
+        /**
+         * Number of ensemble members, the second dimension of the fields if 
+         * more than one.
+         */
+        int getMembers()
+        {
+            return members;
+        }
+
+        /**
+         * Number of steps advance() does in one sweep of the grid.
+         */
+        int getBlockSteps()
+        {
+            return stepping->getBlockSteps();
+        }
+
+        /**
+         * Time spent in halo exchanges on the critical path (s).
+         */
+        double getHaloExchangeTime()
+        {
+            return haloExchangeTime;
+        }
+
+        /**
+         * Time spent computing while a non-blocking halo exchange was in progress (s).
+         */
+        double getHaloOverlapTime()
+        {
+            return haloOverlapTime;
+        }
+
+        /**
+         * Iterations of the Helmholtz solver of the semi-implicit scheme (0 
+         * with the explicit one).
+         */
+        long getSolverIterations()
+        {
+            return stepping->getSolverIterations();
+        }
+
+        /**
+         * Sub-steps of the split-explicit scheme (0 with the other ones).
+         */
+        long getSubsteps()
+        {
+            return stepping->getSubsteps();
+        }
+
         void step()
         {
-            calcK();
-            calcZeta();
-            calcU_tdcy();
-            calcV_tdcy();
-            calcphi_tdcy();
+            updateMetrics();
+            if (startLeapFrog)
+            {
+                dynamics->prepareStep(timeLevel(0).fields, dt);
+            }
+            else
+            {
+                dynamics->prepareStep(timeLevel(-1).fields, 2*dt);
+            }
+
+            if (bandHaloExchange)
+            {
+                calcTendenciesOverlapped();
+            }
+            else
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                exchangeHalo(timeLevel(0).fields);
+                haloExchangeTime += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+                if (!stepping->computesTendencies())
+                {
+                    calcTendencies();
+                }
+            }
+
+            if (adaptiveDt)
+            {
+                adaptDt();
+            }
 
-            if (time==0)
+            if (startLeapFrog)
             {
-                stepEuler();
+                stepping->step(timeLevel(0).fields, timeLevel(0).fields, K, zeta, internalFields, dt, timeLevel(1).fields);
             }
             else
             {
-                stepLeapFrog();
+                stepping->step(timeLevel(-1).fields, timeLevel(0).fields, K, zeta, internalFields, 2*dt, timeLevel(1).fields);
             }
 
-            finalizeStep();
+            current = (current+1)%3;
+            startLeapFrog = false;
 
             time += dt;
+            steps++;
+        }
+
+        /**
+         * Advance by a given number of steps, in blocks of getBlockSteps() 
+         * steps if temporal blocking is enabled.
+         */
+        void advance(int steps)
+        {
+            while (steps>0)
+            {
+                steps -= advanceBlock(steps, [](double) {});
+            }
+        }
+
+        /**
+         * Advance up to a given time, calling onStep with the model time 
+         * between the steps (or the blocks of temporal blocking steps). 
+         * 
+         * <p>With persistent_region, all the steps run in a single parallel
+         * region and onStep is called by its master thread once its rows are
+         * done, while the other threads may still finish the step : it 
+         * should only log or time, not read the fields.</p>
+         */
+        void advanceUntil(double end, const std::function<void(double)>& onStep)
+        {
+            while (time<end)
+            {
+                int remainingSteps = (int)std::ceil((end-time)/dt);
+                advanceBlock(remainingSteps, onStep);
+            }
+        }
+
+        /**
+         * Write the state of this partition from which the run continues
+         * bit for bit : the levels n-1 and n of the pronostic fields, the 
+         * parameter, diagnostic and internal fields, halos included, dt, 
+         * the time, the number of steps, whether the next step is a 
+         * forward one and the reference geopotential of the semi-implicit
+         * scheme. Each task writes its partition to its own file, with
+         * direct I/O (see DirectFileWriter). Returns the bytes written.
+         */
+        size_t writeCheckpoint(const std::string& file)
+        {
+            CheckpointHeader header = checkpointHeader();
+            DirectFileWriter out(file);
+            out.write(&header, sizeof(header));
+            for (auto& entry : checkpointFields())
+            {
+                const atlas::Field& field = entry.first;
+                size_t elementSize = entry.second;
+                if (field.rank()>1 || field.stride(0)==1)
+                {
+                    out.write(field.storage(), field.size()*elementSize);
+                    continue;
+                }
+                // a component of the interleaved layout
+                std::vector<char> values(field.size()*elementSize);
+                auto data = (const char*)field.storage();
+                for (atlas::idx_t i=0;i<field.size();i++)
+                {
+                    std::memcpy(values.data()+i*elementSize, data+i*field.stride(0)*elementSize, elementSize);
+                }
+                out.write(values.data(), values.size());
+            }
+            size_t bytes = out.size();
+            out.close();
+            return bytes;
+        }
+
+        /**
+         * Restore the state written by writeCheckpoint() on a model of the
+         * same configuration and partition.
+         */
+        void readCheckpoint(const std::string& file)
+        {
+            CheckpointHeader expected = checkpointHeader();
+            CheckpointHeader header;
+            SequentialFileReader in(file);
+            in.read(&header, sizeof(header));
+            if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))!=0 || header.version!=expected.version)
+            {
+                throw std::runtime_error(file+" is not a checkpoint of this version");
+            }
+            if (header.valueSize!=expected.valueSize || header.tendencySize!=expected.tendencySize 
+                || header.members!=expected.members || header.tasks!=expected.tasks || header.rank!=expected.rank 
+                || header.points!=expected.points || header.fields!=expected.fields)
+            {
+                throw std::runtime_error(file+" is a checkpoint of another precision, number of members or partition");
+            }
+            for (auto& entry : checkpointFields())
+            {
+                atlas::Field& field = entry.first;
+                size_t elementSize = entry.second;
+                if (field.rank()>1 || field.stride(0)==1)
+                {
+                    in.read(field.storage(), field.size()*elementSize);
+                    continue;
+                }
+                std::vector<char> values(field.size()*elementSize);
+                in.read(values.data(), values.size());
+                auto data = (char*)field.storage();
+                for (atlas::idx_t i=0;i<field.size();i++)
+                {
+                    std::memcpy(data+i*field.stride(0)*elementSize, values.data()+i*elementSize, elementSize);
+                }
+            }
+            dt = header.dt;
+            time = header.time;
+            steps = header.steps;
+            dtChanges = header.dtChanges;
+            startLeapFrog = header.startLeapFrog!=0;
+            stepping->setPhiRef(header.phiRef);
+            metricsUpToDate = false;
         }
 
 
     private:
+        /**
+         * Start of a checkpoint file, followed by the fields of 
+         * checkpointFields().
+         */
+        struct CheckpointHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t valueSize;
+            uint32_t tendencySize;
+            int32_t members;
+            int32_t tasks;
+            int32_t rank;
+            int64_t points;
+            int64_t fields;
+            double dt;
+            double time;
+            int64_t steps;
+            int64_t dtChanges;
+            int64_t startLeapFrog;
+            double phiRef;
+        };
+        /**
+         * Pronostic fields of a time level.
+         */
+        struct TimeLevel {
+            atlas::FieldSet fields;
+            atlas::Field U;
+            atlas::Field V;
+            atlas::Field phi;
+        };
+
         atlas::RegularGrid grid;
         atlas::functionspace::StructuredColumns functionSpace;
-        atlas::FieldSet pronosticFields;
+        AllocationPolicy allocationPolicy;
+        // memory of the fields
+        std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+        bool interleaved;
+        std::array<TimeLevel, 3> timeLevels;
+        int current;
         atlas::FieldSet parameterFields;
         atlas::FieldSet diagnosticFields;
         atlas::FieldSet internalFields;
+        atlas::Field K;
+        atlas::Field zeta;
+        atlas::Field U_tdcy;
+        atlas::Field V_tdcy;
+        atlas::Field phi_tdcy;
         
         std::unique_ptr<ConformalProjectionFiniteDifferenceMethod> method;
-        std::unique_ptr<AGridBarotropicDynamics> dynamics;
+        std::unique_ptr<BarotropicDynamicsImpl> dynamics;
+        const simd::StencilKernels* kernels;
+        std::unique_ptr<BandHaloExchange> bandHaloExchange;
+        std::unique_ptr<SteppingStrategyT<Precision>> stepping;
+        int members;
+        double haloExchangeTime = 0;
+        double haloOverlapTime = 0;
 
         double dt;
         double time;
+        long steps = 0;
+        // the next step is a forward step from the level n (first step, or 
+        // dt changed)
+        bool startLeapFrog = true;
+        // m and f were scanned by the method since parameterFieldSet()
+        bool metricsUpToDate = false;
+        bool adaptiveDt;
+        double courantTarget;
+        double courantMax;
+        double dtMin;
+        double dtMax;
+        double stopTime = -1;
+        double courant = 0;
+        long dtChanges = 0;
+
+        CheckpointHeader checkpointHeader()
+        {
+            CheckpointHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, "PIFOCKP", 8);
+            header.version = 1;
+            header.valueSize = sizeof(value_type);
+            header.tendencySize = sizeof(tendency_type);
+            header.members = members;
+            header.tasks = atlas::mpi::comm().size();
+            header.rank = atlas::mpi::comm().rank();
+            header.points = functionSpace.size();
+            header.fields = checkpointFields().size();
+            header.dt = dt;
+            header.time = time;
+            header.steps = steps;
+            header.dtChanges = dtChanges;
+            header.startLeapFrog = startLeapFrog ? 1 : 0;
+            header.phiRef = stepping->getPhiRef();
+            return header;
+        }
 
-        void stepEuler()
-        {    
-            for (atlas::idx_t v=0;v<pronosticFields.size();v++)
+        /**
+         * Fields of the checkpoints and the size of their values. The level
+         * n+1 is not saved : every step writes all of its points.
+         */
+        std::vector<std::pair<atlas::Field, size_t>> checkpointFields()
+        {
+            std::vector<std::pair<atlas::Field, size_t>> fields;
+            for (int level : { -1, 0 })
+            {
+                for (auto field : { timeLevel(level).U, timeLevel(level).V, timeLevel(level).phi })
+                {
+                    fields.emplace_back(field, sizeof(value_type));
+                }
+            }
+            for (atlas::idx_t v=0;v<parameterFields.size();v++)
+            {
+                fields.emplace_back(parameterFields.field(v), sizeof(value_type));
+            }
+            for (auto* set : { &diagnosticFields, &internalFields })
             {
-                auto vv = pronosticFields.field(v);
-                auto var_t = internalFields.field(pronosticFields.field_names()[v]+"_t");
-                auto var_tdcy = internalFields.field(pronosticFields.field_names()[v]+"_tdcy");
-                a_bc(vv, var_tdcy, dt, var_t);
+                for (atlas::idx_t v=0;v<set->size();v++)
+                {
+                    fields.emplace_back(set->field(v), sizeof(tendency_type));
+                }
             }
+            return fields;
         }
 
-        void stepLeapFrog()
-        {             
-            for (atlas::idx_t v=0;v<pronosticFields.size();v++)
+        void updateMetrics()
+        {
+            if (!metricsUpToDate)
             {
-                auto var_t = internalFields.field(pronosticFields.field_names()[v]+"_t");
-                auto var_tdcy = internalFields.field(pronosticFields.field_names()[v]+"_tdcy");
-                a_bc(var_t, var_tdcy, 2*dt, var_t);
+                method->updateMetrics();
+                metricsUpToDate = true;
             }
         }
 
-        void a_bc(atlas::Field& a, atlas::Field& b, double c, atlas::Field& dest)
+        /**
+         * Run the next of up to count steps : the block that the stepping 
+         * strategy advances at once, or a single step(). onStep is called 
+         * with the model time after each step the strategy reports, or 
+         * after the step. The call at the end of the block comes once the
+         * levels, the time and the steps are those of its last step, so 
+         * that it can write a checkpoint. Returns the number of steps done.
+         */
+        int advanceBlock(int count, const std::function<void(double)>& onStep)
         {
-#ifndef PIFO_FAST_MODE
-            auto x = atlas::array::make_view<double, 1>(a);
-            auto y = atlas::array::make_view<double, 1>(b);
-            auto z = atlas::array::make_view<double, 1>(dest);
-#else
-            auto x = (double*)a.storage();
-            auto y = (double*)b.storage();
-            auto z = (double*)dest.storage();
-#endif
-            atlas::idx_t size = a.size();
-            #pragma omp parallel for 
-            for(atlas::idx_t i=0;i<size;i++)
+            int block = stepping->advanceSteps(count, startLeapFrog);
+            if (block<=0)
             {
-                z[i] = x[i]+c*y[i];
+                step();
+                onStep(time);
+                return 1;
             }
+
+            double start = time;
+            double stepDt = dt;
+            updateMetrics();
+            stepping->advance(
+                timeLevel(-1).fields, timeLevel(0).fields, timeLevel(1).fields,
+                K, internalFields, dt, block, startLeapFrog,
+                [&](int done)
+                {
+                    if (done<block)
+                    {
+                        onStep(start+done*stepDt);
+                    }
+                });
+            current = (current+block)%3;
+            startLeapFrog = false;
+
+            time += block*dt;
+            steps += block;
+            onStep(time);
+            return block;
         }
 
-        void swap(atlas::Field& a, atlas::Field& b)
+        static atlas::grid::Partitioner bandsPartitioner()
         {
-#ifndef PIFO_FAST_MODE
-            auto x = atlas::array::make_view<double, 1>(a);
-            auto y = atlas::array::make_view<double, 1>(b);
-#else
-            auto x = (double*)a.storage();
-            auto y = (double*)b.storage();
-#endif
-            atlas::idx_t size = a.size();
-            #pragma omp parallel for 
-            for(atlas::idx_t i=0;i<size;i++)
+            return atlas::grid::Partitioner(atlas::option::type("checkerboard") 
+                | atlas::util::Config("bands", (int)atlas::mpi::comm().size()));
+        }
+
+        /**
+         * Rows of the halos : sl_halo for the agrid_sl dynamics, whose 
+         * departure points are interpolated in the halos, one otherwise.
+         */
+        static int haloRows(const atlas::util::Config& config)
+        {
+            if (config.getString("dynamics", "agrid")=="agrid_sl")
+            {
+                return std::max(config.getInt("sl_halo", 3), 1);
+            }
+            return 1;
+        }
+
+        /**
+         * Field of the function space allocated with the allocation policy,
+         * of shape (points, levels) if levels>1. The memory belongs to the 
+         * model.
+         */
+        template <typename T>
+        atlas::Field createField(const std::string& name, int levels)
+        {
+            atlas::idx_t points = functionSpace.size();
+            buffers.emplace_back(new AlignedBuffer(sizeof(T)*points*levels, allocationPolicy));
+            auto data = (T*)buffers.back()->data();
+            atlas::Field field = levels>1 
+                ? atlas::Field(name, data, atlas::array::make_shape(points, levels))
+                : atlas::Field(name, data, atlas::array::make_shape(points));
+            field.set_functionspace(functionSpace);
+            if (levels>1)
+            {
+                field.set_levels(levels);
+            }
+            return field;
+        }
+
+        /**
+         * Fields of the given names, in separate arrays of getMembers() 
+         * levels, or interleaved in a single array with the interleaved 
+         * layout : the field k is then the array offset by k with a stride
+         * of names.size().
+         */
+        template <typename T>
+        std::vector<atlas::Field> createFields(const std::vector<std::string>& names)
+        {
+            std::vector<atlas::Field> fields;
+            if (!interleaved)
+            {
+                for (auto& name : names)
+                {
+                    fields.push_back(createField<T>(name, members));
+                }
+                return fields;
+            }
+            atlas::idx_t points = functionSpace.size();
+            atlas::idx_t components = names.size();
+            buffers.emplace_back(new AlignedBuffer(sizeof(T)*points*components, allocationPolicy));
+            auto data = (T*)buffers.back()->data();
+            for (atlas::idx_t k=0;k<components;k++)
+            {
+                atlas::Field field(names[k], data+k, atlas::array::ArraySpec(
+                    atlas::array::make_shape(points), atlas::array::make_strides(components)));
+                field.set_functionspace(functionSpace);
+                fields.push_back(field);
+            }
+            return fields;
+        }
+
+        /**
+         * Zero the array of one or more fields, each row being first written by the thread that runs
+         * it in the kernels (the static schedule of the parallel loops on 
+         * [getRowBegin(), getRowEnd())). With pinned threads (see 
+         * ThreadLayout), the pages of the rows are then allocated on the 
+         * socket of their thread, and the fields read later (scatter) are 
+         * written in place. The points outside these rows are zeroed by the
+         * master thread afterwards.
+         */
+        void firstTouch(AlignedBuffer& buffer)
+        {
+            auto data = (char*)buffer.data();
+            size_t pointBytes = buffer.size()/functionSpace.size();
+            size_t rowBytes = method->getNx()*pointBytes;
+            atlas::idx_t rowBegin = method->getRowBegin();
+            atlas::idx_t rowEnd = method->getRowEnd();
+            #pragma omp parallel for schedule(static)
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                std::memset(data+method->getRowIndex(y)*pointBytes, 0, rowBytes);
+                // the boundary or halo rows next to the first and last ones
+                if (y==rowBegin)
+                {
+                    std::memset(data+method->getRowIndex(y-1)*pointBytes, 0, rowBytes);
+                }
+                if (y==rowEnd-1)
+                {
+                    std::memset(data+method->getRowIndex(y+1)*pointBytes, 0, rowBytes);
+                }
+            }
+
+            std::vector<bool> touched(functionSpace.size(), false);
+            for (atlas::idx_t y=rowBegin-1;y<=rowEnd;++y)
             {
-                double tmp;
-                tmp = x[i];
-                x[i] = y[i];
-                y[i] = tmp;
+                std::fill_n(touched.begin()+method->getRowIndex(y), method->getNx(), true);
             }
+            for (atlas::idx_t i=0;i<functionSpace.size();i++)
+            {
+                if (!touched[i])
+                {
+                    std::memset(data+i*pointBytes, 0, pointBytes);
+                }
+            }
+        }
 
+        void exchangeHalo(atlas::FieldSet& fields)
+        {
+            for (atlas::idx_t v=0;v<fields.size();v++)
+            {
+                fields.field(v).set_dirty();
+            }
+            functionSpace.haloExchange(fields);
         }
 
-        void finalizeStep()
+        /**
+         * Adapt dt to the Courant number of the level n, before the step.
+         */
+        void adaptDt()
         {
-            for (atlas::idx_t v=0;v<pronosticFields.size();++v)
+            double rate = dynamics->takeCourantRate();
+            if (rate<0)
+            {
+                rate = courantRate(false);
+            }
+            if (stepping->explicitGravityWaves())
+            {
+                rate += courantRate(true);
+            }
+            atlas::mpi::comm().allReduceInPlace(rate, eckit::mpi::max());
+
+            double newDt = dt;
+            courant = dt*rate;
+            if (courant>courantMax || courant*1.25<courantTarget)
             {
-                swap(pronosticFields.field(pronosticFields.field_names()[v]), internalFields.field(pronosticFields.field_names()[v]+"_t"));
+                newDt = rate>0 ? courantTarget/rate : dtMax;
+            }
+            newDt = std::min(std::max(newDt, dtMin), dtMax);
+            if (stopTime>time && time+newDt>stopTime)
+            {
+                newDt = stopTime-time;
+            }
+            if (newDt!=dt)
+            {
+                setDt(newDt);
+                dtChanges++;
+                courant = dt*rate;
             }
         }
 
-        void calcU_tdcy()
+        /**
+         * Largest advective Courant rate m2 (|U|/dx + |V|/dy) of the level n
+         * on this partition, for the dynamics that don't reduce it in calcK,
+         * or the gravity wave one m sqrt(phi) sqrt(1/dx2 + 1/dy2).
+         */
+        double courantRate(bool gravity)
         {
-            dynamics->calcU_tdcy(pronosticFields.field("V"),
-                pronosticFields.field("phi"),
-                diagnosticFields.field("zeta"),
-                diagnosticFields.field("K"),
-                internalFields.field("U_tdcy"));
+            auto U = (const value_type*)timeLevel(0).U.storage();
+            auto V = (const value_type*)timeLevel(0).V.storage();
+            auto phi = (const value_type*)timeLevel(0).phi.storage();
+            auto m = (const value_type*)method->getM().storage();
+            double rdx = 1/method->getDx();
+            double rdy = 1/method->getDy();
+            double rdxy = std::sqrt(rdx*rdx+rdy*rdy);
+            atlas::idx_t nx = method->getNx();
+            double rate = 0;
+            #pragma omp parallel for reduction(max:rate)
+            for (atlas::idx_t y=method->getRowBegin();y<method->getRowEnd();++y)
+            {
+                atlas::idx_t row = method->getRowIndex(y);
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    double mm = m[row+x];
+                    for (int k=0;k<members;k++)
+                    {
+                        atlas::idx_t i = (row+x)*members+k;
+                        rate = std::max(rate, gravity 
+                            ? mm*std::sqrt(std::max((double)phi[i], 0.0))*rdxy
+                            : mm*mm*(std::abs((double)U[i])*rdx+std::abs((double)V[i])*rdy));
+                    }
+                }
+            }
+            return rate;
         }
 
-        void calcV_tdcy()
+        /**
+         * Time level n+offset, offset in [-1,1].
+         */
+        TimeLevel& timeLevel(int offset)
         {
-            dynamics->calcV_tdcy(pronosticFields.field("U"),
-                pronosticFields.field("phi"),
-                diagnosticFields.field("zeta"),
-                diagnosticFields.field("K"),
-                internalFields.field("V_tdcy"));
+            return timeLevels[(current+3+offset)%3];
         }
 
-        void calcphi_tdcy()
+        void calcTendencies()
         {
-            dynamics->calcphi_tdcy(
-                pronosticFields.field("U"),
-                pronosticFields.field("V"),
-                pronosticFields.field("phi"),
-                internalFields.field("phi_tdcy"));
+            dynamics->calcTendencies(
+                timeLevel(0).U,
+                timeLevel(0).V,
+                timeLevel(0).phi,
+                K,
+                zeta,
+                U_tdcy,
+                V_tdcy,
+                phi_tdcy);
         }
 
-        void calcK()
+        void calcTendencies(atlas::idx_t yBegin, atlas::idx_t yEnd)
         {
-            dynamics->calcK(pronosticFields.field("U"),
-                pronosticFields.field("V"),
-                diagnosticFields.field("K"));
+            dynamics->calcTendencies(
+                timeLevel(0).U,
+                timeLevel(0).V,
+                timeLevel(0).phi,
+                K,
+                zeta,
+                U_tdcy,
+                V_tdcy,
+                phi_tdcy,
+                yBegin, yEnd);
         }
 
-        void calcZeta()
+        void calcTendenciesOverlapped()
         {
-            dynamics->calcZeta(pronosticFields.field("U"),
-                pronosticFields.field("V"),
-                diagnosticFields.field("zeta"));
-       }
+            // rows [innerBegin, innerEnd) only read owned rows
+            atlas::idx_t rowBegin = method->getRowBegin();
+            atlas::idx_t rowEnd = method->getRowEnd();
+            atlas::idx_t innerBegin = std::max(rowBegin, functionSpace.j_begin()+1);
+            atlas::idx_t innerEnd = std::min(rowEnd, functionSpace.j_end()-1);
+            if (innerEnd<innerBegin) innerEnd = innerBegin;
+
+            auto t0 = std::chrono::steady_clock::now();
+            bandHaloExchange->start(timeLevel(0).fields);
+            auto t1 = std::chrono::steady_clock::now();
+            calcTendencies(innerBegin, innerEnd);
+            auto t2 = std::chrono::steady_clock::now();
+            bandHaloExchange->finish();
+            auto t3 = std::chrono::steady_clock::now();
+            calcTendencies(rowBegin, innerBegin);
+            calcTendencies(innerEnd, rowEnd);
+
+            haloExchangeTime += std::chrono::duration<double>((t1-t0)+(t3-t2)).count();
+            haloOverlapTime += std::chrono::duration<double>(t2-t1).count();
+        }
     };
+
+    typedef ModelT<DoublePrecision> Model;
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "model/PersistentRegion.h"
+#include "model/ProgressCounter.h"
+#include "atlas/parallel/omp/omp.h"
+#include <algorithm>
+#include <vector>
+
+namespace pifo {
+    PersistentRegion::PersistentRegion(const FusedAGridBarotropicDynamics& pDynamics,
+            const ConformalProjectionFiniteDifferenceMethod& pFdm,
+            const simd::StencilKernels& pKernels)
+        : dynamics(pDynamics), fdm(pFdm), kernels(pKernels)
+    {
+
+    }
+
+    void PersistentRegion::advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+            atlas::FieldSet& next, const atlas::Field& pK,
+            atlas::FieldSet& tendencies, double dt, int steps, bool forward,
+            const std::function<void(int)>& onStep) const
+    {
+        atlas::FieldSet* sets[3] = { &previous, &current, &next };
+        double* levels[3][3];
+        double* tdcy[3];
+        for (int v=0;v<3;v++)
+        {
+            for (int l=0;l<3;l++)
+            {
+                levels[l][v] = (double*)sets[l]->field(v).storage();
+            }
+            tdcy[v] = (double*)tendencies.field(v).storage();
+        }
+        auto K = (const double*)pK.storage();
+        atlas::idx_t nx = fdm.getNx();
+        atlas::idx_t ny = fdm.getNy();
+
+        int maxThreads = std::max(1, (int)std::min((atlas::idx_t)atlas_omp_get_max_threads(), ny));
+        // steps done by each thread
+        ProgressCounters progress;
+        progress.reset(maxThreads);
+
+        #pragma omp parallel num_threads(maxThreads)
+        {
+            int nthreads = atlas_omp_get_num_threads();
+            int thread = atlas_omp_get_thread_num();
+            atlas::idx_t y0 = ny*thread/nthreads;
+            atlas::idx_t y1 = ny*(thread+1)/nthreads;
+            std::vector<double> window(3*nx);
+
+            for (int s=0;s<steps;s++)
+            {
+                // the neighbouring bands are done with the step s-1
+                if (thread>0)
+                {
+                    progress[thread-1].waitFor(s);
+                }
+                if (thread<nthreads-1)
+                {
+                    progress[thread+1].waitFor(s);
+                }
+
+                bool forwardStep = forward && s==0;
+                double** old = forwardStep ? levels[1] : levels[s%3];
+                double** cur = levels[(s+1)%3];
+                double** upd = levels[(s+2)%3];
+                double c = forwardStep ? dt : 2*dt;
+                double* kPrev = window.data();
+                double* kCur = kPrev+nx;
+                double* kNext = kCur+nx;
+                atlas::idx_t lastRow = -2;
+
+                for (atlas::idx_t y=y0;y<y1;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    if (y>0 && y<ny-1)
+                    {
+                        if (y==lastRow+1)
+                        {
+                            double* tmp = kPrev;
+                            kPrev = kCur;
+                            kCur = kNext;
+                            kNext = tmp;
+                        }
+                        else
+                        {
+                            dynamics.calcKRow(cur[0], cur[1], K, y-1, kPrev);
+                            dynamics.calcKRow(cur[0], cur[1], K, y, kCur);
+                        }
+                        dynamics.calcKRow(cur[0], cur[1], K, y+1, kNext);
+                        lastRow = y;
+                        dynamics.calcTendencyRow(cur[0], cur[1], cur[2], kPrev, kCur, kNext, y,
+                            tdcy[0]+row, tdcy[1]+row, tdcy[2]+row);
+                    }
+
+                    // update of the whole row, boundaries included as in Model::stepLeapFrog
+                    for (int v=0;v<3;v++)
+                    {
+                        kernels.a_bc(old[v]+row, tdcy[v]+row, c, upd[v]+row, nx);
+                    }
+                }
+
+                progress[thread].set(s+1);
+                if (thread==0)
+                {
+                    onStep(s+1);
+                }
+            }
+        }
+    }
+}
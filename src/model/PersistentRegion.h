@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+
+#include "atlas/field.h"
+#include "model/fdm/FusedAGridBarotropicDynamics.h"
+#include "model/fdm/simd/StencilKernels.h"
+
+namespace pifo {
+    /**
+     * Leapfrog integration of a whole run in a single OpenMP parallel
+     * region.
+     *
+     * <p>Each thread owns a fixed band of rows for the whole run, computes
+     * the tendencies of its rows with the fused row kernels and updates
+     * them. Instead of a barrier, a thread only waits before a step for the
+     * threads of the bands above and below to have done the previous one :
+     * their last rows of the level n are then ready, and they no longer
+     * read the level n-2 that the step overwrites. A thread is thus at most
+     * one step ahead of its neighbours, and waits on their ProgressCounter.
+     * The team is forked once per run instead of several times per step.</p>
+     *
+     * <p>The master thread calls back between its steps, for the logging.
+     * Results are bit-identical to the step by step integration with the
+     * fused kernel. Needs a single partition, as TemporalBlocking.</p>
+     */
+    class PersistentRegion {
+    public:
+        PersistentRegion(const FusedAGridBarotropicDynamics& dynamics,
+            const ConformalProjectionFiniteDifferenceMethod& fdm,
+            const simd::StencilKernels& kernels);
+
+        /**
+         * Advance the integration by a given number of steps.
+         *
+         * <p>The time levels hold U, V and phi in this order, with the same
+         * rotation as TemporalBlocking::advance : the level n+steps ends up
+         * in the set of index (steps+1)%3 of (previous, current, next). If
+         * forward is true, the first step is a forward step from current
+         * (previous is then not read). onStep is called by the master thread
+         * with the number of steps done by its rows.</p>
+         */
+        void advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+            atlas::FieldSet& next, const atlas::Field& K,
+            atlas::FieldSet& tendencies, double dt, int steps, bool forward,
+            const std::function<void(int)>& onStep) const;
+
+    private:
+        const FusedAGridBarotropicDynamics& dynamics;
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        const simd::StencilKernels& kernels;
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace pifo {
+    /**
+     * Working precisions of the model.
+     *
+     * <p>value_type is the type the pronostic and parameter fields are
+     * stored in, tendency_type the type the diagnostics and the tendencies
+     * are computed and accumulated in.</p>
+     */
+    struct DoublePrecision {
+        typedef double value_type;
+        typedef double tendency_type;
+
+        static const char* name()
+        {
+            return "double";
+        }
+    };
+
+    struct SinglePrecision {
+        typedef float value_type;
+        typedef float tendency_type;
+
+        static const char* name()
+        {
+            return "single";
+        }
+    };
+
+    /**
+     * Fields stored in float, tendencies accumulated in double.
+     */
+    struct MixedPrecision {
+        typedef float value_type;
+        typedef double tendency_type;
+
+        static const char* name()
+        {
+            return "mixed";
+        }
+    };
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace pifo {
+    /**
+     * Busy wait until done() returns true, for the short waits between the
+     * threads of a team. Each poll is followed by a pause of the core (the
+     * sibling hyper-thread runs, the pipeline is not flushed at the exit),
+     * and after spinsBeforeYield polls the thread yields its core instead :
+     * a team larger than the cores does not livelock.
+     */
+    template <typename Condition>
+    void spinUntil(const Condition& done, int spinsBeforeYield = 1024)
+    {
+        int spins = 0;
+        while (!done())
+        {
+            if (spins<spinsBeforeYield)
+            {
+                spins++;
+#if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+#elif defined(__aarch64__)
+                asm volatile("yield");
+#endif
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Work done by a thread (rows, steps), published to the threads that
+     * wait for it. Aligned on a cache line, so that the threads don't share
+     * the lines they spin on : allocate the counters of a team with 
+     * ProgressCounters.
+     */
+    class alignas(64) ProgressCounter {
+    public:
+        ProgressCounter() : count(0)
+        {
+        }
+
+        void set(long value)
+        {
+            count.store(value, std::memory_order_release);
+        }
+
+        long get() const
+        {
+            return count.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Wait until the counter is at least value, see spinUntil().
+         */
+        void waitFor(long value) const
+        {
+            spinUntil([&] { return get()>=value; });
+        }
+
+    private:
+        std::atomic<long> count;
+    };
+
+    /**
+     * Counters of a team, on their own cache lines (new[] does not align
+     * the types aligned beyond the alignment of the heap before C++17).
+     * The memory is kept from one reset() to the next.
+     */
+    class ProgressCounters {
+    public:
+        ProgressCounters() = default;
+
+        ~ProgressCounters()
+        {
+            std::free(counters);
+        }
+
+        ProgressCounters(const ProgressCounters&) = delete;
+        ProgressCounters& operator=(const ProgressCounters&) = delete;
+
+        /**
+         * count counters at 0, allocated if more than the previous ones.
+         */
+        void reset(size_t count)
+        {
+            if (count>capacity)
+            {
+                void* memory = nullptr;
+                if (posix_memalign(&memory, alignof(ProgressCounter), count*sizeof(ProgressCounter))!=0)
+                {
+                    throw std::bad_alloc();
+                }
+                std::free(counters);
+                counters = (ProgressCounter*)memory;
+                capacity = count;
+                for (size_t i=0;i<count;i++)
+                {
+                    new (counters+i) ProgressCounter();
+                }
+            }
+            for (size_t i=0;i<count;i++)
+            {
+                counters[i].set(0);
+            }
+        }
+
+        ProgressCounter& operator[](size_t i) const
+        {
+            return counters[i];
+        }
+
+    private:
+        ProgressCounter* counters = nullptr;
+        size_t capacity = 0;
+    };
+}
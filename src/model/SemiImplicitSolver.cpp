@@ -0,0 +1,250 @@
+#include "model/SemiImplicitSolver.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace pifo {
+    SemiImplicitSolver::SemiImplicitSolver(const ConformalProjectionFiniteDifferenceMethod& pFdm,
+            double pPhiRef, double pTolerance, int pMaxIterations)
+        : fdm(pFdm), phiRef(pPhiRef), tolerance(pTolerance), maxIterations(pMaxIterations)
+    {
+        auto& functionSpace = fdm.getFunctionSpace();
+        for (auto field : { &b, &r, &z, &p, &q, &gx, &gy })
+        {
+            *field = functionSpace.createField<double>();
+            // the boundary and halo values that are not computed stay zero
+            std::memset(field->storage(), 0, field->size()*sizeof(double));
+        }
+    }
+
+    void SemiImplicitSolver::exchangeHalo(const atlas::Field& field) const
+    {
+        field.set_dirty();
+        fdm.getFunctionSpace().haloExchange(field);
+    }
+
+    void SemiImplicitSolver::step(const atlas::FieldSet& pPrevious, const atlas::FieldSet& pNow,
+            const atlas::FieldSet& pTendencies, double tau, atlas::FieldSet& pNext)
+    {
+        const double* Up = (const double*)pPrevious.field(0).storage();
+        const double* Vp = (const double*)pPrevious.field(1).storage();
+        const double* phip = (const double*)pPrevious.field(2).storage();
+        const double* Un = (const double*)pNow.field(0).storage();
+        const double* Vn = (const double*)pNow.field(1).storage();
+        const double* phin = (const double*)pNow.field(2).storage();
+        double* U = (double*)pNext.field(0).storage();
+        double* V = (double*)pNext.field(1).storage();
+        double* phi = (double*)pNext.field(2).storage();
+        const double* m = (const double*)fdm.getM().storage();
+        atlas::idx_t nx = fdm.getNx();
+        atlas::idx_t rowBegin = fdm.getRowBegin();
+        atlas::idx_t rowEnd = fdm.getRowEnd();
+        double dx2 = 2*fdm.getDx();
+        double dy2 = 2*fdm.getDy();
+        double h = tau/2;
+
+        if (phiRef<=0)
+        {
+            double phiMax = -std::numeric_limits<double>::max();
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    phiMax = std::max(phiMax, phin[row+x]);
+                }
+            }
+            atlas::mpi::comm().allReduceInPlace(phiMax, eckit::mpi::max());
+            phiRef = phiMax;
+        }
+
+        // explicit step everywhere, the boundary values are kept
+        for (atlas::idx_t v=0;v<3;v++)
+        {
+            auto x = (const double*)pPrevious.field(v).storage();
+            auto t = (const double*)pTendencies.field(v).storage();
+            auto y = (double*)pNext.field(v).storage();
+            atlas::idx_t size = pNext.field(v).size();
+            #pragma omp parallel for
+            for (atlas::idx_t i=0;i<size;i++)
+            {
+                y[i] = x[i] + tau*t[i];
+            }
+        }
+
+        // linear terms of the levels n-1 and n : next holds the explicit part
+        // of U(n+1), V(n+1) and phi(n+1)
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                U[i] -= h*((phip[i+1]-2*phin[i+1]) - (phip[i-1]-2*phin[i-1]))/dx2;
+                V[i] -= h*((phip[i+prev]-2*phin[i+prev]) - (phip[i+next]-2*phin[i+next]))/dy2;
+                double div = ((Up[i+1]-2*Un[i+1]) - (Up[i-1]-2*Un[i-1]))/dx2
+                    + ((Vp[i+prev]-2*Vn[i+prev]) - (Vp[i+next]-2*Vn[i+next]))/dy2;
+                phi[i] -= h*phiRef*m[i]*m[i]*div;
+            }
+        }
+        exchangeHalo(pNext.field(1));
+
+        // right hand side of the Helmholtz problem, the first guess is phi(n)
+        double* bb = (double*)b.storage();
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double div = (U[i+1]-U[i-1])/dx2 + (V[i+prev]-V[i+next])/dy2;
+                bb[i] = phi[i]/(m[i]*m[i]) - h*phiRef*div;
+                phi[i] = phin[i];
+            }
+        }
+        exchangeHalo(pNext.field(2));
+
+        // r = b - A(phi), z = r/diag(A), p = z
+        applyOperator(pNext.field(2), h, q);
+        double* rr = (double*)r.storage();
+        double* zz = (double*)z.storage();
+        double* pp = (double*)p.storage();
+        double* qq = (double*)q.storage();
+        double diag = h*h*phiRef*(2/(dx2*dx2)+2/(dy2*dy2));
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                rr[i] = bb[i]-qq[i];
+                zz[i] = rr[i]/(1/(m[i]*m[i])+diag);
+                pp[i] = zz[i];
+            }
+        }
+
+        double bNorm = std::sqrt(dot(b, b));
+        double rz = dot(r, z);
+        for (int k=0;k<maxIterations && std::sqrt(dot(r, r))>tolerance*bNorm;k++)
+        {
+            applyOperator(p, h, q);
+            double alpha = rz/dot(p, q);
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    atlas::idx_t i = row+x;
+                    phi[i] += alpha*pp[i];
+                    rr[i] -= alpha*qq[i];
+                    zz[i] = rr[i]/(1/(m[i]*m[i])+diag);
+                }
+            }
+            double rzNew = dot(r, z);
+            double beta = rzNew/rz;
+            rz = rzNew;
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    atlas::idx_t i = row+x;
+                    pp[i] = zz[i] + beta*pp[i];
+                }
+            }
+            iterations++;
+        }
+        exchangeHalo(pNext.field(2));
+
+        // back substitution of phi(n+1) in the momentum equations
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                U[i] -= h*(phi[i+1]-phi[i-1])/dx2;
+                V[i] -= h*(phi[i+prev]-phi[i+next])/dy2;
+            }
+        }
+    }
+
+    void SemiImplicitSolver::applyOperator(const atlas::Field& pphi, double h, atlas::Field& pq)
+    {
+        exchangeHalo(pphi);
+        auto phi = (const double*)pphi.storage();
+        auto q = (double*)pq.storage();
+        auto Gx = (double*)gx.storage();
+        auto Gy = (double*)gy.storage();
+        auto m = (const double*)fdm.getM().storage();
+        atlas::idx_t nx = fdm.getNx();
+        atlas::idx_t rowBegin = fdm.getRowBegin();
+        atlas::idx_t rowEnd = fdm.getRowEnd();
+        double dx2 = 2*fdm.getDx();
+        double dy2 = 2*fdm.getDy();
+
+        // the gradient is zero on the boundary, where U and V are not updated
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                Gx[i] = (phi[i+1]-phi[i-1])/dx2;
+                Gy[i] = (phi[i+prev]-phi[i+next])/dy2;
+            }
+        }
+        exchangeHalo(gy);
+
+        double c = h*h*phiRef;
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double div = (Gx[i+1]-Gx[i-1])/dx2 + (Gy[i+prev]-Gy[i+next])/dy2;
+                q[i] = phi[i]/(m[i]*m[i]) - c*div;
+            }
+        }
+    }
+
+    double SemiImplicitSolver::dot(const atlas::Field& pa, const atlas::Field& pb) const
+    {
+        auto a = (const double*)pa.storage();
+        auto b = (const double*)pb.storage();
+        atlas::idx_t nx = fdm.getNx();
+        double sum = 0;
+        #pragma omp parallel for reduction(+:sum)
+        for (atlas::idx_t y=fdm.getRowBegin();y<fdm.getRowEnd();++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                sum += a[row+x]*b[row+x];
+            }
+        }
+        atlas::mpi::comm().allReduceInPlace(sum, eckit::mpi::sum());
+        return sum;
+    }
+}
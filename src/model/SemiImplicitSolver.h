@@ -0,0 +1,99 @@
+#pragma once
+
+#include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
+#include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
+
+namespace pifo {
+    /**
+     * Semi-implicit treatment of the gravity waves for the leapfrog scheme.
+     *
+     * <p>The linear terms -grad(phi) of the momentum equations and
+     * -m2 phiRef div(U, V) of the geopotential equation are averaged between
+     * the levels n+1 and n-1 instead of being taken at the level n :</p>
+     *
+     * <pre>
+     * X(n+1) = X(n-1) + 2dt T(n) - dt L(X(n+1) + X(n-1) - 2 X(n))
+     * </pre>
+     *
+     * <p>where T is the full explicit tendency and L the linear terms.
+     * Eliminating U(n+1) and V(n+1) gives a Helmholtz problem for phi(n+1),
+     * phi/m2 - dt2 phiRef div(grad(phi)) = b, which is symmetric positive
+     * definite and solved by a Jacobi-preconditioned conjugate gradient.
+     * The boundary values are those of the explicit scheme, and used as
+     * Dirichlet conditions. The step is then stable for the gravity waves
+     * for any dt as long as phiRef is larger than phi.</p>
+     *
+     * <p>The first (Euler) step uses the same scheme with X(n-1) = X(n) and
+     * dt instead of 2dt (Crank-Nicolson on the linear terms).</p>
+     */
+    class SemiImplicitSolver {
+    public:
+        /**
+         * @param phiRef reference geopotential, taken as the maximum of phi
+         * at the first step if not positive
+         * @param tolerance relative residual of the Helmholtz problem
+         */
+        SemiImplicitSolver(const ConformalProjectionFiniteDifferenceMethod& fdm,
+            double phiRef, double tolerance, int maxIterations);
+
+        /**
+         * Compute next from the levels previous and now and the explicit
+         * tendencies at the level now, with the time step tau (2dt for
+         * leapfrog). Field sets hold U, V and phi in this order, with up to
+         * date halos.
+         */
+        void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+            const atlas::FieldSet& tendencies, double tau, atlas::FieldSet& next);
+
+        double getPhiRef() const
+        {
+            return phiRef;
+        }
+
+        /**
+         * Reference geopotential of a restarted run (see 
+         * ModelT::readCheckpoint), 0 to take it at the next step.
+         */
+        void setPhiRef(double pPhiRef)
+        {
+            phiRef = pPhiRef;
+        }
+
+        /**
+         * Conjugate gradient iterations since the construction.
+         */
+        long getIterations() const
+        {
+            return iterations;
+        }
+
+    private:
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        double phiRef;
+        double tolerance;
+        int maxIterations;
+        long iterations = 0;
+        // work fields : right hand side, residual, preconditioned residual,
+        // search direction, operator applied to it and gradient
+        atlas::Field b;
+        atlas::Field r;
+        atlas::Field z;
+        atlas::Field p;
+        atlas::Field q;
+        atlas::Field gx;
+        atlas::Field gy;
+
+        void exchangeHalo(const atlas::Field& field) const;
+
+        /**
+         * q = phi/m2 - h2 phiRef div(grad(phi)) on the interior points.
+         */
+        void applyOperator(const atlas::Field& phi, double h, atlas::Field& q);
+
+        /**
+         * Sum of a.b on the owned interior points of all the partitions.
+         */
+        double dot(const atlas::Field& a, const atlas::Field& b) const;
+    };
+}
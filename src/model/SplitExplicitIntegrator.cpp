@@ -0,0 +1,148 @@
+#include "model/SplitExplicitIntegrator.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pifo {
+    SplitExplicitIntegrator::SplitExplicitIntegrator(const ConformalProjectionFiniteDifferenceMethod& pFdm, int pSubsteps)
+        : fdm(pFdm), substeps(pSubsteps)
+    {
+
+    }
+
+    void SplitExplicitIntegrator::exchangeHalo(const atlas::Field& field) const
+    {
+        field.set_dirty();
+        fdm.getFunctionSpace().haloExchange(field);
+    }
+
+    int SplitExplicitIntegrator::stableSubsteps(const atlas::FieldSet& pNow, double tau) const
+    {
+        auto phi = (const double*)pNow.field(2).storage();
+        auto m = (const double*)fdm.getM().storage();
+        atlas::idx_t nx = fdm.getNx();
+        double c2 = 0;
+        #pragma omp parallel for reduction(max:c2)
+        for (atlas::idx_t y=fdm.getRowBegin();y<fdm.getRowEnd();++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                c2 = std::max(c2, phi[i]*m[i]*m[i]);
+            }
+        }
+        atlas::mpi::comm().allReduceInPlace(c2, eckit::mpi::max());
+        // forward-backward is stable up to dtau omega = 2, with a margin of 2
+        double omega = std::sqrt(c2*(1/(fdm.getDx()*fdm.getDx())+1/(fdm.getDy()*fdm.getDy())));
+        return std::max(1, (int)std::ceil(tau*omega));
+    }
+
+    void SplitExplicitIntegrator::step(const atlas::FieldSet& pPrevious, const atlas::FieldSet& pNow,
+            atlas::FieldSet& pTendencies, double tau, atlas::FieldSet& pNext)
+    {
+        const double* phin = (const double*)pNow.field(2).storage();
+        double* S_U = (double*)pTendencies.field(0).storage();
+        double* S_V = (double*)pTendencies.field(1).storage();
+        double* phi_tdcy = (double*)pTendencies.field(2).storage();
+        double* U = (double*)pNext.field(0).storage();
+        double* V = (double*)pNext.field(1).storage();
+        double* phi = (double*)pNext.field(2).storage();
+        const double* m = (const double*)fdm.getM().storage();
+        atlas::idx_t nx = fdm.getNx();
+        atlas::idx_t rowBegin = fdm.getRowBegin();
+        atlas::idx_t rowEnd = fdm.getRowEnd();
+        double dx2 = 2*fdm.getDx();
+        double dy2 = 2*fdm.getDy();
+
+        // explicit step everywhere for the boundary values
+        for (atlas::idx_t v=0;v<3;v++)
+        {
+            auto x = (const double*)pPrevious.field(v).storage();
+            auto t = (const double*)pTendencies.field(v).storage();
+            auto y = (double*)pNext.field(v).storage();
+            atlas::idx_t size = pNext.field(v).size();
+            #pragma omp parallel for
+            for (atlas::idx_t i=0;i<size;i++)
+            {
+                y[i] = x[i] + tau*t[i];
+            }
+        }
+
+        // the interior restarts from the level n-1
+        for (atlas::idx_t v=0;v<3;v++)
+        {
+            auto from = (const double*)pPrevious.field(v).storage();
+            auto to = (double*)pNext.field(v).storage();
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                std::copy(from+row+1, from+row+nx-1, to+row+1);
+            }
+        }
+
+        // slow tendencies : the pressure gradient of the level n is removed
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm.getRowIndex(y);
+            atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                S_U[i] += (phin[i+1]-phin[i-1])/dx2;
+                S_V[i] += (phin[i+prev]-phin[i+next])/dy2;
+            }
+        }
+
+        int n = substeps>0 ? substeps : stableSubsteps(pNow, tau);
+        double dtau = tau/n;
+        for (int k=0;k<n;k++)
+        {
+            exchangeHalo(pNext.field(2));
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    atlas::idx_t i = row+x;
+                    U[i] += dtau*(S_U[i] - (phi[i+1]-phi[i-1])/dx2);
+                    V[i] += dtau*(S_V[i] - (phi[i+prev]-phi[i+next])/dy2);
+                }
+            }
+
+            exchangeHalo(pNext.field(0));
+            exchangeHalo(pNext.field(1));
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    atlas::idx_t i = row+x;
+                    phi_tdcy[i] = -(m[i]*m[i])*(
+                            (phi[i+1]*U[i+1] - phi[i-1]*U[i-1])/dx2
+                            +(phi[i+prev]*V[i+prev] - phi[i+next]*V[i+next])/dy2
+                        );
+                }
+            }
+            #pragma omp parallel for
+            for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+            {
+                atlas::idx_t row = fdm.getRowIndex(y);
+                for (atlas::idx_t x=1;x<nx-1;++x)
+                {
+                    phi[row+x] += dtau*phi_tdcy[row+x];
+                }
+            }
+        }
+        totalSubsteps += n;
+    }
+}
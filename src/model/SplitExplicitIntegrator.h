@@ -0,0 +1,64 @@
+#pragma once
+
+#include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
+#include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
+
+namespace pifo {
+    /**
+     * Split-explicit leapfrog : the fast terms are sub-stepped, the slow
+     * ones advance on the long step.
+     *
+     * <p>The fast terms are the pressure gradient -grad(phi) of the momentum
+     * equations and the whole continuity equation. The slow terms, Coriolis,
+     * vorticity and kinetic energy, are the explicit tendencies at the level
+     * n minus the pressure gradient. From the level n-1, the step does
+     * substeps forward-backward steps of tau/substeps :</p>
+     *
+     * <pre>
+     * U += dtau (S_U - grad_x(phi)),  V += dtau (S_V - grad_y(phi))
+     * phi += dtau (-m2 div(phi (U, V)))
+     * </pre>
+     *
+     * <p>with the slow tendencies S held constant. Only the sub-steps are
+     * limited by the gravity waves. The boundary values are updated as in
+     * the explicit scheme.</p>
+     */
+    class SplitExplicitIntegrator {
+    public:
+        /**
+         * @param substeps sub-steps per step, or 0 to pick the smallest
+         * number stable for the gravity waves at each step
+         */
+        SplitExplicitIntegrator(const ConformalProjectionFiniteDifferenceMethod& fdm, int substeps);
+
+        /**
+         * Compute next from the level previous and the explicit tendencies
+         * at the level now, over the time tau (2dt for leapfrog). Field sets
+         * hold U, V and phi in this order, with up to date halos. The
+         * tendencies are modified.
+         */
+        void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+            atlas::FieldSet& tendencies, double tau, atlas::FieldSet& next);
+
+        /**
+         * Sub-steps done since the construction.
+         */
+        long getSubsteps() const
+        {
+            return totalSubsteps;
+        }
+
+    private:
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        int substeps;
+        long totalSubsteps = 0;
+
+        void exchangeHalo(const atlas::Field& field) const;
+
+        /**
+         * Sub-steps needed over tau by the fastest gravity wave of now.
+         */
+        int stableSubsteps(const atlas::FieldSet& now, double tau) const;
+    };
+}
@@ -0,0 +1,427 @@
+#include "model/SteppingStrategy.h"
+#include "model/TemporalBlocking.h"
+#include "model/TaskGraph.h"
+#include "model/PersistentRegion.h"
+#include "model/SemiImplicitSolver.h"
+#include "model/SplitExplicitIntegrator.h"
+#include "model/fdm/AGridBarotropicDynamics.h"
+#include "model/fdm/FusedAGridBarotropicDynamics.h"
+#include "model/fdm/SemiLagrangianBarotropicDynamics.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include "atlas/parallel/omp/omp.h"
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace pifo {
+    template <typename Precision>
+    SteppingStrategyT<Precision>::~SteppingStrategyT() = default;
+
+    template <typename Precision>
+    void SteppingStrategyT<Precision>::advance(atlas::FieldSet&, atlas::FieldSet&, atlas::FieldSet&,
+            const atlas::Field&, atlas::FieldSet&, double, int, bool, const std::function<void(int)>&)
+    {
+        throw std::runtime_error("pifo::SteppingStrategyT : "+describe()+" runs one step at a time");
+    }
+
+    namespace {
+        /**
+         * Explicit step, forward (Euler) or leapfrog : next = previous +
+         * tau tendencies, each field in a parallel sweep, or U, V and phi
+         * in one sweep of the interleaved layout.
+         */
+        template <typename Precision>
+        class ExplicitStepping : public SteppingStrategyT<Precision> {
+        public:
+            typedef typename Precision::value_type value_type;
+            typedef typename Precision::tendency_type tendency_type;
+
+            ExplicitStepping(const SteppingContext& context)
+                : kernels(context.kernels), interleaved(context.interleaved)
+            {
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=explicit";
+            }
+
+            virtual void step(const atlas::FieldSet& previous, const atlas::FieldSet&,
+                atlas::Field&, atlas::Field&, atlas::FieldSet& tendencies,
+                double tau, atlas::FieldSet& next)
+            {
+                if (interleaved)
+                {
+                    a_bc(previous.field(0), tendencies.field(0), tau, next.field(0), 3);
+                    return;
+                }
+                for (atlas::idx_t v=0;v<3;v++)
+                {
+                    a_bc(previous.field(v), tendencies.field(v), tau, next.field(v));
+                }
+            }
+
+        protected:
+            /**
+             * Requirements of the modes that run the explicit step with
+             * their own kernels.
+             */
+            static void requireSeparateLayout(const SteppingContext& context, const std::string& mode)
+            {
+                if (context.interleaved)
+                {
+                    throw std::runtime_error(mode+" needs the separate layout");
+                }
+            }
+
+        private:
+            const simd::StencilKernels& kernels;
+            bool interleaved;
+
+            /**
+             * dest = a + c b, on the arrays of components interleaved
+             * fields starting at a, b and dest.
+             */
+            void a_bc(const atlas::Field& a, const atlas::Field& b, double c, const atlas::Field& dest,
+                long components=1) const
+            {
+                auto x = (const value_type*)a.storage();
+                auto y = (const tendency_type*)b.storage();
+                auto z = (value_type*)dest.storage();
+                long size = a.size()*components;
+                #pragma omp parallel
+                {
+                    long nthreads = atlas_omp_get_num_threads();
+                    long thread = atlas_omp_get_thread_num();
+                    long begin = size*thread/nthreads;
+                    long end = size*(thread+1)/nthreads;
+                    a_bc(x+begin, y+begin, c, z+begin, end-begin);
+                }
+            }
+
+            void a_bc(const double* x, const double* y, double c, double* z, long n) const
+            {
+                kernels.a_bc(x, y, c, z, n);
+            }
+
+            template <typename V, typename T>
+            void a_bc(const V* x, const T* y, double c, V* z, long n) const
+            {
+                T tc = c;
+                for (long i=0;i<n;i++)
+                {
+                    z[i] = x[i] + tc*y[i];
+                }
+            }
+        };
+
+        /**
+         * The explicit step as a graph of OpenMP tasks, see TaskGraphT.
+         */
+        template <typename Precision>
+        class TaskGraphStepping : public SteppingStrategyT<Precision> {
+        public:
+            TaskGraphStepping(const atlas::util::Config& config, const SteppingContext& context)
+                : rows(config.getInt("task_rows", 16))
+            {
+                auto agrid = dynamic_cast<const AGridBarotropicDynamicsT<Precision>*>(&context.dynamics);
+                if (!agrid || dynamic_cast<const SemiLagrangianBarotropicDynamics*>(agrid))
+                {
+                    throw std::runtime_error("task_graph needs the row kernels of the A-grid dynamics");
+                }
+                if (!context.blockingHaloExchange || context.adaptiveDt || context.interleaved)
+                {
+                    throw std::runtime_error("task_graph needs blocking halo exchanges, a fixed dt and the separate layout");
+                }
+                taskGraph = std::unique_ptr<TaskGraphT<Precision>>(new TaskGraphT<Precision>(*agrid,
+                    context.method, context.kernels, rows));
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=explicit task_graph="+std::to_string(rows);
+            }
+
+            virtual bool computesTendencies() const
+            {
+                return true;
+            }
+
+            virtual void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+                atlas::Field& K, atlas::Field& zeta, atlas::FieldSet& tendencies,
+                double tau, atlas::FieldSet& next)
+            {
+                taskGraph->step(previous, now, K, zeta, tendencies, tau, next);
+            }
+
+        private:
+            int rows;
+            std::unique_ptr<TaskGraphT<Precision>> taskGraph;
+        };
+
+        /**
+         * Checks of the modes that run the fused kernels on a single
+         * partition, and the fused dynamics they run.
+         */
+        const FusedAGridBarotropicDynamics& fusedDynamics(const SteppingContext& context, const std::string& mode,
+            bool doublePrecision)
+        {
+            auto fused = dynamic_cast<const FusedAGridBarotropicDynamics*>(&context.dynamics);
+            if (!fused || !doublePrecision)
+            {
+                throw std::runtime_error(mode+" needs the agrid_fused dynamics in double precision");
+            }
+            if (atlas::mpi::comm().size()>1 || context.members>1 || context.adaptiveDt)
+            {
+                throw std::runtime_error(mode+" needs a single MPI task and member and a fixed dt");
+            }
+            return *fused;
+        }
+
+        /**
+         * Leapfrog steps in blocks of temporal_blocking steps, see
+         * TemporalBlocking. The forward steps are explicit steps.
+         */
+        template <typename Precision>
+        class TemporalBlockingStepping : public ExplicitStepping<Precision> {
+        public:
+            TemporalBlockingStepping(const atlas::util::Config& config, const SteppingContext& context)
+                : ExplicitStepping<Precision>(context),
+                blockSteps(config.getInt("temporal_blocking", 1)),
+                temporalBlocking(fusedDynamics(context, "temporal_blocking", std::is_same<Precision, DoublePrecision>::value),
+                    context.method, context.kernels)
+            {
+                ExplicitStepping<Precision>::requireSeparateLayout(context, "temporal_blocking");
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=explicit temporal_blocking="+std::to_string(blockSteps);
+            }
+
+            virtual int getBlockSteps() const
+            {
+                return blockSteps;
+            }
+
+            virtual int advanceSteps(int count, bool forward) const
+            {
+                return forward ? 0 : std::min(count, blockSteps);
+            }
+
+            virtual void advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+                atlas::FieldSet& next, const atlas::Field& K, atlas::FieldSet& tendencies,
+                double dt, int steps, bool, const std::function<void(int)>& onStep)
+            {
+                temporalBlocking.advance(previous, current, next, K, tendencies, dt, steps);
+                onStep(steps);
+            }
+
+        private:
+            int blockSteps;
+            TemporalBlocking temporalBlocking;
+        };
+
+        /**
+         * All the steps of a call in one parallel region, see
+         * PersistentRegion. Single steps are explicit steps.
+         */
+        template <typename Precision>
+        class PersistentRegionStepping : public ExplicitStepping<Precision> {
+        public:
+            PersistentRegionStepping(const SteppingContext& context)
+                : ExplicitStepping<Precision>(context),
+                persistentRegion(fusedDynamics(context, "persistent_region", std::is_same<Precision, DoublePrecision>::value),
+                    context.method, context.kernels)
+            {
+                ExplicitStepping<Precision>::requireSeparateLayout(context, "persistent_region");
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=explicit persistent_region=1";
+            }
+
+            virtual int advanceSteps(int count, bool) const
+            {
+                return count;
+            }
+
+            virtual void advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+                atlas::FieldSet& next, const atlas::Field& K, atlas::FieldSet& tendencies,
+                double dt, int steps, bool forward, const std::function<void(int)>& onStep)
+            {
+                persistentRegion.advance(previous, current, next, K, tendencies, dt, steps, forward, onStep);
+            }
+
+        private:
+            PersistentRegion persistentRegion;
+        };
+
+        /**
+         * Checks of the implicit and split schemes, which work on the
+         * double fields of a single member, and the method they work with.
+         */
+        const ConformalProjectionFiniteDifferenceMethod& schemeMethod(const SteppingContext& context,
+            const std::string& scheme, bool doublePrecision)
+        {
+            if (!doublePrecision || context.members>1 || context.interleaved)
+            {
+                throw std::runtime_error("the "+scheme+" time scheme needs double precision, a single member and the separate layout");
+            }
+            return context.method;
+        }
+
+        /**
+         * Semi-implicit leapfrog, see SemiImplicitSolver.
+         */
+        template <typename Precision>
+        class SemiImplicitStepping : public SteppingStrategyT<Precision> {
+        public:
+            SemiImplicitStepping(const atlas::util::Config& config, const SteppingContext& context)
+                : solver(schemeMethod(context, "semi_implicit", std::is_same<Precision, DoublePrecision>::value),
+                    config.getDouble("semi_implicit_phi", 0.0),
+                    config.getDouble("solver_tolerance", 1e-8),
+                    config.getInt("solver_max_iterations", 200))
+            {
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=semi_implicit";
+            }
+
+            virtual bool explicitGravityWaves() const
+            {
+                return false;
+            }
+
+            virtual void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+                atlas::Field&, atlas::Field&, atlas::FieldSet& tendencies,
+                double tau, atlas::FieldSet& next)
+            {
+                solver.step(previous, now, tendencies, tau, next);
+            }
+
+            virtual long getSolverIterations() const
+            {
+                return solver.getIterations();
+            }
+
+            virtual double getPhiRef() const
+            {
+                return solver.getPhiRef();
+            }
+
+            virtual void setPhiRef(double phiRef)
+            {
+                solver.setPhiRef(phiRef);
+            }
+
+        private:
+            SemiImplicitSolver solver;
+        };
+
+        /**
+         * Split-explicit leapfrog, see SplitExplicitIntegrator.
+         */
+        template <typename Precision>
+        class SplitExplicitStepping : public SteppingStrategyT<Precision> {
+        public:
+            SplitExplicitStepping(const atlas::util::Config& config, const SteppingContext& context)
+                : integrator(schemeMethod(context, "split_explicit", std::is_same<Precision, DoublePrecision>::value),
+                    config.getInt("substeps", 0))
+            {
+            }
+
+            virtual std::string describe() const
+            {
+                return "time_scheme=split_explicit";
+            }
+
+            virtual bool explicitGravityWaves() const
+            {
+                return false;
+            }
+
+            virtual void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+                atlas::Field&, atlas::Field&, atlas::FieldSet& tendencies,
+                double tau, atlas::FieldSet& next)
+            {
+                integrator.step(previous, now, tendencies, tau, next);
+            }
+
+            virtual long getSubsteps() const
+            {
+                return integrator.getSubsteps();
+            }
+
+        private:
+            SplitExplicitIntegrator integrator;
+        };
+    }
+
+    template <typename Precision>
+    std::unique_ptr<SteppingStrategyT<Precision>> SteppingStrategyT<Precision>::create(const atlas::util::Config& config,
+        const SteppingContext& context)
+    {
+        std::string timeScheme = config.getString("time_scheme", "explicit");
+        if (timeScheme!="explicit" && timeScheme!="semi_implicit" && timeScheme!="split_explicit")
+        {
+            throw std::runtime_error("unknown time_scheme '"+timeScheme+"'");
+        }
+        std::vector<std::string> modes;
+        if (timeScheme!="explicit")
+        {
+            modes.push_back("the "+timeScheme+" time scheme");
+        }
+        if (config.getInt("temporal_blocking", 1)>1)
+        {
+            modes.push_back("temporal_blocking");
+        }
+        if (config.getBool("task_graph", false))
+        {
+            modes.push_back("task_graph");
+        }
+        if (config.getBool("persistent_region", false))
+        {
+            modes.push_back("persistent_region");
+        }
+        if (modes.size()>1)
+        {
+            throw std::runtime_error(modes[0]+" and "+modes[1]+" can't be combined");
+        }
+
+        SteppingStrategyT* strategy;
+        if (timeScheme=="semi_implicit")
+        {
+            strategy = new SemiImplicitStepping<Precision>(config, context);
+        }
+        else if (timeScheme=="split_explicit")
+        {
+            strategy = new SplitExplicitStepping<Precision>(config, context);
+        }
+        else if (config.getInt("temporal_blocking", 1)>1)
+        {
+            strategy = new TemporalBlockingStepping<Precision>(config, context);
+        }
+        else if (config.getBool("task_graph", false))
+        {
+            strategy = new TaskGraphStepping<Precision>(config, context);
+        }
+        else if (config.getBool("persistent_region", false))
+        {
+            strategy = new PersistentRegionStepping<Precision>(context);
+        }
+        else
+        {
+            strategy = new ExplicitStepping<Precision>(context);
+        }
+        return std::unique_ptr<SteppingStrategyT>(strategy);
+    }
+
+    template class SteppingStrategyT<DoublePrecision>;
+    template class SteppingStrategyT<SinglePrecision>;
+    template class SteppingStrategyT<MixedPrecision>;
+}
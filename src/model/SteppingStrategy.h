@@ -0,0 +1,146 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
+#include "atlas/util/Config.h"
+#include "model/Precision.h"
+#include "model/BarotropicDynamics.h"
+#include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
+#include "model/fdm/simd/StencilKernels.h"
+
+namespace pifo {
+    /**
+     * The parts of the model a SteppingStrategyT works with, and the
+     * settings of the model its requirements are checked against.
+     */
+    struct SteppingContext {
+        const BarotropicDynamicsImpl& dynamics;
+        const ConformalProjectionFiniteDifferenceMethod& method;
+        const simd::StencilKernels& kernels;
+        int members;
+        // the interleaved layout of the fields
+        bool interleaved;
+        // halo_exchange blocking
+        bool blockingHaloExchange;
+        bool adaptiveDt;
+    };
+
+    /**
+     * How the model advances its pronostic fields once the dynamics
+     * computed the tendencies : the time scheme (explicit, semi_implicit,
+     * split_explicit) and the execution mode of the explicit one (step by
+     * step, task_graph, temporal_blocking or persistent_region).
+     *
+     * <p>create() selects the strategy from the configuration of the model,
+     * at most one of the modes other than the explicit step by step one.
+     * Each strategy checks its own requirements on the dynamics, the
+     * precision and the context in its constructor, and throws
+     * std::runtime_error if they are not met.</p>
+     *
+     * <p>Every strategy runs single steps with step(). The strategies that
+     * run several steps in one sweep of the grid (temporal blocking, the
+     * persistent region) also implement advance(), the model then calls it
+     * for the steps that advanceSteps() returns.</p>
+     */
+    template <typename Precision>
+    class SteppingStrategyT {
+    public:
+        virtual ~SteppingStrategyT();
+
+        static std::unique_ptr<SteppingStrategyT> create(const atlas::util::Config& config,
+            const SteppingContext& context);
+
+        /**
+         * Keys of the strategy for the log of the model.
+         */
+        virtual std::string describe() const = 0;
+
+        /**
+         * True if step() computes the tendencies of now itself : the model
+         * then only exchanges the halos before it.
+         */
+        virtual bool computesTendencies() const
+        {
+            return false;
+        }
+
+        /**
+         * True if the gravity waves are explicit, and thus limit the
+         * Courant number of adaptive_dt.
+         */
+        virtual bool explicitGravityWaves() const
+        {
+            return true;
+        }
+
+        /**
+         * Compute next from the level previous and the tendencies of the
+         * level now, over the time tau (previous = now and tau = dt for a
+         * forward step, the level n-1 and 2dt for leapfrog). Field sets
+         * hold U, V and phi in this order, now with up to date halos.
+         */
+        virtual void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+            atlas::Field& K, atlas::Field& zeta, atlas::FieldSet& tendencies,
+            double tau, atlas::FieldSet& next) = 0;
+
+        /**
+         * Steps that advance() runs in one sweep of the grid, 1 for the
+         * strategies that step one at a time.
+         */
+        virtual int getBlockSteps() const
+        {
+            return 1;
+        }
+
+        /**
+         * Number of the next count steps that advance() runs, forward if
+         * the first one is a forward step. 0 if they are run by step().
+         */
+        virtual int advanceSteps(int /*count*/, bool /*forward*/) const
+        {
+            return 0;
+        }
+
+        /**
+         * Advance the integration by steps steps, as returned by
+         * advanceSteps(). The level n+steps ends up in the set of index
+         * (steps+1)%3 of (previous, current, next), see
+         * TemporalBlocking::advance. onStep is called with the number of
+         * steps done, at least once at the end.
+         */
+        virtual void advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+            atlas::FieldSet& next, const atlas::Field& K, atlas::FieldSet& tendencies,
+            double dt, int steps, bool forward, const std::function<void(int)>& onStep);
+
+        /**
+         * Iterations of the Helmholtz solver of the semi-implicit scheme,
+         * sub-steps of the split-explicit one (0 with the other ones).
+         */
+        virtual long getSolverIterations() const
+        {
+            return 0;
+        }
+
+        virtual long getSubsteps() const
+        {
+            return 0;
+        }
+
+        /**
+         * Reference geopotential of the semi-implicit scheme, saved in the
+         * checkpoints (0 with the other schemes, which ignore setPhiRef).
+         */
+        virtual double getPhiRef() const
+        {
+            return 0;
+        }
+
+        virtual void setPhiRef(double)
+        {
+        }
+    };
+}
@@ -0,0 +1,143 @@
+#include "model/TaskGraph.h"
+#include <algorithm>
+
+namespace pifo {
+    template <typename Precision>
+    TaskGraphT<Precision>::TaskGraphT(const AGridBarotropicDynamicsT<Precision>& pDynamics,
+            const ConformalProjectionFiniteDifferenceMethod& pFdm,
+            const simd::StencilKernels& pKernels, int rows)
+        : dynamics(pDynamics), fdm(pFdm), kernels(pKernels)
+    {
+        rows = std::max(rows, 1);
+        for (atlas::idx_t y=fdm.getRowBegin();y<fdm.getRowEnd();y+=rows)
+        {
+            blockRows.push_back(y);
+        }
+        blockRows.push_back(fdm.getRowEnd());
+    }
+
+    template <typename Precision>
+    void TaskGraphT<Precision>::update(const atlas::Field& px, const atlas::Field& py, double c,
+            atlas::Field& pz, atlas::idx_t begin, atlas::idx_t end) const
+    {
+        auto x = (const value_type*)px.storage();
+        auto y = (const tendency_type*)py.storage();
+        auto z = (value_type*)pz.storage();
+        tendency_type tc = c;
+        for (atlas::idx_t i=begin;i<end;i++)
+        {
+            z[i] = x[i] + tc*y[i];
+        }
+    }
+
+    template <>
+    void TaskGraphT<DoublePrecision>::update(const atlas::Field& px, const atlas::Field& py, double c,
+            atlas::Field& pz, atlas::idx_t begin, atlas::idx_t end) const
+    {
+        auto x = (const double*)px.storage();
+        auto y = (const double*)py.storage();
+        auto z = (double*)pz.storage();
+        kernels.a_bc(x+begin, y+begin, c, z+begin, end-begin);
+    }
+
+    template <typename Precision>
+    void TaskGraphT<Precision>::step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+            atlas::Field& K, atlas::Field& zeta, atlas::FieldSet& tendencies,
+            double tau, atlas::FieldSet& next) const
+    {
+        const atlas::Field& U = now.field(0);
+        const atlas::Field& V = now.field(1);
+        const atlas::Field& phi = now.field(2);
+        atlas::Field U_tdcy = tendencies.field(0);
+        atlas::Field V_tdcy = tendencies.field(1);
+        atlas::Field phi_tdcy = tendencies.field(2);
+        atlas::idx_t blocks = blockRows.size()-1;
+        atlas::idx_t ny = fdm.getNy();
+        if (blocks<1)
+        {
+            // no interior rows on this partition : its boundary and halo
+            // points are still updated, as by the plain step
+            for (int v=0;v<3;v++)
+            {
+                update(previous.field(v), tendencies.field(v), tau, next.field(v), 0, U.size());
+            }
+            return;
+        }
+
+        // points updated by each block : the owned rows are contiguous, the
+        // first and last blocks take the boundary and halo points as well
+        atlas::idx_t width = U.size()/fdm.getFunctionSpace().size();
+        std::vector<atlas::idx_t> blockPoints(blocks+1);
+        blockPoints[0] = 0;
+        for (atlas::idx_t b=1;b<blocks;b++)
+        {
+            blockPoints[b] = fdm.getRowIndex(blockRows[b])*width;
+        }
+        blockPoints[blocks] = U.size();
+
+        // dependency tokens of the kernels of each block
+        std::vector<char> tokens(5*blocks);
+        char* kDone = tokens.data();
+        char* zetaDone = kDone+blocks;
+        char* uDone = zetaDone+blocks;
+        char* vDone = uDone+blocks;
+        char* phiDone = vDone+blocks;
+
+        #pragma omp parallel
+        #pragma omp single
+        {
+            for (atlas::idx_t b=0;b<=blocks;b++)
+            {
+                if (b<blocks)
+                {
+                    atlas::idx_t y0 = blockRows[b];
+                    atlas::idx_t y1 = blockRows[b+1];
+                    atlas::idx_t k0 = b==0 ? std::max(y0-1, (atlas::idx_t)1) : y0;
+                    atlas::idx_t k1 = b==blocks-1 ? std::min(y1+1, ny-1) : y1;
+                    atlas::idx_t p0 = blockPoints[b];
+                    atlas::idx_t p1 = blockPoints[b+1];
+
+                    #pragma omp task depend(out: kDone[b]) firstprivate(k0, k1) shared(K)
+                    dynamics.calcK(U, V, K, k0, k1);
+
+                    #pragma omp task depend(out: zetaDone[b]) firstprivate(y0, y1) shared(zeta)
+                    dynamics.calcZeta(U, V, zeta, y0, y1);
+
+                    #pragma omp task depend(out: phiDone[b]) firstprivate(y0, y1) shared(phi_tdcy)
+                    dynamics.calcphi_tdcy(U, V, phi, phi_tdcy, y0, y1);
+
+                    #pragma omp task depend(in: kDone[b], zetaDone[b]) depend(out: uDone[b]) firstprivate(y0, y1) shared(K, zeta, U_tdcy)
+                    dynamics.calcU_tdcy(V, phi, zeta, K, U_tdcy, y0, y1);
+
+                    #pragma omp task depend(in: uDone[b]) firstprivate(p0, p1) shared(U_tdcy)
+                    update(previous.field(0), U_tdcy, tau, next.field(0), p0, p1);
+
+                    #pragma omp task depend(in: phiDone[b]) firstprivate(p0, p1) shared(phi_tdcy)
+                    update(previous.field(2), phi_tdcy, tau, next.field(2), p0, p1);
+                }
+                if (b>0)
+                {
+                    // V_tdcy reads K on the rows above and below the block,
+                    // its task comes once K of the next block is created
+                    atlas::idx_t c = b-1;
+                    atlas::idx_t y0 = blockRows[c];
+                    atlas::idx_t y1 = blockRows[c+1];
+                    atlas::idx_t p0 = blockPoints[c];
+                    atlas::idx_t p1 = blockPoints[c+1];
+                    atlas::idx_t above = std::max(c-1, (atlas::idx_t)0);
+                    atlas::idx_t below = std::min(c+1, blocks-1);
+
+                    #pragma omp task depend(in: kDone[above], kDone[c], kDone[below], zetaDone[c]) depend(out: vDone[c]) firstprivate(y0, y1) shared(K, zeta, V_tdcy)
+                    dynamics.calcV_tdcy(U, phi, zeta, K, V_tdcy, y0, y1);
+
+                    #pragma omp task depend(in: vDone[c]) firstprivate(p0, p1) shared(V_tdcy)
+                    update(previous.field(1), V_tdcy, tau, next.field(1), p0, p1);
+                }
+            }
+        }
+    }
+
+    template class TaskGraphT<DoublePrecision>;
+    template class TaskGraphT<SinglePrecision>;
+    template class TaskGraphT<MixedPrecision>;
+}
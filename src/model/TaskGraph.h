@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "atlas/field.h"
+#include "atlas/field/FieldSet.h"
+#include "model/Precision.h"
+#include "model/fdm/AGridBarotropicDynamics.h"
+#include "model/fdm/simd/StencilKernels.h"
+
+namespace pifo {
+    /**
+     * Explicit step expressed as a graph of OpenMP tasks on blocks of rows.
+     *
+     * <p>Each kernel of the A-grid dynamics is a task per block of rows,
+     * ordered by the data it reads : K and zeta of a block are independent,
+     * phi_tdcy needs neither, U_tdcy needs K and zeta of its block, V_tdcy
+     * needs K of the neighbouring blocks as well, and the update of each
+     * variable only needs its own tendency on the block. The runtime then
+     * overlaps independent kernels and blocks instead of waiting at the
+     * barrier of each parallel loop. The tasks are created block after
+     * block, so the blocks of the top of the grid are updated while the
+     * bottom ones are still computing their tendencies.</p>
+     *
+     * <p>The kernels are the row variants of AGridBarotropicDynamicsT (or
+     * of its subclasses), called from inside the tasks : their own parallel
+     * loops run on one thread as long as nested parallelism is disabled
+     * (the default). K is computed on the halo rows next to the band, so it
+     * needs no halo exchange. Results are bit-identical to the step by step
+     * kernels.</p>
+     */
+    template <typename Precision>
+    class TaskGraphT {
+    public:
+        typedef typename Precision::value_type value_type;
+        typedef typename Precision::tendency_type tendency_type;
+
+        /**
+         * @param rows number of rows of a block
+         */
+        TaskGraphT(const AGridBarotropicDynamicsT<Precision>& dynamics,
+            const ConformalProjectionFiniteDifferenceMethod& fdm,
+            const simd::StencilKernels& kernels, int rows);
+
+        /**
+         * Compute the tendencies of now and next = previous + tau tendencies
+         * (previous = now and tau = dt for a forward step, the level n-1 and
+         * 2dt for leapfrog). Field sets hold U, V and phi in this order, now
+         * with up to date halos.
+         */
+        void step(const atlas::FieldSet& previous, const atlas::FieldSet& now,
+            atlas::Field& K, atlas::Field& zeta, atlas::FieldSet& tendencies,
+            double tau, atlas::FieldSet& next) const;
+
+    private:
+        const AGridBarotropicDynamicsT<Precision>& dynamics;
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        const simd::StencilKernels& kernels;
+        // first row of each block, and the end of the last one
+        std::vector<atlas::idx_t> blockRows;
+
+        /**
+         * z = x + c y on the points [begin, end).
+         */
+        void update(const atlas::Field& x, const atlas::Field& y, double c,
+            atlas::Field& z, atlas::idx_t begin, atlas::idx_t end) const;
+    };
+}
@@ -0,0 +1,130 @@
+#include "model/TemporalBlocking.h"
+#include "atlas/parallel/omp/omp.h"
+#include <algorithm>
+#include <vector>
+
+namespace pifo {
+    namespace {
+        // rows of a tile per thread of a group : the window of K is started
+        // again at each slice of rows, with two more rows
+        const atlas::idx_t tileRowsPerThread = 8;
+    }
+
+    TemporalBlocking::TemporalBlocking(const FusedAGridBarotropicDynamics& pDynamics,
+            const ConformalProjectionFiniteDifferenceMethod& pFdm,
+            const simd::StencilKernels& pKernels)
+        : dynamics(pDynamics), fdm(pFdm), kernels(pKernels)
+    {
+
+    }
+
+    void TemporalBlocking::advance(atlas::FieldSet& previous, atlas::FieldSet& current,
+            atlas::FieldSet& next, const atlas::Field& pK,
+            atlas::FieldSet& tendencies, double dt, int steps) const
+    {
+        atlas::FieldSet* sets[3] = { &previous, &current, &next };
+        double* levels[3][3];
+        double* tdcy[3];
+        for (int v=0;v<3;v++)
+        {
+            for (int l=0;l<3;l++)
+            {
+                levels[l][v] = (double*)sets[l]->field(v).storage();
+            }
+            tdcy[v] = (double*)tendencies.field(v).storage();
+        }
+        auto K = (const double*)pK.storage();
+        atlas::idx_t nx = fdm.getNx();
+        atlas::idx_t ny = fdm.getNy();
+
+        // rows done by each thread of the group of each step
+        int maxThreads = std::max(atlas_omp_get_max_threads(), 1);
+        int maxGroupSize = (maxThreads+std::min(maxThreads, steps)-1)/std::min(maxThreads, steps);
+        progress.reset(steps*maxGroupSize);
+
+        #pragma omp parallel num_threads(maxThreads)
+        {
+            int nthreads = atlas_omp_get_num_threads();
+            int thread = atlas_omp_get_thread_num();
+            // the threads in groups of consecutive threads, a group for
+            // each step. With less threads than steps, a thread runs
+            // several steps in sequence : a step only waits for the
+            // previous one, so this can't dead-lock.
+            int groups = std::min(nthreads, steps);
+            auto groupBegin = [&](int g) { return nthreads*g/groups; };
+            int group = 0;
+            while (groupBegin(group+1)<=thread)
+            {
+                group++;
+            }
+            int member = thread-groupBegin(group);
+            int groupSize = groupBegin(group+1)-groupBegin(group);
+            atlas::idx_t tileRows = tileRowsPerThread*groupSize;
+            std::vector<double> window(3*nx);
+
+            for (int s=group;s<steps;s+=groups)
+            {
+                double** old = levels[s%3];
+                double** cur = levels[(s+1)%3];
+                double** upd = levels[(s+2)%3];
+                int previousGroup = (s+groups-1)%groups;
+                int previousSize = groupBegin(previousGroup+1)-groupBegin(previousGroup);
+
+                // the tiles of rows in order, each shared by the group
+                for (atlas::idx_t t0=0;t0<ny;t0+=tileRows)
+                {
+                    atlas::idx_t t1 = std::min(t0+tileRows, ny);
+                    atlas::idx_t y0 = t0+(t1-t0)*member/groupSize;
+                    atlas::idx_t y1 = t0+(t1-t0)*(member+1)/groupSize;
+                    if (s>0 && y1>y0)
+                    {
+                        // the row y of the step reads the rows up to y+1
+                        // of the previous step
+                        atlas::idx_t needed = std::min(y1+1, ny);
+                        for (int m=0;m<previousSize;m++)
+                        {
+                            progress[(s-1)*maxGroupSize+m].waitFor(needed);
+                        }
+                    }
+
+                    double* kPrev = window.data();
+                    double* kCur = kPrev+nx;
+                    double* kNext = kCur+nx;
+                    atlas::idx_t lastRow = -2;
+                    for (atlas::idx_t y=y0;y<y1;++y)
+                    {
+                        atlas::idx_t row = fdm.getRowIndex(y);
+                        if (y>0 && y<ny-1)
+                        {
+                            if (y==lastRow+1)
+                            {
+                                double* tmp = kPrev;
+                                kPrev = kCur;
+                                kCur = kNext;
+                                kNext = tmp;
+                            }
+                            else
+                            {
+                                dynamics.calcKRow(cur[0], cur[1], K, y-1, kPrev);
+                                dynamics.calcKRow(cur[0], cur[1], K, y, kCur);
+                            }
+                            dynamics.calcKRow(cur[0], cur[1], K, y+1, kNext);
+                            lastRow = y;
+                            dynamics.calcTendencyRow(cur[0], cur[1], cur[2], kPrev, kCur, kNext, y,
+                                tdcy[0]+row, tdcy[1]+row, tdcy[2]+row);
+                        }
+
+                        // leapfrog update of the whole row, boundaries included as in Model::stepLeapFrog
+                        for (int v=0;v<3;v++)
+                        {
+                            kernels.a_bc(old[v]+row, tdcy[v]+row, 2*dt, upd[v]+row, nx);
+                        }
+                    }
+
+                    // all the rows before t1 are done once the whole group is
+                    progress[s*maxGroupSize+member].set(t1);
+                }
+            }
+        }
+    }
+}
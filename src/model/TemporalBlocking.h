@@ -0,0 +1,57 @@
+#pragma once
+
+#include "atlas/field.h"
+#include "model/ProgressCounter.h"
+#include "model/fdm/FusedAGridBarotropicDynamics.h"
+#include "model/fdm/simd/StencilKernels.h"
+
+namespace pifo {
+    /**
+     * Leapfrog integration of several steps in one sweep of the grid 
+     * (pipelined wavefront temporal blocking).
+     * 
+     * <p>The threads are split in groups of consecutive threads, one group
+     * per step. A group advances the whole grid by its step, tile of rows 
+     * after tile of rows, each thread of the group computing a slice of 
+     * the tile, and follows the group of the previous step two rows 
+     * behind : the row y of step s is computed as soon as the rows up to 
+     * y+1 of step s-1 are done. The rows touched by all the steps of a 
+     * block thus stay in the shared cache, and the state is streamed from
+     * memory once per block instead of once per step, with all the 
+     * threads busy. With less threads than steps, a thread runs several 
+     * steps in sequence.</p>
+     * 
+     * <p>The steps rotate through the three time levels of the model : the 
+     * level n+1 written by a step holds the level n-2, which is no longer 
+     * read once the previous step is two rows ahead. Results are 
+     * bit-identical to the step by step integration with the fused 
+     * kernel.</p>
+     * 
+     * <p>Needs a single partition (the halos would have to be as deep as the
+     * number of steps of a block).</p>
+     */
+    class TemporalBlocking {
+    public:
+        TemporalBlocking(const FusedAGridBarotropicDynamics& dynamics, 
+            const ConformalProjectionFiniteDifferenceMethod& fdm, 
+            const simd::StencilKernels& kernels);
+
+        /**
+         * Advance the leapfrog integration by a given number of steps.
+         * 
+         * <p>The time levels hold U, V and phi in this order. The level 
+         * n+steps ends up in the set of index (steps+1)%3 of (previous, 
+         * current, next), and the tendencies are used as work fields.</p>
+         */
+        void advance(atlas::FieldSet& previous, atlas::FieldSet& current, 
+            atlas::FieldSet& next, const atlas::Field& K, 
+            atlas::FieldSet& tendencies, double dt, int steps) const;
+
+    private:
+        const FusedAGridBarotropicDynamics& dynamics;
+        const ConformalProjectionFiniteDifferenceMethod& fdm;
+        const simd::StencilKernels& kernels;
+        // rows done by each thread of each step, kept between the blocks
+        mutable ProgressCounters progress;
+    };
+}
@@ -1,16 +1,67 @@
 #include "model/fdm/AGridBarotropicDynamics.h"
 #include "model/fdm/ConformalProjectionFiniteDifferenceMethod.h"
-#include "atlas/array/ArrayView.h"
+#include "model/fdm/AGridKernels.h"
+#include "atlas/runtime/Log.h"
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+// Row lengths for which the kernels are also built with a constant trip 
+// count, as a comma separated list (see src/model/CMakeLists.txt).
+#ifndef PIFO_FIXED_NX
+#define PIFO_FIXED_NX
+#endif
 
 namespace pifo {
-    AGridBarotropicDynamics::AGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
-        : AGridBarotropicDynamics(pMethod, atlas::util::NoConfig())
+    namespace {
+        template <typename Precision, class Access, class Extents>
+        const AGridKernelTable<Precision>& kernelTable(atlas::idx_t nx)
+        {
+            typedef agrid::Kernels<Precision, Access, Extents> Kernels;
+            static const AGridKernelTable<Precision> table = { 
+                Access::name(), nx, &Kernels::calcK, &Kernels::calcZeta, 
+                &Kernels::calcU_tdcy, &Kernels::calcV_tdcy, &Kernels::calcphi_tdcy 
+            };
+            return table;
+        }
+
+        template <atlas::idx_t... NX>
+        struct FixedRowLengths;
+
+        template <>
+        struct FixedRowLengths<> {
+            template <typename Precision, class Access>
+            static const AGridKernelTable<Precision>& select(atlas::idx_t)
+            {
+                return kernelTable<Precision, Access, agrid::RuntimeExtents>(0);
+            }
+        };
+
+        template <atlas::idx_t N, atlas::idx_t... Rest>
+        struct FixedRowLengths<N, Rest...> {
+            template <typename Precision, class Access>
+            static const AGridKernelTable<Precision>& select(atlas::idx_t nx)
+            {
+                if (nx==N)
+                {
+                    return kernelTable<Precision, Access, agrid::FixedExtents<N>>(N);
+                }
+                return FixedRowLengths<Rest...>::template select<Precision, Access>(nx);
+            }
+        };
+
+        typedef FixedRowLengths<PIFO_FIXED_NX> fixedRowLengths;
+    }
+
+    template <typename Precision>
+    AGridBarotropicDynamicsT<Precision>::AGridBarotropicDynamicsT(const atlas::numerics::Method& pMethod)
+        : AGridBarotropicDynamicsT(pMethod, atlas::util::NoConfig())
     {
 
     }
 
-    AGridBarotropicDynamics::AGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+    template <typename Precision>
+    AGridBarotropicDynamicsT<Precision>::AGridBarotropicDynamicsT(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
         : BarotropicDynamicsImpl(pMethod, pParam)
     {
         fdm = dynamic_cast<const pifo::ConformalProjectionFiniteDifferenceMethod*>( &pMethod );
@@ -21,184 +72,191 @@ namespace pifo {
         
         dx = fdm->getDx();
         dy = fdm->getDy();
+
+        std::string access = "checked";
+        pParam.get("array_access", access);
+        if (access=="checked")
+        {
+            agridKernels = &fixedRowLengths::select<Precision, agrid::CheckedAccess>(fdm->getNx());
+        }
+        else if (access=="raw")
+        {
+            agridKernels = &fixedRowLengths::select<Precision, agrid::RawAccess>(fdm->getNx());
+        }
+        else
+        {
+            throw std::runtime_error("unknown array_access '"+access+"'");
+        }
+        atlas::Log::info() << "A-grid kernels : " << agridKernels->access << " access, ";
+        if (agridKernels->nx>0)
+        {
+            atlas::Log::info() << "fixed nx=" << agridKernels->nx << std::endl;
+        }
+        else
+        {
+            atlas::Log::info() << "any nx" << std::endl;
+        }
     }
 
-    AGridBarotropicDynamics::~AGridBarotropicDynamics() = default;
+    template <typename Precision>
+    AGridBarotropicDynamicsT<Precision>::~AGridBarotropicDynamicsT() = default;
 
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        calcK(U, V, K);
+        K.set_dirty();
+        fdm->getFunctionSpace().haloExchange(K);
+        calcZeta(U, V, zeta);
+        calcU_tdcy(V, phi, zeta, K, U_tdcy);
+        calcV_tdcy(U, phi, zeta, K, V_tdcy);
+        calcphi_tdcy(U, V, phi, phi_tdcy);
+    }
 
-    void AGridBarotropicDynamics::calcU_tdcy(
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        if (yBegin>=yEnd) return;
+        calcK(U, V, K, std::max(yBegin-1, 1), std::min(yEnd+1, fdm->getNy()-1));
+        calcZeta(U, V, zeta, yBegin, yEnd);
+        calcU_tdcy(V, phi, zeta, K, U_tdcy, yBegin, yEnd);
+        calcV_tdcy(U, phi, zeta, K, V_tdcy, yBegin, yEnd);
+        calcphi_tdcy(U, V, phi, phi_tdcy, yBegin, yEnd);
+    }
+
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcU_tdcy(
         const atlas::Field& pV, 
         const atlas::Field& pphi, 
         const atlas::Field& pzeta,
         const atlas::Field& pK,
         atlas::Field& pU_tdcy) const
     {
-        auto V = atlas::array::make_view<double, 1>(pV);
-        auto phi = atlas::array::make_view<double, 1>(pphi);
-        auto tourbillon = atlas::array::make_view<double, 1>(pzeta);
-        auto K = atlas::array::make_view<double, 1>(pK);
-        auto f = atlas::array::make_view<double, 1>(fdm->getF());
-        auto U_tdcy = atlas::array::make_view<double, 1>(pU_tdcy);
-        atlas::idx_t i = 0;
-        atlas::idx_t stride = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t nx = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t ny = fdm->getFunctionSpace().grid().ny();
-        #pragma omp parallel for private(i)
-        for(atlas::idx_t y=1;y<ny-1;++y)
-        {
-            double c1, c2, c3, c4;
-            double kphi=0;
-            for(atlas::idx_t x=1;x<nx-1;++x)
-            {
-                i = x+y*stride;
-
-                c1 = K[i+1];
-                c2 = phi[i+1];
-                c3 = K[i-1];
-                c4 = phi[i-1];
-
-                kphi = (c1+c2-c3-c4)/(2*dx);
-
-                U_tdcy[i] = (tourbillon[i]+f[i])*V[i] - kphi;
-            }
-        }
+        calcU_tdcy(pV, pphi, pzeta, pK, pU_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
     }
-    
-    void AGridBarotropicDynamics::calcV_tdcy(
+
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcV_tdcy(
         const atlas::Field& pU, 
         const atlas::Field& pphi, 
         const atlas::Field& pzeta,
         const atlas::Field& pK,
         atlas::Field& pV_tdcy) const
     {
-        auto U = atlas::array::make_view<double, 1>(pU);
-        auto phi = atlas::array::make_view<double, 1>(pphi);
-        auto tourbillon = atlas::array::make_view<double, 1>(pzeta);
-        auto K = atlas::array::make_view<double, 1>(pK);
-        auto f = atlas::array::make_view<double, 1>(fdm->getF());
-        auto V_tdcy = atlas::array::make_view<double, 1>(pV_tdcy);
-        atlas::idx_t i = 0;
-        atlas::idx_t stride = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t nx = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t ny = fdm->getFunctionSpace().grid().ny();
-        #pragma omp parallel for private(i)
-        for(atlas::idx_t y=1;y<ny-1;++y)
-        {
-            double c1, c2, c3, c4;
-            double kphi=0;
-            for(atlas::idx_t x=1;x<nx-1;++x)
-            {
-                i = x+y*stride;
-
-                c1 = K[i-stride];
-                c2 = phi[i-stride];
-                c3 = K[i+stride];
-                c4 = phi[i+stride];
-
-                kphi = (c1+c2-c3-c4)/(2*dy);
-
-                V_tdcy[i] = -(tourbillon[i]+f[i])*U[i] - kphi;
-            }
-        }
+        calcV_tdcy(pU, pphi, pzeta, pK, pV_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
     }
 
-    void AGridBarotropicDynamics::calcphi_tdcy(
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcphi_tdcy(
         const atlas::Field& pU,
         const atlas::Field& pV,
         const atlas::Field& pphi,
         atlas::Field& pphi_tdcy) const
     {
-        auto U = atlas::array::make_view<double, 1>(pU);
-        auto V = atlas::array::make_view<double, 1>(pV);
-        auto phi = atlas::array::make_view<double, 1>(pphi);
-        auto m = atlas::array::make_view<double, 1>(fdm->getM());
-        auto phi_tdcy = atlas::array::make_view<double, 1>(pphi_tdcy);
-        atlas::idx_t i;
-        atlas::idx_t stride = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t nx = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t ny = fdm->getFunctionSpace().grid().ny();
-        #pragma omp parallel for private(i)
-        for(atlas::idx_t y=1;y<ny-1;++y)
-        {
-            double mm = 0;
-            for(atlas::idx_t x=1;x<nx-1;++x)
-            {
-                i = x+y*stride;
-
-                mm = m[i];
-
-                phi_tdcy[i] = -(mm*mm)*(
-                        (phi[i+1]*U[i+1] - phi[i-1]*U[i-1])/(dx*2)
-                        +(phi[i-stride]*V[i-stride] - phi[i+stride]*V[i+stride])/(dy*2)
-                    );
-            }
-        }
+        calcphi_tdcy(pU, pV, pphi, pphi_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
     }
 
-    void AGridBarotropicDynamics::calcK(
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcK(
         const atlas::Field& pU,
         const atlas::Field& pV,
         atlas::Field& pK) const
     {
-        auto U = atlas::array::make_view<double, 1>(pU);
-        auto V = atlas::array::make_view<double, 1>(pV);
-        auto K = atlas::array::make_view<double, 1>(pK);
-        auto m = atlas::array::make_view<double, 1>(fdm->getM());
-        atlas::idx_t i = 0;
-        atlas::idx_t stride = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t nx = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t ny = fdm->getFunctionSpace().grid().ny();
-        #pragma omp parallel for private(i)
-        for(atlas::idx_t y=1;y<ny-1;++y)
-        {
-            double u1 = 0;
-            double v1 = 0;
-            for(atlas::idx_t x=1;x<nx-1;++x)
-            {
-                i = x+y*stride;
-                u1 = U[i];
-                v1 = V[i];
-                K[i] = m[i]*m[i]*0.5*(u1*u1+v1*v1);
-            }
-        } 
+        calcK(pU, pV, pK, fdm->getRowBegin(), fdm->getRowEnd());
     }
 
-    void AGridBarotropicDynamics::calcZeta(
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcZeta(
         const atlas::Field& pU,
         const atlas::Field& pV,
         atlas::Field& pzeta) const
     {
-        auto U = atlas::array::make_view<double, 1>(pU);
-        auto V = atlas::array::make_view<double, 1>(pV);
-        auto tourbillon = atlas::array::make_view<double, 1>(pzeta);
-        auto m = atlas::array::make_view<double, 1>(fdm->getM());
-        atlas::idx_t i = 0;
-        atlas::idx_t stride = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t nx = fdm->getFunctionSpace().grid().nx(0);
-        atlas::idx_t ny = fdm->getFunctionSpace().grid().ny();
-        #pragma omp parallel for private(i)
-        for (atlas::idx_t y=1;y<ny-1;++y)
-        {
-            double m1 = 0;
-            double u1 = 0, u2 = 0;
-            double v1 = 0, v2 = 0;
-            for(atlas::idx_t x=1;x<nx-1;++x)
-            {
-                i = x+y*stride;
-
-                m1 = m[i];
+        calcZeta(pU, pV, pzeta, fdm->getRowBegin(), fdm->getRowEnd());
+    }
 
-                u1 = U[i-stride];
-                u2 = U[i+stride];
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcU_tdcy(
+        const atlas::Field& pV, 
+        const atlas::Field& pphi, 
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pU_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        agridKernels->calcU_tdcy(*fdm, pV, pphi, pzeta, pK, pU_tdcy, dx, dy, yBegin, yEnd);
+    }
+    
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcV_tdcy(
+        const atlas::Field& pU, 
+        const atlas::Field& pphi, 
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pV_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        agridKernels->calcV_tdcy(*fdm, pU, pphi, pzeta, pK, pV_tdcy, dx, dy, yBegin, yEnd);
+    }
 
-                v1 = V[i+1];
-                v2 = V[i-1];
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcphi_tdcy(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        atlas::Field& pphi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        agridKernels->calcphi_tdcy(*fdm, pU, pV, pphi, pphi_tdcy, dx, dy, yBegin, yEnd);
+    }
 
-                tourbillon[i] = m1*m1
-                        *((v1-v2)/(2*dx)
-                        - (u1-u2)/(2*dy)
-                        );
-            }
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcK(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pK,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        tendency_type rate = agridKernels->calcK(*fdm, pU, pV, pK, dx, dy, yBegin, yEnd, isCourantRateNeeded());
+        if (isCourantRateNeeded())
+        {
+            reduceCourantRate(rate);
         }
+    }
+
+    template <typename Precision>
+    void AGridBarotropicDynamicsT<Precision>::calcZeta(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pzeta,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        agridKernels->calcZeta(*fdm, pU, pV, pzeta, dx, dy, yBegin, yEnd);
     }    
+
+    template class AGridBarotropicDynamicsT<DoublePrecision>;
+    template class AGridBarotropicDynamicsT<SinglePrecision>;
+    template class AGridBarotropicDynamicsT<MixedPrecision>;
 }
\ No newline at end of file
@@ -1,16 +1,71 @@
 #pragma once
 
 #include "model/BarotropicDynamics.h"
+#include "model/Precision.h"
 #include "ConformalProjectionFiniteDifferenceMethod.h"
 
 namespace pifo
 {
-    class AGridBarotropicDynamics : public BarotropicDynamicsImpl
+    /**
+     * Row kernels of AGridBarotropicDynamicsT for one access policy and row
+     * length, on the rows [yBegin, yEnd) of the fields (see AGridKernels.h).
+     */
+    template <typename Precision>
+    struct AGridKernelTable {
+        typedef typename Precision::tendency_type tendency_type;
+        typedef ConformalProjectionFiniteDifferenceMethod Method;
+
+        const char* access;
+        // row length the kernels are built for, 0 for any
+        atlas::idx_t nx;
+
+        // returns the Courant rate of the rows if rate, 0 otherwise
+        tendency_type (*calcK)(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+            atlas::Field& K, tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd,
+            bool rate);
+
+        void (*calcZeta)(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+            atlas::Field& zeta, tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd);
+
+        void (*calcU_tdcy)(const Method& fdm, const atlas::Field& V, const atlas::Field& phi,
+            const atlas::Field& zeta, const atlas::Field& K, atlas::Field& U_tdcy,
+            tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd);
+
+        void (*calcV_tdcy)(const Method& fdm, const atlas::Field& U, const atlas::Field& phi,
+            const atlas::Field& zeta, const atlas::Field& K, atlas::Field& V_tdcy,
+            tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd);
+
+        void (*calcphi_tdcy)(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+            const atlas::Field& phi, atlas::Field& phi_tdcy,
+            tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd);
+    };
+
+    /**
+     * Barotropic dynamics on an A-grid, in the given working precision (see
+     * Precision.h) : U, V, phi, m and f are read as Precision::value_type, 
+     * K, zeta and the tendencies are computed in Precision::tendency_type.
+     * 
+     * <p>Configuration keys :</p>
+     * <ul>
+     * <li>array_access : checked (default) to read the fields through atlas
+     * array views, which accept any layout, or raw for restrict pointers 
+     * to the data, which needs contiguous fields (the separate layout).</li>
+     * </ul>
+     * 
+     * <p>The kernels are also built with a constant row length for the 
+     * grid widths of PIFO_FIXED_NX, and used when the grid has one of 
+     * them. All the variants give bit-identical results.</p>
+     */
+    template <typename Precision>
+    class AGridBarotropicDynamicsT : public BarotropicDynamicsImpl
     {
     public:
-        AGridBarotropicDynamics(const atlas::numerics::Method&);
-        AGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
-        virtual ~AGridBarotropicDynamics();
+        typedef typename Precision::value_type value_type;
+        typedef typename Precision::tendency_type tendency_type;
+
+        AGridBarotropicDynamicsT(const atlas::numerics::Method&);
+        AGridBarotropicDynamicsT(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~AGridBarotropicDynamicsT();
 
         virtual void calcU_tdcy(
             const atlas::Field& V, 
@@ -41,10 +96,87 @@ namespace pifo
             const atlas::Field& U,
             const atlas::Field& V,
             atlas::Field& zeta) const;
-    private:
+
+        // Same kernels, restricted to the rows [yBegin, yEnd).
+
+        virtual void calcU_tdcy(
+            const atlas::Field& V, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& U_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcV_tdcy(
+            const atlas::Field& U, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& V_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcphi_tdcy(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcK(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& K,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcZeta(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& zeta,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        /**
+         * Same as the default implementation, with a halo exchange of K 
+         * between calcK and the tendencies (V_tdcy reads K on the rows y-1 
+         * and y+1). zeta is only read at the computed point and needs none.
+         */
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        /**
+         * Tendencies on the rows [yBegin, yEnd). K is computed on the rows 
+         * yBegin-1 to yEnd as well, so the halos of U and V must be up to 
+         * date if they are halo rows, but K needs no halo exchange.
+         */
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+    protected:
         ConformalProjectionFiniteDifferenceMethod const* fdm;
-        double dx;
-        double dy;
+        tendency_type dx;
+        tendency_type dy;
+        const AGridKernelTable<Precision>* agridKernels;
     };
 
+    typedef AGridBarotropicDynamicsT<DoublePrecision> AGridBarotropicDynamics;
+
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#pragma once
+
+// Templated kernels of AGridBarotropicDynamicsT, instanciated by
+// AGridBarotropicDynamics.cpp for each precision, access policy and row
+// length. Do not include it anywhere else.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "atlas/array/ArrayView.h"
+#include "atlas/field/Field.h"
+#include "ConformalProjectionFiniteDifferenceMethod.h"
+
+namespace pifo {
+    namespace agrid {
+        /**
+         * Access to the fields through atlas array views : any stride (the
+         * interleaved layout), and bound checks in the debug builds of atlas.
+         */
+        struct CheckedAccess {
+            static const char* name()
+            {
+                return "checked";
+            }
+
+            template <typename T>
+            struct input {
+                typedef decltype(atlas::array::make_view<T, 1>(std::declval<const atlas::Field&>())) type;
+            };
+
+            template <typename T>
+            struct output {
+                typedef decltype(atlas::array::make_view<T, 1>(std::declval<atlas::Field&>())) type;
+            };
+
+            template <typename T>
+            static typename input<T>::type in(const atlas::Field& field)
+            {
+                return atlas::array::make_view<T, 1>(field);
+            }
+
+            template <typename T>
+            static typename output<T>::type out(atlas::Field& field)
+            {
+                return atlas::array::make_view<T, 1>(field);
+            }
+        };
+
+        /**
+         * Access to the data of contiguous fields through restrict pointers :
+         * the kernels promise the compiler that their arrays do not overlap.
+         */
+        struct RawAccess {
+            static const char* name()
+            {
+                return "raw";
+            }
+
+            template <typename T>
+            struct input {
+                typedef const T* __restrict__ type;
+            };
+
+            template <typename T>
+            struct output {
+                typedef T* __restrict__ type;
+            };
+
+            static void checkContiguous(const atlas::Field& field)
+            {
+                if (field.stride(0)!=1)
+                {
+                    throw std::runtime_error("raw array access needs contiguous fields (field "+field.name()+")");
+                }
+            }
+
+            template <typename T>
+            static const T* in(const atlas::Field& field)
+            {
+                checkContiguous(field);
+                return (const T*)field.storage();
+            }
+
+            template <typename T>
+            static T* out(atlas::Field& field)
+            {
+                checkContiguous(field);
+                return (T*)field.storage();
+            }
+        };
+
+        /**
+         * Row length read from the method.
+         */
+        struct RuntimeExtents {
+            static atlas::idx_t nx(const ConformalProjectionFiniteDifferenceMethod& fdm)
+            {
+                return fdm.getNx();
+            }
+        };
+
+        /**
+         * Row length known at compile time : constant trip counts, which the
+         * compiler may unroll and vectorize without remainder checks.
+         */
+        template <atlas::idx_t NX>
+        struct FixedExtents {
+            static atlas::idx_t nx(const ConformalProjectionFiniteDifferenceMethod&)
+            {
+                return NX;
+            }
+        };
+
+        /**
+         * Kernels of the A-grid barotropic dynamics on the rows [yBegin, yEnd),
+         * in the working precision of Precision. The operations are those of
+         * the reference kernels, in the same order, for any access policy
+         * and extents.
+         */
+        template <typename Precision, class Access, class Extents>
+        struct Kernels {
+            typedef typename Precision::value_type value_type;
+            typedef typename Precision::tendency_type tendency_type;
+            typedef typename Access::template input<value_type>::type values;
+            typedef typename Access::template input<tendency_type>::type tendencies;
+            typedef typename Access::template output<tendency_type>::type result;
+            typedef ConformalProjectionFiniteDifferenceMethod Method;
+
+            static void U_tdcyRows(const Method& fdm, values V, values phi, tendencies tourbillon, tendencies K,
+                values f, result U_tdcy, tendency_type dx, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                const atlas::idx_t nx = Extents::nx(fdm);
+                #pragma omp parallel for
+                for(atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    for(atlas::idx_t x=1;x<nx-1;++x)
+                    {
+                        atlas::idx_t i = row+x;
+
+                        tendency_type c1 = K[i+1];
+                        tendency_type c2 = phi[i+1];
+                        tendency_type c3 = K[i-1];
+                        tendency_type c4 = phi[i-1];
+
+                        tendency_type kphi = (c1+c2-c3-c4)/(2*dx);
+
+                        U_tdcy[i] = (tourbillon[i]+f[i])*V[i] - kphi;
+                    }
+                }
+            }
+
+            static void V_tdcyRows(const Method& fdm, values U, values phi, tendencies tourbillon, tendencies K,
+                values f, result V_tdcy, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                const atlas::idx_t nx = Extents::nx(fdm);
+                #pragma omp parallel for
+                for(atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                    atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                    for(atlas::idx_t x=1;x<nx-1;++x)
+                    {
+                        atlas::idx_t i = row+x;
+
+                        tendency_type c1 = K[i+prev];
+                        tendency_type c2 = phi[i+prev];
+                        tendency_type c3 = K[i+next];
+                        tendency_type c4 = phi[i+next];
+
+                        tendency_type kphi = (c1+c2-c3-c4)/(2*dy);
+
+                        V_tdcy[i] = -(tourbillon[i]+f[i])*U[i] - kphi;
+                    }
+                }
+            }
+
+            static void phi_tdcyRows(const Method& fdm, values U, values V, values phi, values m,
+                result phi_tdcy, tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                const atlas::idx_t nx = Extents::nx(fdm);
+                #pragma omp parallel for
+                for(atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                    atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                    for(atlas::idx_t x=1;x<nx-1;++x)
+                    {
+                        atlas::idx_t i = row+x;
+
+                        tendency_type mm = m[i];
+
+                        phi_tdcy[i] = -(mm*mm)*(
+                                ((tendency_type)phi[i+1]*U[i+1] - (tendency_type)phi[i-1]*U[i-1])/(dx*2)
+                                +((tendency_type)phi[i+prev]*V[i+prev] - (tendency_type)phi[i+next]*V[i+next])/(dy*2)
+                            );
+                    }
+                }
+            }
+
+            // returns the Courant rate of the rows, reduced in the same sweep
+            // if Rate (0 otherwise)
+            template <bool Rate>
+            static tendency_type KRows(const Method& fdm, values U, values V, values m, result K,
+                tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                const atlas::idx_t nx = Extents::nx(fdm);
+                tendency_type rdx = 1/dx;
+                tendency_type rdy = 1/dy;
+                tendency_type rate = 0;
+                #pragma omp parallel for reduction(max:rate)
+                for(atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    for(atlas::idx_t x=1;x<nx-1;++x)
+                    {
+                        atlas::idx_t i = row+x;
+                        tendency_type m1 = m[i];
+                        tendency_type u1 = U[i];
+                        tendency_type v1 = V[i];
+                        K[i] = m1*m1*(tendency_type)0.5*(u1*u1+v1*v1);
+                        if (Rate)
+                        {
+                            rate = std::max(rate, m1*m1*(std::abs(u1)*rdx+std::abs(v1)*rdy));
+                        }
+                    }
+                }
+                return rate;
+            }
+
+            static void zetaRows(const Method& fdm, values U, values V, values m, result tourbillon,
+                tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                const atlas::idx_t nx = Extents::nx(fdm);
+                #pragma omp parallel for
+                for (atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                    atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                    for(atlas::idx_t x=1;x<nx-1;++x)
+                    {
+                        atlas::idx_t i = row+x;
+
+                        tendency_type m1 = m[i];
+
+                        tendency_type u1 = U[i+prev];
+                        tendency_type u2 = U[i+next];
+
+                        tendency_type v1 = V[i+1];
+                        tendency_type v2 = V[i-1];
+
+                        tourbillon[i] = m1*m1
+                                *((v1-v2)/(2*dx)
+                                - (u1-u2)/(2*dy)
+                                );
+                    }
+                }
+            }
+
+            // entry points of the kernel table, on the fields
+
+            static void calcU_tdcy(const Method& fdm, const atlas::Field& V, const atlas::Field& phi,
+                const atlas::Field& zeta, const atlas::Field& K, atlas::Field& U_tdcy,
+                tendency_type dx, tendency_type, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                U_tdcyRows(fdm, Access::template in<value_type>(V), Access::template in<value_type>(phi),
+                    Access::template in<tendency_type>(zeta), Access::template in<tendency_type>(K),
+                    Access::template in<value_type>(fdm.getF()), Access::template out<tendency_type>(U_tdcy),
+                    dx, yBegin, yEnd);
+            }
+
+            static void calcV_tdcy(const Method& fdm, const atlas::Field& U, const atlas::Field& phi,
+                const atlas::Field& zeta, const atlas::Field& K, atlas::Field& V_tdcy,
+                tendency_type, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                V_tdcyRows(fdm, Access::template in<value_type>(U), Access::template in<value_type>(phi),
+                    Access::template in<tendency_type>(zeta), Access::template in<tendency_type>(K),
+                    Access::template in<value_type>(fdm.getF()), Access::template out<tendency_type>(V_tdcy),
+                    dy, yBegin, yEnd);
+            }
+
+            static void calcphi_tdcy(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+                const atlas::Field& phi, atlas::Field& phi_tdcy,
+                tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                phi_tdcyRows(fdm, Access::template in<value_type>(U), Access::template in<value_type>(V),
+                    Access::template in<value_type>(phi), Access::template in<value_type>(fdm.getM()),
+                    Access::template out<tendency_type>(phi_tdcy), dx, dy, yBegin, yEnd);
+            }
+
+            static tendency_type calcK(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+                atlas::Field& K, tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd,
+                bool rate)
+            {
+                auto KRowsOf = rate ? &KRows<true> : &KRows<false>;
+                return KRowsOf(fdm, Access::template in<value_type>(U), Access::template in<value_type>(V),
+                    Access::template in<value_type>(fdm.getM()), Access::template out<tendency_type>(K),
+                    dx, dy, yBegin, yEnd);
+            }
+
+            static void calcZeta(const Method& fdm, const atlas::Field& U, const atlas::Field& V,
+                atlas::Field& zeta, tendency_type dx, tendency_type dy, atlas::idx_t yBegin, atlas::idx_t yEnd)
+            {
+                zetaRows(fdm, Access::template in<value_type>(U), Access::template in<value_type>(V),
+                    Access::template in<value_type>(fdm.getM()), Access::template out<tendency_type>(zeta),
+                    dx, dy, yBegin, yEnd);
+            }
+        };
+    }
+}
@@ -1,4 +1,7 @@
 #include "ConformalProjectionFiniteDifferenceMethod.h"
+#include "atlas/array/DataType.h"
+#include <algorithm>
+#include <stdexcept>
 
 namespace pifo {
     ConformalProjectionFiniteDifferenceMethod::ConformalProjectionFiniteDifferenceMethod(
@@ -6,8 +9,9 @@ namespace pifo {
         atlas::Field& fField, 
         atlas::Field& mField) : atlas::numerics::Method(),
             functionSpace(fs),
+            m(mField),
             f(fField),
-            m(mField)
+            rowMetrics(false)
     {
         if (functionSpace.grid().nx(0)>0)
             dx = functionSpace.grid().x(1, 0) - functionSpace.grid().x(0, 0);
@@ -20,6 +24,75 @@ namespace pifo {
         else
             dy = 0;
         if (dy<0) dy = -dy;
+
+        // Local index of the first point of each row. The stencils need the 
+        // owned rows and their neighbours to be complete and contiguous, the
+        // deeper halo rows are indexed as well (semi-Lagrangian departure 
+        // points).
+        nx = functionSpace.grid().nx(0);
+        ny = functionSpace.grid().ny();
+        rowBegin = std::max(functionSpace.j_begin(), 1);
+        rowEnd = std::min(functionSpace.j_end(), ny-1);
+        rowIndicesOffset = functionSpace.j_begin_halo();
+        rowIndices.assign(functionSpace.j_end_halo()-functionSpace.j_begin_halo(), -1);
+        atlas::idx_t halo = std::max(functionSpace.halo(), 1);
+        haloRowBegin = std::max(functionSpace.j_begin()-halo, 0);
+        haloRowEnd = std::min(functionSpace.j_end()+halo, ny);
+        for (atlas::idx_t j=haloRowBegin;j<haloRowEnd;j++)
+        {
+            if (j>=functionSpace.j_begin() && j<functionSpace.j_end() 
+                && (functionSpace.i_begin(j)!=0 || functionSpace.i_end(j)!=nx))
+            {
+                throw std::runtime_error("ConformalProjectionFiniteDifferenceMethod needs a partition in bands of complete rows (row "+std::to_string(j)+")");
+            }
+            if (j<functionSpace.j_begin_halo() || j>=functionSpace.j_end_halo() 
+                || functionSpace.i_begin_halo(j)>0 || functionSpace.i_end_halo(j)<nx)
+            {
+                throw std::runtime_error("ConformalProjectionFiniteDifferenceMethod needs a halo of at least one row (row "+std::to_string(j)+")");
+            }
+            atlas::idx_t i0 = functionSpace.index(0, j);
+            for (atlas::idx_t i=1;i<nx;i++)
+            {
+                if (functionSpace.index(i, j)!=i0+i)
+                {
+                    throw std::runtime_error("ConformalProjectionFiniteDifferenceMethod needs contiguous rows (row "+std::to_string(j)+")");
+                }
+            }
+            rowIndices[j-rowIndicesOffset] = i0;
+        }
+    }
+
+    void ConformalProjectionFiniteDifferenceMethod::updateMetrics()
+    {
+        rowMetrics = false;
+        if (m.datatype()!=atlas::array::make_datatype<double>() || f.datatype()!=atlas::array::make_datatype<double>())
+        {
+            return;
+        }
+        auto mData = (const double*)m.storage();
+        auto fData = (const double*)f.storage();
+        rowM.assign(rowIndices.size(), 0);
+        rowM2.assign(rowIndices.size(), 0);
+        rowF.assign(rowIndices.size(), 0);
+        for (size_t r=0;r<rowIndices.size();r++)
+        {
+            atlas::idx_t i0 = rowIndices[r];
+            if (i0<0)
+            {
+                continue;
+            }
+            for (atlas::idx_t i=i0+1;i<i0+nx;i++)
+            {
+                if (mData[i]!=mData[i0] || fData[i]!=fData[i0])
+                {
+                    return;
+                }
+            }
+            rowM[r] = mData[i0];
+            rowM2[r] = mData[i0]*mData[i0];
+            rowF[r] = fData[i0];
+        }
+        rowMetrics = true;
     }
 
     ConformalProjectionFiniteDifferenceMethod::~ConformalProjectionFiniteDifferenceMethod()
@@ -31,4 +104,4 @@ namespace pifo {
     {
         return "ConformalProjectionFiniteDifferenceMethod";
     }
-}
\ No newline at end of file
+}
@@ -1,11 +1,29 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "atlas/numerics/Method.h"
 #include "atlas/functionspace/StructuredColumns.h"
 
 namespace pifo { 
+    /**
+     * Finite differences on a conformal projection grid.
+     * 
+     * <p>The function space may be partitioned in bands of complete rows, 
+     * with a halo of at least one row. The stencils only update the interior
+     * points of the regional grid, so they iterate on the rows 
+     * [getRowBegin(), getRowEnd()) and the columns [1, getNx()-1), the local 
+     * index of the point (x, y) being getRowIndex(y)+x. getRowIndex is valid 
+     * on the rows [getHaloRowBegin(), getHaloRowEnd()) : the owned rows and
+     * all the halo rows in the domain, at least from getRowBegin()-1 to 
+     * getRowEnd().</p>
+     * 
+     * <p>On a Mercator grid, m and f only depend on the latitude. 
+     * updateMetrics() detects it and then holds m, m*m and f per row, so 
+     * that the sweeps read one value per row instead of streaming the full 
+     * fields (see RowMetrics).</p>
+     */
     class ConformalProjectionFiniteDifferenceMethod : public atlas::numerics::Method {
     public:
         ConformalProjectionFiniteDifferenceMethod(atlas::functionspace::StructuredColumns& fs, atlas::Field& fField, atlas::Field& mField);
@@ -39,11 +57,128 @@ namespace pifo {
             return functionSpace;
         }
 
+        atlas::idx_t getNx() const
+        {
+            return nx;
+        }
+
+        atlas::idx_t getNy() const
+        {
+            return ny;
+        }
+
+        atlas::idx_t getRowBegin() const
+        {
+            return rowBegin;
+        }
+
+        atlas::idx_t getRowEnd() const
+        {
+            return rowEnd;
+        }
+
+        atlas::idx_t getHaloRowBegin() const
+        {
+            return haloRowBegin;
+        }
+
+        atlas::idx_t getHaloRowEnd() const
+        {
+            return haloRowEnd;
+        }
+
+        atlas::idx_t getRowIndex(atlas::idx_t y) const
+        {
+            return rowIndices[y-rowIndicesOffset];
+        }
+
+        /**
+         * Scan m and f and hold them per row if they are constant along 
+         * each row of getRowIndex(). To be called when m or f change.
+         */
+        void updateMetrics();
+
+        /**
+         * True if the last updateMetrics() found m and f constant along the
+         * rows, getRowM, getRowM2 and getRowF being then valid on the rows 
+         * of getRowIndex().
+         */
+        bool hasRowMetrics() const
+        {
+            return rowMetrics;
+        }
+
+        double getRowM(atlas::idx_t y) const
+        {
+            return rowM[y-rowIndicesOffset];
+        }
+
+        double getRowM2(atlas::idx_t y) const
+        {
+            return rowM2[y-rowIndicesOffset];
+        }
+
+        double getRowF(atlas::idx_t y) const
+        {
+            return rowF[y-rowIndicesOffset];
+        }
+
     private:
         atlas::functionspace::StructuredColumns& functionSpace;
         atlas::Field& m;
         atlas::Field& f;
         double dx;
         double dy;
+        atlas::idx_t nx;
+        atlas::idx_t ny;
+        atlas::idx_t rowBegin;
+        atlas::idx_t rowEnd;
+        atlas::idx_t haloRowBegin;
+        atlas::idx_t haloRowEnd;
+        atlas::idx_t rowIndicesOffset;
+        std::vector<atlas::idx_t> rowIndices;
+        bool rowMetrics;
+        std::vector<double> rowM;
+        std::vector<double> rowM2;
+        std::vector<double> rowF;
+    };
+
+    /**
+     * m*m and f at the points of a row, read from the full fields. i is 
+     * the local index of the point.
+     */
+    struct PointMetrics {
+        const double* m;
+        const double* f;
+
+        double m2(atlas::idx_t i) const
+        {
+            return m[i]*m[i];
+        }
+
+        double coriolis(atlas::idx_t i) const
+        {
+            return f[i];
+        }
+    };
+
+    /**
+     * m*m and f of a row where they are constant : the sweeps templated on
+     * the metrics keep them in registers. m2 is the same product as 
+     * PointMetrics::m2, so both give bit-identical results.
+     */
+    struct RowMetrics {
+        double rowM2;
+        double rowF;
+
+        double m2(atlas::idx_t) const
+        {
+            return rowM2;
+        }
+
+        double coriolis(atlas::idx_t) const
+        {
+            return rowF;
+        }
     };
-}
\ No newline at end of file
+}
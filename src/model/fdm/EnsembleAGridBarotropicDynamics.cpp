@@ -0,0 +1,198 @@
+#include "model/fdm/EnsembleAGridBarotropicDynamics.h"
+
+namespace pifo {
+    EnsembleAGridBarotropicDynamics::EnsembleAGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : EnsembleAGridBarotropicDynamics(pMethod, atlas::util::NoConfig())
+    {
+
+    }
+
+    EnsembleAGridBarotropicDynamics::EnsembleAGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+
+    }
+
+    EnsembleAGridBarotropicDynamics::~EnsembleAGridBarotropicDynamics() = default;
+
+    void EnsembleAGridBarotropicDynamics::calcU_tdcy(
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pU_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto tourbillon = (const double*)pzeta.storage();
+        auto K = (const double*)pK.storage();
+        auto f = (const double*)fdm->getF().storage();
+        auto U_tdcy = (double*)pU_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ne = getMembers(pV);
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            for(atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double fi = f[i];
+                atlas::idx_t k = i*ne;
+                #pragma omp simd
+                for(atlas::idx_t e=0;e<ne;++e)
+                {
+                    double kphi = (K[k+ne+e]+phi[k+ne+e]-K[k-ne+e]-phi[k-ne+e])/(2*dx);
+                    U_tdcy[k+e] = (tourbillon[k+e]+fi)*V[k+e] - kphi;
+                }
+            }
+        }
+    }
+
+    void EnsembleAGridBarotropicDynamics::calcV_tdcy(
+        const atlas::Field& pU,
+        const atlas::Field& pphi,
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pV_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto phi = (const double*)pphi.storage();
+        auto tourbillon = (const double*)pzeta.storage();
+        auto K = (const double*)pK.storage();
+        auto f = (const double*)fdm->getF().storage();
+        auto V_tdcy = (double*)pV_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ne = getMembers(pU);
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            atlas::idx_t prev = (fdm->getRowIndex(y-1)-row)*ne;
+            atlas::idx_t next = (fdm->getRowIndex(y+1)-row)*ne;
+            for(atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double fi = f[i];
+                atlas::idx_t k = i*ne;
+                #pragma omp simd
+                for(atlas::idx_t e=0;e<ne;++e)
+                {
+                    double kphi = (K[k+prev+e]+phi[k+prev+e]-K[k+next+e]-phi[k+next+e])/(2*dy);
+                    V_tdcy[k+e] = -(tourbillon[k+e]+fi)*U[k+e] - kphi;
+                }
+            }
+        }
+    }
+
+    void EnsembleAGridBarotropicDynamics::calcphi_tdcy(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        atlas::Field& pphi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto m = (const double*)fdm->getM().storage();
+        auto phi_tdcy = (double*)pphi_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ne = getMembers(pU);
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            atlas::idx_t prev = (fdm->getRowIndex(y-1)-row)*ne;
+            atlas::idx_t next = (fdm->getRowIndex(y+1)-row)*ne;
+            for(atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double mm = -(m[i]*m[i]);
+                atlas::idx_t k = i*ne;
+                #pragma omp simd
+                for(atlas::idx_t e=0;e<ne;++e)
+                {
+                    phi_tdcy[k+e] = mm*(
+                            (phi[k+ne+e]*U[k+ne+e] - phi[k-ne+e]*U[k-ne+e])/(dx*2)
+                            +(phi[k+prev+e]*V[k+prev+e] - phi[k+next+e]*V[k+next+e])/(dy*2)
+                        );
+                }
+            }
+        }
+    }
+
+    void EnsembleAGridBarotropicDynamics::calcK(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pK,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto K = (double*)pK.storage();
+        auto m = (const double*)fdm->getM().storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ne = getMembers(pU);
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            for(atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double mm = m[i]*m[i]*0.5;
+                atlas::idx_t k = i*ne;
+                #pragma omp simd
+                for(atlas::idx_t e=0;e<ne;++e)
+                {
+                    double u1 = U[k+e];
+                    double v1 = V[k+e];
+                    K[k+e] = mm*(u1*u1+v1*v1);
+                }
+            }
+        }
+    }
+
+    void EnsembleAGridBarotropicDynamics::calcZeta(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pzeta,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto tourbillon = (double*)pzeta.storage();
+        auto m = (const double*)fdm->getM().storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ne = getMembers(pU);
+        #pragma omp parallel for
+        for (atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            atlas::idx_t prev = (fdm->getRowIndex(y-1)-row)*ne;
+            atlas::idx_t next = (fdm->getRowIndex(y+1)-row)*ne;
+            for(atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double mm = m[i]*m[i];
+                atlas::idx_t k = i*ne;
+                #pragma omp simd
+                for(atlas::idx_t e=0;e<ne;++e)
+                {
+                    tourbillon[k+e] = mm
+                            *((V[k+ne+e]-V[k-ne+e])/(2*dx)
+                            - (U[k+prev+e]-U[k+next+e])/(2*dy)
+                            );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+
+namespace pifo
+{
+    /**
+     * A-grid barotropic dynamics of an ensemble of members held in the same 
+     * fields, the member being the fastest-varying index : the fields have 
+     * the shape (points, members), m and f are shared by all the members.
+     * 
+     * <p>The index computations and the loads of m and f are done once per 
+     * point, and the innermost loop over the members is vectorized. Each 
+     * member is bit-identical to a run of AGridBarotropicDynamics. Fields of
+     * rank 1 are a single member.</p>
+     */
+    class EnsembleAGridBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        EnsembleAGridBarotropicDynamics(const atlas::numerics::Method&);
+        EnsembleAGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~EnsembleAGridBarotropicDynamics();
+
+        using AGridBarotropicDynamics::calcU_tdcy;
+        using AGridBarotropicDynamics::calcV_tdcy;
+        using AGridBarotropicDynamics::calcphi_tdcy;
+        using AGridBarotropicDynamics::calcK;
+        using AGridBarotropicDynamics::calcZeta;
+
+        virtual void calcU_tdcy(
+            const atlas::Field& V, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& U_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcV_tdcy(
+            const atlas::Field& U, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& V_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcphi_tdcy(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcK(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& K,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcZeta(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& zeta,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        /**
+         * Number of members of a field.
+         */
+        static atlas::idx_t getMembers(const atlas::Field& field)
+        {
+            return field.rank()>1 ? field.shape(1) : 1;
+        }
+    };
+
+}
@@ -0,0 +1,78 @@
+#include "model/fdm/ExpressionAGridBarotropicDynamics.h"
+#include "model/fdm/StencilExpressions.h"
+#include <algorithm>
+
+namespace pifo {
+    ExpressionAGridBarotropicDynamics::ExpressionAGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : AGridBarotropicDynamics(pMethod)
+    {
+
+    }
+
+    ExpressionAGridBarotropicDynamics::ExpressionAGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+
+    }
+
+    ExpressionAGridBarotropicDynamics::~ExpressionAGridBarotropicDynamics() = default;
+
+    void ExpressionAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field&,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        calcK(U, V, K);
+        K.set_dirty();
+        fdm->getFunctionSpace().haloExchange(K);
+        evaluateTendencies(U, V, phi, K, U_tdcy, V_tdcy, phi_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
+    }
+
+    void ExpressionAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field&,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        if (yBegin>=yEnd) return;
+        calcK(U, V, K, std::max(yBegin-1, 1), std::min(yEnd+1, fdm->getNy()-1));
+        evaluateTendencies(U, V, phi, K, U_tdcy, V_tdcy, phi_tdcy, yBegin, yEnd);
+    }
+
+    void ExpressionAGridBarotropicDynamics::evaluateTendencies(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        const atlas::Field& pK,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        using namespace stencil;
+        Grid g(*fdm);
+        Var U(pU), V(pV), phi(pphi), K(pK), m(fdm->getM()), f(fdm->getF());
+
+        auto zeta = m*m*(g.dx_c(V)-g.dy_c(U));
+        // not g.dx_c(K+phi) : the reference kernels add the four terms in turn
+        auto kphiX = (shift<1, 0>(K+phi)-shift<-1, 0>(K)-shift<-1, 0>(phi))/(2*dx);
+        auto kphiY = (shift<0, -1>(K+phi)-shift<0, 1>(K)-shift<0, 1>(phi))/(2*dy);
+
+        g.evaluate(yBegin, yEnd,
+            assign(U_tdcy, (zeta+f)*V-kphiX),
+            assign(V_tdcy, -(zeta+f)*U-kphiY),
+            assign(phi_tdcy, -(m*m)*(g.dx_c(phi*U)+g.dy_c(phi*V))));
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+
+namespace pifo
+{
+    /**
+     * A-grid barotropic dynamics whose tendencies are written as stencil 
+     * expressions (see StencilExpressions.h).
+     * 
+     * <p>K is computed by the inherited kernel, which also gives the Courant
+     * rate. The vorticity and the three tendencies are then evaluated in a 
+     * single sweep, zeta being recomputed at each point instead of being 
+     * stored. The expressions perform the operations of the reference 
+     * kernels in the same order : results are bit-identical to 
+     * AGridBarotropicDynamics.</p>
+     */
+    class ExpressionAGridBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        ExpressionAGridBarotropicDynamics(const atlas::numerics::Method&);
+        ExpressionAGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~ExpressionAGridBarotropicDynamics();
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+    private:
+        /**
+         * zeta, U_tdcy, V_tdcy and phi_tdcy on the rows [yBegin, yEnd), K 
+         * being up to date on the rows yBegin-1 to yEnd.
+         */
+        void evaluateTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            const atlas::Field& K,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+    };
+
+}
@@ -0,0 +1,223 @@
+#include "model/fdm/FusedAGridBarotropicDynamics.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace pifo {
+    FusedAGridBarotropicDynamics::FusedAGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : AGridBarotropicDynamics(pMethod)
+    {
+
+    }
+
+    FusedAGridBarotropicDynamics::FusedAGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+
+    }
+
+    FusedAGridBarotropicDynamics::~FusedAGridBarotropicDynamics() = default;
+
+    void FusedAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        calcTendencies(U, V, phi, K, zeta, U_tdcy, V_tdcy, phi_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
+    }
+
+    template <bool Rate, class Metrics>
+    double FusedAGridBarotropicDynamics::kRowInterior(
+        const double* U,
+        const double* V,
+        const Metrics& metrics,
+        atlas::idx_t i,
+        atlas::idx_t nx,
+        double* kRow) const
+    {
+        double rdx = 1/dx;
+        double rdy = 1/dy;
+        double rate = 0;
+        for(atlas::idx_t x=1;x<nx-1;++x)
+        {
+            double m2 = metrics.m2(i+x);
+            double u1 = U[i+x];
+            double v1 = V[i+x];
+            kRow[x] = m2*0.5*(u1*u1+v1*v1);
+            if (Rate)
+            {
+                rate = std::max(rate, m2*(std::abs(u1)*rdx+std::abs(v1)*rdy));
+            }
+        }
+        return rate;
+    }
+
+    template <class Metrics>
+    void FusedAGridBarotropicDynamics::tendencyRow(
+        const double* U,
+        const double* V,
+        const double* phi,
+        const double* kPrev,
+        const double* kCur,
+        const double* kNext,
+        const Metrics& metrics,
+        atlas::idx_t y,
+        double* U_tdcy,
+        double* V_tdcy,
+        double* phi_tdcy) const
+    {
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t row = fdm->getRowIndex(y);
+        atlas::idx_t prev = fdm->getRowIndex(y-1)-row;
+        atlas::idx_t next = fdm->getRowIndex(y+1)-row;
+        for(atlas::idx_t x=1;x<nx-1;++x)
+        {
+            atlas::idx_t i = row+x;
+            double mm2 = metrics.m2(i);
+
+            double tourbillon = mm2
+                    *((V[i+1]-V[i-1])/(2*dx)
+                    - (U[i+prev]-U[i+next])/(2*dy)
+                    );
+            double absvort = tourbillon+metrics.coriolis(i);
+
+            U_tdcy[x] = absvort*V[i] - (kCur[x+1]+phi[i+1]-kCur[x-1]-phi[i-1])/(2*dx);
+            V_tdcy[x] = -absvort*U[i] - (kPrev[x]+phi[i+prev]-kNext[x]-phi[i+next])/(2*dy);
+            phi_tdcy[x] = -mm2*(
+                    (phi[i+1]*U[i+1] - phi[i-1]*U[i-1])/(dx*2)
+                    +(phi[i+prev]*V[i+prev] - phi[i+next]*V[i+next])/(dy*2)
+                );
+        }
+    }
+
+    template <bool Rate>
+    double FusedAGridBarotropicDynamics::kRow(
+        const double* U,
+        const double* V,
+        const double* K,
+        atlas::idx_t y,
+        double* kRow) const
+    {
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t i = fdm->getRowIndex(y);
+        if (y==0 || y==fdm->getNy()-1)
+        {
+            for(atlas::idx_t x=0;x<nx;++x)
+            {
+                kRow[x] = K[i+x];
+            }
+            return 0;
+        }
+        kRow[0] = K[i];
+        kRow[nx-1] = K[i+nx-1];
+        if (fdm->hasRowMetrics())
+        {
+            return kRowInterior<Rate>(U, V, RowMetrics{ fdm->getRowM2(y), fdm->getRowF(y) }, i, nx, kRow);
+        }
+        return kRowInterior<Rate>(U, V, PointMetrics{ (const double*)fdm->getM().storage(), (const double*)fdm->getF().storage() }, i, nx, kRow);
+    }
+
+    void FusedAGridBarotropicDynamics::calcKRow(
+        const double* U,
+        const double* V,
+        const double* K,
+        atlas::idx_t y,
+        double* kRow) const
+    {
+        this->kRow<false>(U, V, K, y, kRow);
+    }
+
+    void FusedAGridBarotropicDynamics::calcTendencyRow(
+        const double* U,
+        const double* V,
+        const double* phi,
+        const double* kPrev,
+        const double* kCur,
+        const double* kNext,
+        atlas::idx_t y,
+        double* U_tdcy,
+        double* V_tdcy,
+        double* phi_tdcy) const
+    {
+        if (fdm->hasRowMetrics())
+        {
+            tendencyRow(U, V, phi, kPrev, kCur, kNext, RowMetrics{ fdm->getRowM2(y), fdm->getRowF(y) }, 
+                y, U_tdcy, V_tdcy, phi_tdcy);
+        }
+        else
+        {
+            tendencyRow(U, V, phi, kPrev, kCur, kNext, 
+                PointMetrics{ (const double*)fdm->getM().storage(), (const double*)fdm->getF().storage() }, 
+                y, U_tdcy, V_tdcy, phi_tdcy);
+        }
+    }
+
+    void FusedAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        atlas::Field& pK,
+        atlas::Field&,
+        atlas::Field& pU_tdcy,
+        atlas::Field& pV_tdcy,
+        atlas::Field& pphi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto K = (const double*)pK.storage();
+        auto U_tdcy = (double*)pU_tdcy.storage();
+        auto V_tdcy = (double*)pV_tdcy.storage();
+        auto phi_tdcy = (double*)pphi_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        // the Courant rate of the rows whose K is computed, reduced along
+        // K when the model needs it
+        auto kRowOf = isCourantRateNeeded()
+            ? &FusedAGridBarotropicDynamics::kRow<true>
+            : &FusedAGridBarotropicDynamics::kRow<false>;
+        double rate = 0;
+
+        #pragma omp parallel
+        {
+            std::vector<double> window(3*nx);
+            double* kPrev = window.data();
+            double* kCur = kPrev+nx;
+            double* kNext = kCur+nx;
+            atlas::idx_t lastRow = -2;
+
+            #pragma omp for schedule(static) reduction(max:rate)
+            for(atlas::idx_t y=yBegin;y<yEnd;++y)
+            {
+                if (y==lastRow+1)
+                {
+                    double* tmp = kPrev;
+                    kPrev = kCur;
+                    kCur = kNext;
+                    kNext = tmp;
+                    rate = std::max(rate, (this->*kRowOf)(U, V, K, y+1, kNext));
+                }
+                else
+                {
+                    rate = std::max(rate, (this->*kRowOf)(U, V, K, y-1, kPrev));
+                    rate = std::max(rate, (this->*kRowOf)(U, V, K, y, kCur));
+                    rate = std::max(rate, (this->*kRowOf)(U, V, K, y+1, kNext));
+                }
+                lastRow = y;
+
+                atlas::idx_t row = fdm->getRowIndex(y);
+                calcTendencyRow(U, V, phi, kPrev, kCur, kNext, y, U_tdcy+row, V_tdcy+row, phi_tdcy+row);
+            }
+        }
+        if (isCourantRateNeeded())
+        {
+            reduceCourantRate(rate);
+        }
+    }
+}
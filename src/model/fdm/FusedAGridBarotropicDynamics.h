@@ -0,0 +1,123 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+
+namespace pifo
+{
+    /**
+     * A-grid barotropic dynamics computing all the tendencies in a single sweep.
+     * 
+     * <p>K and zeta are not stored in full-size fields : each thread keeps 
+     * the kinetic energy of the rows y-1, y and y+1 in a rolling window and
+     * computes the vorticity of the current point on the fly. U, V, phi, m 
+     * and f are thus read once per step, and the K and zeta fields are left
+     * untouched (their boundary values are still used, as in the reference 
+     * kernels).</p>
+     * 
+     * <p>When the method holds m and f per row (see 
+     * ConformalProjectionFiniteDifferenceMethod::updateMetrics), the rows
+     * use them instead of the full fields, and the sweep only streams U, V
+     * and phi.</p>
+     * 
+     * <p>When the model needs the Courant rate (adaptive dt), it is reduced
+     * along K in the same sweep, see takeCourantRate().</p>
+     * 
+     * <p>Results are bit-identical to the separate AGridBarotropicDynamics 
+     * kernels, which remain available through the inherited methods.</p>
+     */
+    class FusedAGridBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        FusedAGridBarotropicDynamics(const atlas::numerics::Method&);
+        FusedAGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~FusedAGridBarotropicDynamics();
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        /**
+         * Kinetic energy of the row y, on the points [0, nx). U, V and K 
+         * are the data of the fields, the boundary values being read in K. 
+         * kRow is indexed by x.
+         */
+        void calcKRow(
+            const double* U,
+            const double* V,
+            const double* K,
+            atlas::idx_t y,
+            double* kRow) const;
+
+        /**
+         * Tendencies of the interior points of the row y, given the kinetic 
+         * energy of the rows y-1, y and y+1. U, V and phi are the data of the
+         * fields, the other rows are indexed by x.
+         */
+        void calcTendencyRow(
+            const double* U,
+            const double* V,
+            const double* phi,
+            const double* kPrev,
+            const double* kCur,
+            const double* kNext,
+            atlas::idx_t y,
+            double* U_tdcy,
+            double* V_tdcy,
+            double* phi_tdcy) const;
+
+    private:
+        /**
+         * calcKRow, returning the Courant rate of the row if Rate (0 
+         * otherwise, and on the boundary rows).
+         */
+        template <bool Rate>
+        double kRow(
+            const double* U,
+            const double* V,
+            const double* K,
+            atlas::idx_t y,
+            double* kRow) const;
+
+        template <bool Rate, class Metrics>
+        double kRowInterior(
+            const double* U,
+            const double* V,
+            const Metrics& metrics,
+            atlas::idx_t i,
+            atlas::idx_t nx,
+            double* kRow) const;
+
+        template <class Metrics>
+        void tendencyRow(
+            const double* U,
+            const double* V,
+            const double* phi,
+            const double* kPrev,
+            const double* kCur,
+            const double* kNext,
+            const Metrics& metrics,
+            atlas::idx_t y,
+            double* U_tdcy,
+            double* V_tdcy,
+            double* phi_tdcy) const;
+    };
+
+}
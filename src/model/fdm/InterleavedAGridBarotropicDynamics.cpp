@@ -0,0 +1,184 @@
+#include "model/fdm/InterleavedAGridBarotropicDynamics.h"
+#include <stdexcept>
+#include <vector>
+
+namespace pifo {
+    namespace {
+        /**
+         * Throw if the fields are not consecutive components of one array.
+         */
+        void checkInterleaved(const std::vector<const atlas::Field*>& fields)
+        {
+            auto base = (const double*)fields[0]->storage();
+            for (size_t k=0;k<fields.size();k++)
+            {
+                if ((const double*)fields[k]->storage()!=base+k || fields[k]->stride(0)!=(atlas::idx_t)fields.size())
+                {
+                    throw std::runtime_error("pifo::InterleavedAGridBarotropicDynamics needs the interleaved layout (field "
+                        +fields[k]->name()+")");
+                }
+            }
+        }
+    }
+
+    InterleavedAGridBarotropicDynamics::InterleavedAGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : AGridBarotropicDynamics(pMethod)
+    {
+
+    }
+
+    InterleavedAGridBarotropicDynamics::InterleavedAGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+
+    }
+
+    InterleavedAGridBarotropicDynamics::~InterleavedAGridBarotropicDynamics() = default;
+
+    void InterleavedAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy) const
+    {
+        calcTendencies(U, V, phi, K, zeta, U_tdcy, V_tdcy, phi_tdcy, fdm->getRowBegin(), fdm->getRowEnd());
+    }
+
+    template <class Metrics>
+    void InterleavedAGridBarotropicDynamics::kRowInterior(const double* state, const Metrics& metrics, 
+        atlas::idx_t i, atlas::idx_t nx, double* kRow) const
+    {
+        for(atlas::idx_t x=1;x<nx-1;++x)
+        {
+            double u1 = state[3*(i+x)];
+            double v1 = state[3*(i+x)+1];
+            kRow[x] = metrics.m2(i+x)*0.5*(u1*u1+v1*v1);
+        }
+    }
+
+    template <class Metrics>
+    void InterleavedAGridBarotropicDynamics::tendencyRow(const double* s, const double* kPrev, 
+        const double* kCur, const double* kNext, const Metrics& metrics, atlas::idx_t y, double* tdcy) const
+    {
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t row = fdm->getRowIndex(y);
+        // offsets of the rows y-1 and y+1 in the interleaved arrays
+        atlas::idx_t prev = 3*(fdm->getRowIndex(y-1)-row);
+        atlas::idx_t next = 3*(fdm->getRowIndex(y+1)-row);
+        for(atlas::idx_t x=1;x<nx-1;++x)
+        {
+            atlas::idx_t i = row+x;
+            atlas::idx_t j = 3*i;
+            double mm2 = metrics.m2(i);
+
+            // s[j], s[j+1], s[j+2] : U, V and phi of the point
+            double tourbillon = mm2
+                    *((s[j+4]-s[j-2])/(2*dx)
+                    - (s[j+prev]-s[j+next])/(2*dy)
+                    );
+            double absvort = tourbillon+metrics.coriolis(i);
+
+            tdcy[j] = absvort*s[j+1] - (kCur[x+1]+s[j+5]-kCur[x-1]-s[j-1])/(2*dx);
+            tdcy[j+1] = -absvort*s[j] - (kPrev[x]+s[j+prev+2]-kNext[x]-s[j+next+2])/(2*dy);
+            tdcy[j+2] = -mm2*(
+                    (s[j+5]*s[j+3] - s[j-1]*s[j-3])/(dx*2)
+                    +(s[j+prev+2]*s[j+prev+1] - s[j+next+2]*s[j+next+1])/(dy*2)
+                );
+        }
+    }
+
+    void InterleavedAGridBarotropicDynamics::calcKRow(const double* state, const double* K, 
+        atlas::idx_t y, double* kRow) const
+    {
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t i = fdm->getRowIndex(y);
+        if (y==0 || y==fdm->getNy()-1)
+        {
+            for(atlas::idx_t x=0;x<nx;++x)
+            {
+                kRow[x] = K[2*(i+x)];
+            }
+            return;
+        }
+        kRow[0] = K[2*i];
+        kRow[nx-1] = K[2*(i+nx-1)];
+        if (fdm->hasRowMetrics())
+        {
+            kRowInterior(state, RowMetrics{ fdm->getRowM2(y), fdm->getRowF(y) }, i, nx, kRow);
+        }
+        else
+        {
+            kRowInterior(state, PointMetrics{ (const double*)fdm->getM().storage(), (const double*)fdm->getF().storage() }, i, nx, kRow);
+        }
+    }
+
+    void InterleavedAGridBarotropicDynamics::calcTendencyRow(const double* s, const double* kPrev, 
+        const double* kCur, const double* kNext, atlas::idx_t y, double* tdcy) const
+    {
+        if (fdm->hasRowMetrics())
+        {
+            tendencyRow(s, kPrev, kCur, kNext, RowMetrics{ fdm->getRowM2(y), fdm->getRowF(y) }, y, tdcy);
+        }
+        else
+        {
+            tendencyRow(s, kPrev, kCur, kNext, 
+                PointMetrics{ (const double*)fdm->getM().storage(), (const double*)fdm->getF().storage() }, y, tdcy);
+        }
+    }
+
+    void InterleavedAGridBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        checkInterleaved({ &U, &V, &phi });
+        checkInterleaved({ &K, &zeta });
+        checkInterleaved({ &U_tdcy, &V_tdcy, &phi_tdcy });
+        auto state = (const double*)U.storage();
+        auto kz = (const double*)K.storage();
+        auto tdcy = (double*)U_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+
+        #pragma omp parallel
+        {
+            std::vector<double> window(3*nx);
+            double* kPrev = window.data();
+            double* kCur = kPrev+nx;
+            double* kNext = kCur+nx;
+            atlas::idx_t lastRow = -2;
+
+            #pragma omp for schedule(static)
+            for(atlas::idx_t y=yBegin;y<yEnd;++y)
+            {
+                if (y==lastRow+1)
+                {
+                    double* tmp = kPrev;
+                    kPrev = kCur;
+                    kCur = kNext;
+                    kNext = tmp;
+                    calcKRow(state, kz, y+1, kNext);
+                }
+                else
+                {
+                    calcKRow(state, kz, y-1, kPrev);
+                    calcKRow(state, kz, y, kCur);
+                    calcKRow(state, kz, y+1, kNext);
+                }
+                lastRow = y;
+
+                calcTendencyRow(state, kPrev, kCur, kNext, y, tdcy);
+            }
+        }
+    }
+}
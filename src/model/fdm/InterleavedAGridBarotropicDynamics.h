@@ -0,0 +1,75 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+
+namespace pifo
+{
+    /**
+     * A-grid barotropic dynamics on the interleaved layout of Model.
+     * 
+     * <p>U, V and phi are stored point by point in a single array, as are 
+     * the three tendencies : U is its start, V and phi the next elements, 
+     * with a stride of 3. All the tendencies are computed in a single sweep
+     * as in FusedAGridBarotropicDynamics, the kinetic energy of the rows 
+     * y-1, y and y+1 being kept in a rolling window. A sweep thus streams 
+     * the state, m, f and the tendencies : 4 arrays instead of 8, and only
+     * 2 when the method holds m and f per row.</p>
+     * 
+     * <p>Results are bit-identical to AGridBarotropicDynamics. The inherited
+     * separate kernels read the fields through strided views and remain 
+     * valid on this layout.</p>
+     */
+    class InterleavedAGridBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        InterleavedAGridBarotropicDynamics(const atlas::numerics::Method&);
+        InterleavedAGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~InterleavedAGridBarotropicDynamics();
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+    private:
+        /**
+         * Kinetic energy of the row y, on the points [0, nx), from the 
+         * interleaved state. The boundary values are read in K (interleaved
+         * with zeta). kRow is indexed by x.
+         */
+        void calcKRow(const double* state, const double* K, atlas::idx_t y, double* kRow) const;
+
+        /**
+         * Interleaved tendencies of the interior points of the row y, 
+         * indexed as the state.
+         */
+        void calcTendencyRow(const double* state, const double* kPrev, const double* kCur, 
+            const double* kNext, atlas::idx_t y, double* tendencies) const;
+
+        template <class Metrics>
+        void kRowInterior(const double* state, const Metrics& metrics, atlas::idx_t i, 
+            atlas::idx_t nx, double* kRow) const;
+
+        template <class Metrics>
+        void tendencyRow(const double* state, const double* kPrev, const double* kCur, 
+            const double* kNext, const Metrics& metrics, atlas::idx_t y, double* tendencies) const;
+    };
+
+}
@@ -0,0 +1,191 @@
+#include "model/fdm/SemiLagrangianBarotropicDynamics.h"
+#include "util/Regridding.h"
+#include "atlas/option.h"
+#include "atlas/parallel/mpi/mpi.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace pifo {
+    SemiLagrangianBarotropicDynamics::SemiLagrangianBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : SemiLagrangianBarotropicDynamics(pMethod, atlas::util::NoConfig())
+    {
+
+    }
+
+    SemiLagrangianBarotropicDynamics::SemiLagrangianBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+        iterations = 3;
+        pParam.get("sl_iterations", iterations);
+
+        auto& functionSpace = fdm->getFunctionSpace();
+        cx = functionSpace.createField<double>(atlas::option::name("cx"));
+        cy = functionSpace.createField<double>(atlas::option::name("cy"));
+        rhs = atlas::FieldSet("rhs");
+        rhs.add(functionSpace.createField<double>(atlas::option::name("U_rhs")));
+        rhs.add(functionSpace.createField<double>(atlas::option::name("V_rhs")));
+        rhs.add(functionSpace.createField<double>(atlas::option::name("phi_rhs")));
+        for (atlas::idx_t v=0;v<rhs.size();v++)
+        {
+            // the boundary values are never read, but stay defined
+            std::memset(rhs.field(v).storage(), 0, rhs.field(v).size()*sizeof(double));
+        }
+    }
+
+    SemiLagrangianBarotropicDynamics::~SemiLagrangianBarotropicDynamics() = default;
+
+    void SemiLagrangianBarotropicDynamics::prepareStep(const atlas::FieldSet& pPrevious, double pTau)
+    {
+        previous = pPrevious;
+        tau = pTau;
+    }
+
+    double SemiLagrangianBarotropicDynamics::interpolate(const double* a, double x, double y, atlas::idx_t x0) const
+    {
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t yMin = std::max(fdm->getHaloRowBegin(), x0);
+        atlas::idx_t yMax = std::min(fdm->getHaloRowEnd()-1, fdm->getNy()-1-x0);
+        x = std::min(std::max(x, (double)x0), (double)(nx-1-x0));
+        y = std::min(std::max(y, (double)yMin), (double)yMax);
+        atlas::idx_t i = std::min((atlas::idx_t)x, nx-2-x0);
+        atlas::idx_t j = std::min((atlas::idx_t)y, std::max(yMax-1, yMin));
+        atlas::idx_t row1 = fdm->getRowIndex(j);
+        atlas::idx_t row2 = j<yMax ? fdm->getRowIndex(j+1) : row1;
+        return Regridding::bilinear(a[row1+i], a[row2+i], a[row1+i+1], a[row2+i+1], x-i, y-j);
+    }
+
+    void SemiLagrangianBarotropicDynamics::calcTendencies(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        atlas::Field&,
+        atlas::Field&,
+        atlas::Field& pU_tdcy,
+        atlas::Field& pV_tdcy,
+        atlas::Field& pphi_tdcy) const
+    {
+        if (tau<=0)
+        {
+            throw std::runtime_error("pifo::SemiLagrangianBarotropicDynamics needs the time step of the update, see prepareStep");
+        }
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto Up = (const double*)previous.field(0).storage();
+        auto Vp = (const double*)previous.field(1).storage();
+        auto phip = (const double*)previous.field(2).storage();
+        auto m = (const double*)fdm->getM().storage();
+        auto f = (const double*)fdm->getF().storage();
+        auto U_tdcy = (double*)pU_tdcy.storage();
+        auto V_tdcy = (double*)pV_tdcy.storage();
+        auto phi_tdcy = (double*)pphi_tdcy.storage();
+        auto Cx = (double*)cx.storage();
+        auto Cy = (double*)cy.storage();
+        auto U_rhs = (double*)rhs.field(0).storage();
+        auto V_rhs = (double*)rhs.field(1).storage();
+        auto phi_rhs = (double*)rhs.field(2).storage();
+        atlas::idx_t nx = fdm->getNx();
+        atlas::idx_t ny = fdm->getNy();
+        atlas::idx_t rowBegin = fdm->getRowBegin();
+        atlas::idx_t rowEnd = fdm->getRowEnd();
+        atlas::idx_t haloBegin = fdm->getHaloRowBegin();
+        atlas::idx_t haloEnd = fdm->getHaloRowEnd();
+        double dx2 = 2*dx;
+        double dy2 = 2*dy;
+
+        // velocity of the trajectories on the partition and its halo rows
+        #pragma omp parallel for
+        for (atlas::idx_t y=haloBegin;y<haloEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            for (atlas::idx_t x=0;x<nx;++x)
+            {
+                atlas::idx_t i = row+x;
+                Cx[i] = m[i]*m[i]*U[i]/dx;
+                Cy[i] = -m[i]*m[i]*V[i]/dy;
+            }
+        }
+
+        // right hand sides at the level n, interpolated at the middle points
+        #pragma omp parallel for
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            atlas::idx_t prev = fdm->getRowIndex(y-1)-row;
+            atlas::idx_t next = fdm->getRowIndex(y+1)-row;
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double mm = m[i];
+                double kk = mm*(U[i]*U[i]+V[i]*V[i]);
+                U_rhs[i] = f[i]*V[i] - (phi[i+1]-phi[i-1])/dx2 - kk*(m[i+1]-m[i-1])/dx2;
+                V_rhs[i] = -f[i]*U[i] - (phi[i+prev]-phi[i+next])/dy2 - kk*(m[i+prev]-m[i+next])/dy2;
+                phi_rhs[i] = -mm*mm*phi[i]*((U[i+1]-U[i-1])/dx2 + (V[i+prev]-V[i+next])/dy2);
+            }
+        }
+        for (atlas::idx_t v=0;v<rhs.size();v++)
+        {
+            rhs.field(v).set_dirty();
+        }
+        fdm->getFunctionSpace().haloExchange(rhs);
+
+        double h = tau/2;
+        // rows by which the departure points go beyond the halo rows, in
+        // the domain (the clamp to the domain boundary is intended)
+        double beyond = 0;
+        #pragma omp parallel for reduction(max:beyond)
+        for (atlas::idx_t y=rowBegin;y<rowEnd;++y)
+        {
+            atlas::idx_t row = fdm->getRowIndex(y);
+            for (atlas::idx_t x=1;x<nx-1;++x)
+            {
+                atlas::idx_t i = row+x;
+                double ax = h*Cx[i];
+                double ay = h*Cy[i];
+                for (int k=0;k<iterations;k++)
+                {
+                    double nax = h*interpolate(Cx, x-ax, y-ay, 0);
+                    double nay = h*interpolate(Cy, x-ax, y-ay, 0);
+                    ax = nax;
+                    ay = nay;
+                }
+
+                double xd = x-2*ax;
+                double yd = y-2*ay;
+                double yc = std::min(std::max(yd, 0.), (double)(ny-1));
+                beyond = std::max(beyond, std::max(haloBegin-yc, yc-(haloEnd-1)));
+                double xm = x-ax;
+                double ym = y-ay;
+                U_tdcy[i] = (interpolate(Up, xd, yd, 0)-Up[i])/tau + interpolate(U_rhs, xm, ym, 1);
+                V_tdcy[i] = (interpolate(Vp, xd, yd, 0)-Vp[i])/tau + interpolate(V_rhs, xm, ym, 1);
+                phi_tdcy[i] = (interpolate(phip, xd, yd, 0)-phip[i])/tau + interpolate(phi_rhs, xm, ym, 1);
+            }
+        }
+        atlas::mpi::comm().allReduceInPlace(beyond, eckit::mpi::max());
+        if (beyond>0)
+        {
+            throw std::runtime_error("pifo::SemiLagrangianBarotropicDynamics : departure points "
+                +std::to_string((int)std::ceil(beyond))+" row(s) beyond the halo of "
+                +std::to_string(fdm->getFunctionSpace().halo())+" rows, increase sl_halo or reduce dt");
+        }
+    }
+
+    void SemiLagrangianBarotropicDynamics::calcTendencies(
+        const atlas::Field& U,
+        const atlas::Field& V,
+        const atlas::Field& phi,
+        atlas::Field& K,
+        atlas::Field& zeta,
+        atlas::Field& U_tdcy,
+        atlas::Field& V_tdcy,
+        atlas::Field& phi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        // the departure points may be in any row of the halo
+        BarotropicDynamicsImpl::calcTendencies(U, V, phi, K, zeta, U_tdcy, V_tdcy, phi_tdcy, yBegin, yEnd);
+    }
+}
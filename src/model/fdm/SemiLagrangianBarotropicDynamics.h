@@ -0,0 +1,90 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+
+namespace pifo
+{
+    /**
+     * Semi-Lagrangian barotropic dynamics on the A-grid.
+     *
+     * <p>The equations are integrated along the trajectories of the flow,
+     * which moves by m2 (U/dx, -V/dy) grid points per second :</p>
+     *
+     * <pre>
+     * DU/Dt = f V - D_x(phi) - m D_x(m) (U2+V2)
+     * DV/Dt = -f U - D_y(phi) - m D_y(m) (U2+V2)
+     * Dphi/Dt = -m2 phi (D_x(U) + D_y(V))
+     * </pre>
+     *
+     * <p>For an update X(n+1) = X(n-1) + tau T (see prepareStep), the
+     * displacement a over tau/2 of the arrival point A is found by
+     * iterating a = tau/2 c(n)(A-a). The values of the level n-1 are
+     * interpolated at the departure point A-2a, the right hand sides above
+     * at the level n at the middle point A-a, and the tendency is set so that
+     * the model's update gives X(n-1)(A-2a) + tau R(n)(A-a). All the
+     * interpolations are bilinear (Regridding::bilinear).</p>
+     *
+     * <p>The advection is thus not limited by the Courant number, only the
+     * gravity waves are : combined with the semi_implicit or split_explicit
+     * time schemes of Model, the step can be of several minutes. The points
+     * out of the domain are clamped to its boundary. With several MPI tasks,
+     * the departure points must stay within the halo rows of the band :
+     * Model builds the function space with a halo of sl_halo rows (default
+     * 3) for this dynamics, and calcTendencies throws when a departure
+     * point is further than that from the band.</p>
+     *
+     * <p>K and zeta are not computed, the tendencies can't be computed on a
+     * subset of rows.</p>
+     */
+    class SemiLagrangianBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        SemiLagrangianBarotropicDynamics(const atlas::numerics::Method&);
+        SemiLagrangianBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~SemiLagrangianBarotropicDynamics();
+
+        virtual void prepareStep(const atlas::FieldSet& previous, double tau);
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy) const;
+
+        virtual void calcTendencies(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& K,
+            atlas::Field& zeta,
+            atlas::Field& U_tdcy,
+            atlas::Field& V_tdcy,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+    private:
+        atlas::FieldSet previous;
+        double tau = 0;
+        // iterations of the displacement (sl_iterations, default 3)
+        int iterations;
+        // work fields : velocity in grid points per second (columns and
+        // rows) and right hand sides
+        atlas::Field cx;
+        atlas::Field cy;
+        atlas::FieldSet rhs;
+
+        /**
+         * Bilinear interpolation of a at the column x and row y, clamped to
+         * the points [x0, nx-1-x0] and the rows of the partition and its
+         * halo that are at least x0 from the domain boundary (see
+         * ConformalProjectionFiniteDifferenceMethod::getHaloRowBegin).
+         */
+        double interpolate(const double* a, double x, double y, atlas::idx_t x0) const;
+    };
+
+}
@@ -0,0 +1,145 @@
+#include "model/fdm/SimdAGridBarotropicDynamics.h"
+#include "atlas/runtime/Log.h"
+
+namespace pifo {
+    SimdAGridBarotropicDynamics::SimdAGridBarotropicDynamics(const atlas::numerics::Method& pMethod)
+        : SimdAGridBarotropicDynamics(pMethod, atlas::util::NoConfig())
+    {
+
+    }
+
+    SimdAGridBarotropicDynamics::SimdAGridBarotropicDynamics(const atlas::numerics::Method& pMethod, const eckit::Parametrisation& pParam)
+        : AGridBarotropicDynamics(pMethod, pParam)
+    {
+        std::string isa = "auto";
+        pParam.get("simd", isa);
+        kernels = &simd::selectKernels(isa);
+        atlas::Log::info() << "stencil kernels : " << kernels->name << std::endl;
+    }
+
+    SimdAGridBarotropicDynamics::~SimdAGridBarotropicDynamics() = default;
+
+    void SimdAGridBarotropicDynamics::calcU_tdcy(
+        const atlas::Field& pV, 
+        const atlas::Field& pphi, 
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pU_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto tourbillon = (const double*)pzeta.storage();
+        auto K = (const double*)pK.storage();
+        auto f = (const double*)fdm->getF().storage();
+        auto U_tdcy = (double*)pU_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        double dx2 = 2*dx;
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t i = fdm->getRowIndex(y);
+            kernels->calcU_tdcy(V+i, phi+i, tourbillon+i, K+i, f+i, dx2, U_tdcy+i, 1, nx-1);
+        }
+    }
+
+    void SimdAGridBarotropicDynamics::calcV_tdcy(
+        const atlas::Field& pU, 
+        const atlas::Field& pphi, 
+        const atlas::Field& pzeta,
+        const atlas::Field& pK,
+        atlas::Field& pV_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto phi = (const double*)pphi.storage();
+        auto tourbillon = (const double*)pzeta.storage();
+        auto K = (const double*)pK.storage();
+        auto f = (const double*)fdm->getF().storage();
+        auto V_tdcy = (double*)pV_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        double dy2 = 2*dy;
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t i = fdm->getRowIndex(y);
+            atlas::idx_t prev = fdm->getRowIndex(y-1);
+            atlas::idx_t next = fdm->getRowIndex(y+1);
+            kernels->calcV_tdcy(U+i, phi+prev, phi+next, tourbillon+i, K+prev, K+next, f+i, 
+                dy2, V_tdcy+i, 1, nx-1);
+        }
+    }
+
+    void SimdAGridBarotropicDynamics::calcphi_tdcy(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        const atlas::Field& pphi,
+        atlas::Field& pphi_tdcy,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto phi = (const double*)pphi.storage();
+        auto m = (const double*)fdm->getM().storage();
+        auto phi_tdcy = (double*)pphi_tdcy.storage();
+        atlas::idx_t nx = fdm->getNx();
+        double dx2 = dx*2;
+        double dy2 = dy*2;
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t i = fdm->getRowIndex(y);
+            atlas::idx_t prev = fdm->getRowIndex(y-1);
+            atlas::idx_t next = fdm->getRowIndex(y+1);
+            kernels->calcphi_tdcy(U+i, V+prev, V+next, phi+i, phi+prev, phi+next, m+i, 
+                dx2, dy2, phi_tdcy+i, 1, nx-1);
+        }
+    }
+
+    void SimdAGridBarotropicDynamics::calcK(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pK,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto K = (double*)pK.storage();
+        auto m = (const double*)fdm->getM().storage();
+        atlas::idx_t nx = fdm->getNx();
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t i = fdm->getRowIndex(y);
+            kernels->calcK(U+i, V+i, m+i, K+i, 1, nx-1);
+        }
+    }
+
+    void SimdAGridBarotropicDynamics::calcZeta(
+        const atlas::Field& pU,
+        const atlas::Field& pV,
+        atlas::Field& pzeta,
+        atlas::idx_t yBegin,
+        atlas::idx_t yEnd) const
+    {
+        auto U = (const double*)pU.storage();
+        auto V = (const double*)pV.storage();
+        auto tourbillon = (double*)pzeta.storage();
+        auto m = (const double*)fdm->getM().storage();
+        atlas::idx_t nx = fdm->getNx();
+        double dx2 = 2*dx;
+        double dy2 = 2*dy;
+        #pragma omp parallel for
+        for(atlas::idx_t y=yBegin;y<yEnd;++y)
+        {
+            atlas::idx_t i = fdm->getRowIndex(y);
+            atlas::idx_t prev = fdm->getRowIndex(y-1);
+            atlas::idx_t next = fdm->getRowIndex(y+1);
+            kernels->calcZeta(U+prev, U+next, V+i, m+i, dx2, dy2, tourbillon+i, 1, nx-1);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "AGridBarotropicDynamics.h"
+#include "simd/StencilKernels.h"
+
+namespace pifo
+{
+    /**
+     * A-grid barotropic dynamics using hand-vectorized row kernels.
+     * 
+     * <p>The instruction set is given by the "simd" parameter (auto, scalar, 
+     * sse2, avx2 or avx512). With auto, the best one supported by the CPU is
+     * picked at construction. Results are bit-identical to AGridBarotropicDynamics.</p>
+     */
+    class SimdAGridBarotropicDynamics : public AGridBarotropicDynamics
+    {
+    public:
+        SimdAGridBarotropicDynamics(const atlas::numerics::Method&);
+        SimdAGridBarotropicDynamics(const atlas::numerics::Method&, const eckit::Parametrisation&);
+        virtual ~SimdAGridBarotropicDynamics();
+
+        using AGridBarotropicDynamics::calcU_tdcy;
+        using AGridBarotropicDynamics::calcV_tdcy;
+        using AGridBarotropicDynamics::calcphi_tdcy;
+        using AGridBarotropicDynamics::calcK;
+        using AGridBarotropicDynamics::calcZeta;
+
+        virtual void calcU_tdcy(
+            const atlas::Field& V, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& U_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcV_tdcy(
+            const atlas::Field& U, 
+            const atlas::Field& phi, 
+            const atlas::Field& zeta,
+            const atlas::Field& K,
+            atlas::Field& V_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcphi_tdcy(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            const atlas::Field& phi,
+            atlas::Field& phi_tdcy,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcK(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& K,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        virtual void calcZeta(
+            const atlas::Field& U,
+            const atlas::Field& V,
+            atlas::Field& zeta,
+            atlas::idx_t yBegin,
+            atlas::idx_t yEnd) const;
+
+        const simd::StencilKernels& getKernels() const
+        {
+            return *kernels;
+        }
+
+    private:
+        const simd::StencilKernels* kernels;
+    };
+
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+#include "atlas/array/DataType.h"
+#include "atlas/field/Field.h"
+#include "ConformalProjectionFiniteDifferenceMethod.h"
+
+namespace pifo {
+    /**
+     * Expression templates for stencils on the interior points of a
+     * ConformalProjectionFiniteDifferenceMethod.
+     *
+     * <p>Fields are wrapped in Var, combined with the arithmetic operators,
+     * shifted with shift<dx, dy>(e) and differentiated with Grid::dx_c and
+     * Grid::dy_c. Grid::evaluate then computes one or more assignments in
+     * a single loop over the rows, without temporary fields :</p>
+     *
+     * <pre>
+     * stencil::Grid g(fdm);
+     * stencil::Var U(pU), V(pV), m(fdm.getM());
+     * g.evaluate(yBegin, yEnd, stencil::assign(zeta, m*m*(g.dx_c(V)-g.dy_c(U))));
+     * </pre>
+     *
+     * <p>The row y-1 is the previous row of the grid, as in the kernels :
+     * dy_c(e) is (e(y-1)-e(y+1))/(2dy). The expressions evaluate the
+     * operations in the order they are written, so that a kernel written
+     * with the same operations as a hand-written one gives bit-identical
+     * results : dx_c(K+phi) rounds differently from
+     * (K(x+1)+phi(x+1)-K(x-1)-phi(x-1))/(2dx). A stencil reaches at most
+     * one point in each direction, the width of the halo (checked at
+     * compile time). The fields are double, contiguous, and the assigned
+     * fields must not be read by the expressions.</p>
+     */
+    namespace stencil {
+        /**
+         * Local index of the evaluated point, and offsets from its row to
+         * the rows y-1 and y+1.
+         */
+        struct Point {
+            atlas::idx_t i;
+            atlas::idx_t prev;
+            atlas::idx_t next;
+        };
+
+        /**
+         * Base of the expression types, so that the operators only apply to
+         * them. rx and ry are the number of points an expression reads on
+         * each side of the evaluated point, in x and y.
+         */
+        template <class E>
+        struct Expression {
+            const E& self() const
+            {
+                return static_cast<const E&>(*this);
+            }
+        };
+
+        /**
+         * Values of a field.
+         */
+        class Var : public Expression<Var> {
+        public:
+            static const int rx = 0;
+            static const int ry = 0;
+
+            explicit Var(const atlas::Field& field)
+                : data((const double*)field.storage())
+            {
+                if (field.datatype()!=atlas::array::make_datatype<double>() || field.stride(0)!=1)
+                {
+                    throw std::runtime_error("stencil::Var needs a contiguous field of double (field "+field.name()+")");
+                }
+            }
+
+            double operator()(const Point& p) const
+            {
+                return data[p.i];
+            }
+
+        private:
+            const double* data;
+        };
+
+        /**
+         * Constant.
+         */
+        class Scalar : public Expression<Scalar> {
+        public:
+            static const int rx = 0;
+            static const int ry = 0;
+
+            Scalar(double pValue) : value(pValue)
+            {
+
+            }
+
+            double operator()(const Point&) const
+            {
+                return value;
+            }
+
+        private:
+            double value;
+        };
+
+        /**
+         * e at the point (x+DX, y+DY).
+         */
+        template <int DX, int DY, class E>
+        class Shift : public Expression<Shift<DX, DY, E>> {
+        public:
+            static const int rx = E::rx+(DX<0 ? -DX : DX);
+            static const int ry = E::ry+(DY<0 ? -DY : DY);
+            static_assert(rx<=1 && ry<=1, "a stencil reaches at most one point, the width of the halo");
+
+            explicit Shift(const E& pE) : e(pE)
+            {
+
+            }
+
+            double operator()(const Point& p) const
+            {
+                return e(Point{ p.i+DX+(DY<0 ? p.prev : DY>0 ? p.next : 0), p.prev, p.next });
+            }
+
+        private:
+            E e;
+        };
+
+        template <int DX, int DY, class E>
+        Shift<DX, DY, E> shift(const Expression<E>& e)
+        {
+            return Shift<DX, DY, E>(e.self());
+        }
+
+        struct Add {
+            static double apply(double a, double b) { return a+b; }
+        };
+
+        struct Sub {
+            static double apply(double a, double b) { return a-b; }
+        };
+
+        struct Mul {
+            static double apply(double a, double b) { return a*b; }
+        };
+
+        struct Div {
+            static double apply(double a, double b) { return a/b; }
+        };
+
+        template <class Op, class L, class R>
+        class Binary : public Expression<Binary<Op, L, R>> {
+        public:
+            static const int rx = L::rx>R::rx ? L::rx : R::rx;
+            static const int ry = L::ry>R::ry ? L::ry : R::ry;
+
+            Binary(const L& pl, const R& pr) : l(pl), r(pr)
+            {
+
+            }
+
+            double operator()(const Point& p) const
+            {
+                return Op::apply(l(p), r(p));
+            }
+
+        private:
+            L l;
+            R r;
+        };
+
+        template <class E>
+        class Negate : public Expression<Negate<E>> {
+        public:
+            static const int rx = E::rx;
+            static const int ry = E::ry;
+
+            explicit Negate(const E& pE) : e(pE)
+            {
+
+            }
+
+            double operator()(const Point& p) const
+            {
+                return -e(p);
+            }
+
+        private:
+            E e;
+        };
+
+        template <class E>
+        Negate<E> operator-(const Expression<E>& e)
+        {
+            return Negate<E>(e.self());
+        }
+
+#define PIFO_STENCIL_OPERATOR(op, Op) \
+        template <class L, class R> \
+        Binary<Op, L, R> operator op(const Expression<L>& l, const Expression<R>& r) \
+        { \
+            return Binary<Op, L, R>(l.self(), r.self()); \
+        } \
+        template <class L> \
+        Binary<Op, L, Scalar> operator op(const Expression<L>& l, double r) \
+        { \
+            return Binary<Op, L, Scalar>(l.self(), Scalar(r)); \
+        } \
+        template <class R> \
+        Binary<Op, Scalar, R> operator op(double l, const Expression<R>& r) \
+        { \
+            return Binary<Op, Scalar, R>(Scalar(l), r.self()); \
+        }
+
+        PIFO_STENCIL_OPERATOR(+, Add)
+        PIFO_STENCIL_OPERATOR(-, Sub)
+        PIFO_STENCIL_OPERATOR(*, Mul)
+        PIFO_STENCIL_OPERATOR(/, Div)
+
+#undef PIFO_STENCIL_OPERATOR
+
+        /**
+         * Storage of an expression into a field, see Grid::evaluate.
+         */
+        template <class E>
+        class Assignment {
+        public:
+            Assignment(double* pData, const E& pE) : data(pData), e(pE)
+            {
+
+            }
+
+            void operator()(const Point& p) const
+            {
+                data[p.i] = e(p);
+            }
+
+        private:
+            double* data;
+            E e;
+        };
+
+        template <class E>
+        Assignment<E> assign(atlas::Field& field, const Expression<E>& e)
+        {
+            if (field.datatype()!=atlas::array::make_datatype<double>() || field.stride(0)!=1)
+            {
+                throw std::runtime_error("stencil::assign needs a contiguous field of double (field "+field.name()+")");
+            }
+            return Assignment<E>((double*)field.storage(), e.self());
+        }
+
+        /**
+         * Centered differences and evaluation on the rows of a method.
+         */
+        class Grid {
+        public:
+            explicit Grid(const ConformalProjectionFiniteDifferenceMethod& pFdm)
+                : fdm(pFdm), dx(pFdm.getDx()), dy(pFdm.getDy())
+            {
+
+            }
+
+            template <class E>
+            Binary<Div, Binary<Sub, Shift<1, 0, E>, Shift<-1, 0, E>>, Scalar> dx_c(const Expression<E>& e) const
+            {
+                return (shift<1, 0>(e)-shift<-1, 0>(e))/(2*dx);
+            }
+
+            template <class E>
+            Binary<Div, Binary<Sub, Shift<0, -1, E>, Shift<0, 1, E>>, Scalar> dy_c(const Expression<E>& e) const
+            {
+                return (shift<0, -1>(e)-shift<0, 1>(e))/(2*dy);
+            }
+
+            /**
+             * Evaluate the assignments at the interior points of the rows
+             * [yBegin, yEnd), all of them at a point before the next point,
+             * in a parallel loop over the rows.
+             */
+            template <class A, class... Rest>
+            void evaluate(atlas::idx_t yBegin, atlas::idx_t yEnd, const A& assignment, const Rest&... rest) const
+            {
+                atlas::idx_t nx = fdm.getNx();
+                #pragma omp parallel for
+                for(atlas::idx_t y=yBegin;y<yEnd;++y)
+                {
+                    atlas::idx_t row = fdm.getRowIndex(y);
+                    atlas::idx_t prev = fdm.getRowIndex(y-1)-row;
+                    atlas::idx_t next = fdm.getRowIndex(y+1)-row;
+                    evaluateRow(row+1, row+nx-1, prev, next, assignment, rest...);
+                }
+            }
+
+        private:
+            // The assignments are copied, so that the stores to the fields 
+            // cannot modify their pointers and constants. The assigned fields 
+            // are not read, so the points are independent (ivdep) : the loop
+            // is vectorized without runtime alias checks of all the streams,
+            // which GCC gives up on beyond a few of them.
+            template <class A, class... Rest>
+            static void evaluateRow(atlas::idx_t begin, atlas::idx_t end, atlas::idx_t prev, atlas::idx_t next, 
+                A assignment, Rest... rest)
+            {
+                #pragma GCC ivdep
+                for(atlas::idx_t i=begin;i<end;++i)
+                {
+                    Point p{ i, prev, next };
+                    assignment(p);
+                    (void)std::initializer_list<int>{ (rest(p), 0)... };
+                }
+            }
+
+            const ConformalProjectionFiniteDifferenceMethod& fdm;
+            double dx;
+            double dy;
+        };
+    }
+}
@@ -0,0 +1,39 @@
+#include "StencilKernelsImpl.h"
+#include <stdexcept>
+
+namespace pifo {
+    namespace simd {
+        const StencilKernels& scalarKernels()
+        {
+            static const StencilKernels kernels = StencilKernelsImpl<ScalarVec>::table("scalar");
+            return kernels;
+        }
+
+        std::vector<const StencilKernels*> availableKernels()
+        {
+            std::vector<const StencilKernels*> kernels;
+            kernels.push_back(&scalarKernels());
+#ifdef PIFO_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse2")) kernels.push_back(&sse2Kernels());
+            if (__builtin_cpu_supports("avx2")) kernels.push_back(&avx2Kernels());
+            if (__builtin_cpu_supports("avx512f")) kernels.push_back(&avx512Kernels());
+#endif
+            return kernels;
+        }
+
+        const StencilKernels& selectKernels(const std::string& isa)
+        {
+            auto kernels = availableKernels();
+            if (isa=="auto")
+            {
+                return *kernels.back();
+            }
+            for (auto k : kernels)
+            {
+                if (isa==k->name) return *k;
+            }
+            throw std::runtime_error("instruction set '"+isa+"' is unknown or not supported by this CPU");
+        }
+    }
+}
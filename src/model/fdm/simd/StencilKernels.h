@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "atlas/library/config.h"
+
+namespace pifo {
+    namespace simd {
+        /**
+         * Table of row kernels of the A-grid barotropic dynamics, for one instruction set.
+         * 
+         * <p>Each kernel works on one grid row and computes the points x in 
+         * [xb, xe). Row pointers point to the first point (x=0) of the row : 
+         * "n" is the row y-1, "c" the row y and "s" the row y+1. dx2 and dy2 
+         * are twice the grid spacings.</p>
+         * 
+         * <p>All the variants perform the same operations in the same order as
+         * the scalar reference, so that they give bit-identical results.</p>
+         */
+        struct StencilKernels {
+            const char* name;
+
+            void (*calcK)(const double* U, const double* V, const double* m, 
+                double* K, atlas::idx_t xb, atlas::idx_t xe);
+
+            void (*calcZeta)(const double* Un, const double* Us, const double* V, const double* m, 
+                double dx2, double dy2, double* zeta, atlas::idx_t xb, atlas::idx_t xe);
+
+            void (*calcU_tdcy)(const double* V, const double* phi, const double* zeta, const double* K, const double* f, 
+                double dx2, double* U_tdcy, atlas::idx_t xb, atlas::idx_t xe);
+
+            void (*calcV_tdcy)(const double* U, const double* phin, const double* phis, const double* zeta, 
+                const double* Kn, const double* Ks, const double* f, 
+                double dy2, double* V_tdcy, atlas::idx_t xb, atlas::idx_t xe);
+
+            void (*calcphi_tdcy)(const double* U, const double* Vn, const double* Vs, 
+                const double* phi, const double* phin, const double* phis, const double* m, 
+                double dx2, double dy2, double* phi_tdcy, atlas::idx_t xb, atlas::idx_t xe);
+
+            // z = x + c*y
+            void (*a_bc)(const double* x, const double* y, double c, double* z, atlas::idx_t n);
+        };
+
+        const StencilKernels& scalarKernels();
+#ifdef PIFO_SIMD_X86
+        const StencilKernels& sse2Kernels();
+        const StencilKernels& avx2Kernels();
+        const StencilKernels& avx512Kernels();
+#endif
+
+        /**
+         * Kernel tables usable on the running CPU, from the most basic to the best one.
+         */
+        std::vector<const StencilKernels*> availableKernels();
+
+        /**
+         * Select the kernels of an instruction set.
+         * 
+         * @param isa scalar, sse2, avx2, avx512, or auto to pick the best 
+         * instruction set supported by the CPU (checked with CPUID).
+         */
+        const StencilKernels& selectKernels(const std::string& isa);
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+// Generic implementation of the stencil kernels, instanciated by each 
+// instruction set translation unit with its own vector traits. 
+// Do not include it anywhere else.
+
+#include "StencilKernels.h"
+
+namespace pifo {
+    namespace simd {
+        /**
+         * Scalar "vector" traits, used for the reference kernels and for the loop tails.
+         */
+        struct ScalarVec {
+            typedef double type;
+            static const atlas::idx_t width = 1;
+            static inline type load(const double* p) { return *p; }
+            static inline void store(double* p, type v) { *p = v; }
+            static inline type set1(double v) { return v; }
+            static inline type add(type a, type b) { return a+b; }
+            static inline type sub(type a, type b) { return a-b; }
+            static inline type mul(type a, type b) { return a*b; }
+            static inline type div(type a, type b) { return a/b; }
+            static inline type neg(type a) { return -a; }
+        };
+
+        template <class Vec>
+        struct StencilKernelsImpl {
+            typedef typename Vec::type vec;
+
+            // The kernels are written once for a vector type T, so that the 
+            // vector body and the scalar tail perform exactly the same operations.
+
+            template <class T>
+            static inline void K_at(const double* U, const double* V, const double* m, double* K, atlas::idx_t x)
+            {
+                typename T::type u1 = T::load(U+x);
+                typename T::type v1 = T::load(V+x);
+                typename T::type mm = T::load(m+x);
+                T::store(K+x, T::mul(T::mul(T::mul(mm, mm), T::set1(0.5)), T::add(T::mul(u1, u1), T::mul(v1, v1))));
+            }
+
+            template <class T>
+            static inline void zeta_at(const double* Un, const double* Us, const double* V, const double* m, 
+                double dx2, double dy2, double* zeta, atlas::idx_t x)
+            {
+                typename T::type m1 = T::load(m+x);
+                typename T::type dv = T::div(T::sub(T::load(V+x+1), T::load(V+x-1)), T::set1(dx2));
+                typename T::type du = T::div(T::sub(T::load(Un+x), T::load(Us+x)), T::set1(dy2));
+                T::store(zeta+x, T::mul(T::mul(m1, m1), T::sub(dv, du)));
+            }
+
+            template <class T>
+            static inline void U_tdcy_at(const double* V, const double* phi, const double* zeta, const double* K, const double* f, 
+                double dx2, double* U_tdcy, atlas::idx_t x)
+            {
+                typename T::type kphi = T::div(
+                    T::sub(T::sub(T::add(T::load(K+x+1), T::load(phi+x+1)), T::load(K+x-1)), T::load(phi+x-1)), 
+                    T::set1(dx2));
+                T::store(U_tdcy+x, T::sub(T::mul(T::add(T::load(zeta+x), T::load(f+x)), T::load(V+x)), kphi));
+            }
+
+            template <class T>
+            static inline void V_tdcy_at(const double* U, const double* phin, const double* phis, const double* zeta, 
+                const double* Kn, const double* Ks, const double* f, 
+                double dy2, double* V_tdcy, atlas::idx_t x)
+            {
+                typename T::type kphi = T::div(
+                    T::sub(T::sub(T::add(T::load(Kn+x), T::load(phin+x)), T::load(Ks+x)), T::load(phis+x)), 
+                    T::set1(dy2));
+                T::store(V_tdcy+x, T::sub(T::mul(T::neg(T::add(T::load(zeta+x), T::load(f+x))), T::load(U+x)), kphi));
+            }
+
+            template <class T>
+            static inline void phi_tdcy_at(const double* U, const double* Vn, const double* Vs, 
+                const double* phi, const double* phin, const double* phis, const double* m, 
+                double dx2, double dy2, double* phi_tdcy, atlas::idx_t x)
+            {
+                typename T::type mm = T::load(m+x);
+                typename T::type fx = T::div(
+                    T::sub(T::mul(T::load(phi+x+1), T::load(U+x+1)), T::mul(T::load(phi+x-1), T::load(U+x-1))), 
+                    T::set1(dx2));
+                typename T::type fy = T::div(
+                    T::sub(T::mul(T::load(phin+x), T::load(Vn+x)), T::mul(T::load(phis+x), T::load(Vs+x))), 
+                    T::set1(dy2));
+                T::store(phi_tdcy+x, T::mul(T::neg(T::mul(mm, mm)), T::add(fx, fy)));
+            }
+
+            template <class T>
+            static inline void a_bc_at(const double* x, const double* y, double c, double* z, atlas::idx_t i)
+            {
+                T::store(z+i, T::add(T::load(x+i), T::mul(T::set1(c), T::load(y+i))));
+            }
+
+            static void calcK(const double* U, const double* V, const double* m, 
+                double* K, atlas::idx_t xb, atlas::idx_t xe)
+            {
+                atlas::idx_t x = xb;
+                for(;x+Vec::width<=xe;x+=Vec::width) K_at<Vec>(U, V, m, K, x);
+                for(;x<xe;++x) K_at<ScalarVec>(U, V, m, K, x);
+            }
+
+            static void calcZeta(const double* Un, const double* Us, const double* V, const double* m, 
+                double dx2, double dy2, double* zeta, atlas::idx_t xb, atlas::idx_t xe)
+            {
+                atlas::idx_t x = xb;
+                for(;x+Vec::width<=xe;x+=Vec::width) zeta_at<Vec>(Un, Us, V, m, dx2, dy2, zeta, x);
+                for(;x<xe;++x) zeta_at<ScalarVec>(Un, Us, V, m, dx2, dy2, zeta, x);
+            }
+
+            static void calcU_tdcy(const double* V, const double* phi, const double* zeta, const double* K, const double* f, 
+                double dx2, double* U_tdcy, atlas::idx_t xb, atlas::idx_t xe)
+            {
+                atlas::idx_t x = xb;
+                for(;x+Vec::width<=xe;x+=Vec::width) U_tdcy_at<Vec>(V, phi, zeta, K, f, dx2, U_tdcy, x);
+                for(;x<xe;++x) U_tdcy_at<ScalarVec>(V, phi, zeta, K, f, dx2, U_tdcy, x);
+            }
+
+            static void calcV_tdcy(const double* U, const double* phin, const double* phis, const double* zeta, 
+                const double* Kn, const double* Ks, const double* f, 
+                double dy2, double* V_tdcy, atlas::idx_t xb, atlas::idx_t xe)
+            {
+                atlas::idx_t x = xb;
+                for(;x+Vec::width<=xe;x+=Vec::width) V_tdcy_at<Vec>(U, phin, phis, zeta, Kn, Ks, f, dy2, V_tdcy, x);
+                for(;x<xe;++x) V_tdcy_at<ScalarVec>(U, phin, phis, zeta, Kn, Ks, f, dy2, V_tdcy, x);
+            }
+
+            static void calcphi_tdcy(const double* U, const double* Vn, const double* Vs, 
+                const double* phi, const double* phin, const double* phis, const double* m, 
+                double dx2, double dy2, double* phi_tdcy, atlas::idx_t xb, atlas::idx_t xe)
+            {
+                atlas::idx_t x = xb;
+                for(;x+Vec::width<=xe;x+=Vec::width) phi_tdcy_at<Vec>(U, Vn, Vs, phi, phin, phis, m, dx2, dy2, phi_tdcy, x);
+                for(;x<xe;++x) phi_tdcy_at<ScalarVec>(U, Vn, Vs, phi, phin, phis, m, dx2, dy2, phi_tdcy, x);
+            }
+
+            static void a_bc(const double* x, const double* y, double c, double* z, atlas::idx_t n)
+            {
+                atlas::idx_t i = 0;
+                for(;i+Vec::width<=n;i+=Vec::width) a_bc_at<Vec>(x, y, c, z, i);
+                for(;i<n;++i) a_bc_at<ScalarVec>(x, y, c, z, i);
+            }
+
+            static StencilKernels table(const char* name)
+            {
+                return StencilKernels{ name, &calcK, &calcZeta, &calcU_tdcy, &calcV_tdcy, &calcphi_tdcy, &a_bc };
+            }
+        };
+    }
+}
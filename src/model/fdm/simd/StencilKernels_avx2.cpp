@@ -0,0 +1,28 @@
+#include "StencilKernelsImpl.h"
+#include <immintrin.h>
+
+// Compiled with -mavx2 -ffp-contract=off : FMA contraction would break 
+// the bit-for-bit equality with the scalar kernels.
+
+namespace pifo {
+    namespace simd {
+        struct Avx2Vec {
+            typedef __m256d type;
+            static const atlas::idx_t width = 4;
+            static inline type load(const double* p) { return _mm256_loadu_pd(p); }
+            static inline void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+            static inline type set1(double v) { return _mm256_set1_pd(v); }
+            static inline type add(type a, type b) { return _mm256_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm256_div_pd(a, b); }
+            static inline type neg(type a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+        };
+
+        const StencilKernels& avx2Kernels()
+        {
+            static const StencilKernels kernels = StencilKernelsImpl<Avx2Vec>::table("avx2");
+            return kernels;
+        }
+    }
+}
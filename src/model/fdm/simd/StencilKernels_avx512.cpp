@@ -0,0 +1,28 @@
+#include "StencilKernelsImpl.h"
+#include <immintrin.h>
+
+// Compiled with -mavx512f -ffp-contract=off : FMA contraction would break 
+// the bit-for-bit equality with the scalar kernels.
+
+namespace pifo {
+    namespace simd {
+        struct Avx512Vec {
+            typedef __m512d type;
+            static const atlas::idx_t width = 8;
+            static inline type load(const double* p) { return _mm512_loadu_pd(p); }
+            static inline void store(double* p, type v) { _mm512_storeu_pd(p, v); }
+            static inline type set1(double v) { return _mm512_set1_pd(v); }
+            static inline type add(type a, type b) { return _mm512_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm512_div_pd(a, b); }
+            static inline type neg(type a) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x8000000000000000LL))); }
+        };
+
+        const StencilKernels& avx512Kernels()
+        {
+            static const StencilKernels kernels = StencilKernelsImpl<Avx512Vec>::table("avx512");
+            return kernels;
+        }
+    }
+}
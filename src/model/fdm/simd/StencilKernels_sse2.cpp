@@ -0,0 +1,25 @@
+#include "StencilKernelsImpl.h"
+#include <immintrin.h>
+
+namespace pifo {
+    namespace simd {
+        struct Sse2Vec {
+            typedef __m128d type;
+            static const atlas::idx_t width = 2;
+            static inline type load(const double* p) { return _mm_loadu_pd(p); }
+            static inline void store(double* p, type v) { _mm_storeu_pd(p, v); }
+            static inline type set1(double v) { return _mm_set1_pd(v); }
+            static inline type add(type a, type b) { return _mm_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm_div_pd(a, b); }
+            static inline type neg(type a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+        };
+
+        const StencilKernels& sse2Kernels()
+        {
+            static const StencilKernels kernels = StencilKernelsImpl<Sse2Vec>::table("sse2");
+            return kernels;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "AlignedBuffer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace pifo {
+    namespace {
+        const size_t hugePageSize = 2*1024*1024;
+    }
+
+    AllocationPolicy::AllocationPolicy(const atlas::util::Config& config)
+    {
+        alignment = config.getLong("alignment", 64);
+        if (alignment<sizeof(void*) || (alignment&(alignment-1))!=0)
+        {
+            throw std::runtime_error("alignment must be a power of two of at least "+std::to_string(sizeof(void*))+" bytes");
+        }
+        hugePages = config.getString("huge_pages", "none");
+        if (hugePages!="none" && hugePages!="transparent" && hugePages!="explicit")
+        {
+            throw std::runtime_error("unknown huge_pages '"+hugePages+"'");
+        }
+#ifndef __linux__
+        if (hugePages!="none")
+        {
+            throw std::runtime_error("huge_pages "+hugePages+" is only available on Linux");
+        }
+#endif
+    }
+
+    size_t AllocationPolicy::paddedStride(size_t n, size_t elementSize) const
+    {
+        size_t rowBytes = (n*elementSize+alignment-1)/alignment*alignment;
+        // an alignment smaller than the element keeps the rows contiguous
+        while (rowBytes%elementSize!=0)
+        {
+            rowBytes += alignment;
+        }
+        return rowBytes/elementSize;
+    }
+
+    std::string AllocationPolicy::describe() const
+    {
+        std::ostringstream out;
+        out << "alignment " << alignment << " bytes, huge pages " << hugePages;
+        return out.str();
+    }
+
+    AlignedBuffer::AlignedBuffer(size_t pBytes, const AllocationPolicy& policy)
+        : memory(nullptr), bytes(pBytes), mapped(0)
+    {
+#ifdef __linux__
+        if (policy.getHugePages()!="none")
+        {
+            mapped = (std::max(bytes, (size_t)1)+hugePageSize-1)/hugePageSize*hugePageSize;
+            bool explicitPages = policy.getHugePages()=="explicit";
+            // the transparent huge pages need a 2 MB aligned range : map 2 MB
+            // more and unmap the unaligned head and tail
+            size_t request = explicitPages ? mapped : mapped+hugePageSize;
+            // without MAP_NORESERVE, mmap fails instead of a SIGBUS at the
+            // first write if the hugetlbfs pool is too small
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | (explicitPages ? MAP_HUGETLB : 0);
+            void* base = mmap(nullptr, request, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (base==MAP_FAILED)
+            {
+                mapped = 0;
+                throw std::runtime_error("could not map "+std::to_string(bytes)+" bytes of "+policy.getHugePages()
+                    +" huge pages (see vm.nr_hugepages)");
+            }
+            memory = base;
+            if (!explicitPages)
+            {
+                uintptr_t start = (uintptr_t)base;
+                uintptr_t aligned = (start+hugePageSize-1)/hugePageSize*hugePageSize;
+                if (aligned>start)
+                {
+                    munmap(base, aligned-start);
+                }
+                if (aligned+mapped<start+request)
+                {
+                    munmap((void*)(aligned+mapped), start+request-aligned-mapped);
+                }
+                memory = (void*)aligned;
+                madvise(memory, mapped, MADV_HUGEPAGE);
+            }
+            return;
+        }
+#endif
+        if (posix_memalign(&memory, policy.getAlignment(), std::max(bytes, (size_t)1))!=0)
+        {
+            memory = nullptr;
+            throw std::runtime_error("could not allocate "+std::to_string(bytes)+" bytes");
+        }
+    }
+
+    AlignedBuffer::~AlignedBuffer()
+    {
+#ifdef __linux__
+        if (mapped>0)
+        {
+            munmap(memory, mapped);
+            return;
+        }
+#endif
+        free(memory);
+    }
+}
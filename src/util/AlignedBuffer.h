@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "atlas/util/Config.h"
+
+namespace pifo {
+    /**
+     * Alignment and page size of the large arrays.
+     *
+     * <p>Configuration keys :</p>
+     * <ul>
+     * <li>alignment : alignment in bytes of the arrays and of their padded
+     * rows, a power of two (default 64, a cache line and an AVX-512
+     * vector).</li>
+     * <li>huge_pages : none (default) for the pages of the system,
+     * transparent to ask the kernel for transparent huge pages
+     * (madvise, needs /sys/kernel/mm/transparent_hugepage/enabled set to
+     * always or madvise), explicit for pages of the hugetlbfs pool
+     * (mmap MAP_HUGETLB, needs vm.nr_hugepages). Huge page arrays are
+     * aligned and rounded to 2 MB.</li>
+     * </ul>
+     */
+    class AllocationPolicy {
+    public:
+        AllocationPolicy(const atlas::util::Config& config = atlas::util::Config());
+
+        size_t getAlignment() const
+        {
+            return alignment;
+        }
+
+        const std::string& getHugePages() const
+        {
+            return hugePages;
+        }
+
+        /**
+         * Number of elements between the starts of two rows of n elements
+         * of elementSize bytes, so that every row is aligned.
+         */
+        size_t paddedStride(size_t n, size_t elementSize) const;
+
+        /**
+         * Description of the policy for the log.
+         */
+        std::string describe() const;
+
+    private:
+        size_t alignment;
+        std::string hugePages;
+    };
+
+    /**
+     * Array of bytes allocated with an AllocationPolicy. The memory is not
+     * initialized : its pages are only allocated when first written, by the
+     * thread that writes them.
+     */
+    class AlignedBuffer {
+    public:
+        AlignedBuffer(size_t bytes, const AllocationPolicy& policy);
+        ~AlignedBuffer();
+
+        AlignedBuffer(const AlignedBuffer&) = delete;
+        AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+        void* data() const
+        {
+            return memory;
+        }
+
+        size_t size() const
+        {
+            return bytes;
+        }
+
+    private:
+        void* memory;
+        size_t bytes;
+        // size of the mapping, 0 if allocated by posix_memalign
+        size_t mapped;
+    };
+}
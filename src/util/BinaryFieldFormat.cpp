@@ -0,0 +1,208 @@
+#include "BinaryFieldFormat.h"
+#include "atlas/array/ArrayView.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pifo {
+    namespace {
+        const char magic[8] = { 'P', 'I', 'F', 'O', 'F', 'L', 'D', 0 };
+        const uint32_t version = 1;
+        const uint64_t alignment = 64;
+        // degrees, well below the spacing of any grid of the model, above
+        // the rounding of the projections
+        const double lonLatTolerance = 1e-6;
+
+        // the layout of the header is the same for all the compilers
+        static_assert(sizeof(BinaryFieldHeader)==112, "unexpected padding of BinaryFieldHeader");
+
+        void checkLittleEndian()
+        {
+            const uint16_t probe = 1;
+            if (*(const unsigned char*)&probe!=1)
+            {
+                throw std::runtime_error("the binary field format is only supported on little-endian hosts");
+            }
+        }
+
+        std::string projectionType(const atlas::RegularGrid& grid)
+        {
+            return grid.projection().type().substr(0, sizeof(BinaryFieldHeader::projection)-1);
+        }
+
+        // longitudes are compared modulo 360
+        bool sameLonLat(double lon, double lat, const atlas::PointLonLat& point)
+        {
+            double dlon = std::fmod(std::abs(lon-point.lon()), 360.);
+            return std::min(dlon, 360.-dlon)<=lonLatTolerance && std::abs(lat-point.lat())<=lonLatTolerance;
+        }
+
+        std::string lonLatString(double lon, double lat)
+        {
+            return "("+std::to_string(lon)+", "+std::to_string(lat)+")";
+        }
+    }
+
+    MappedFieldFile::MappedFieldFile(const std::string& file)
+        : memory(nullptr), bytes(0)
+    {
+        checkLittleEndian();
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd<0)
+        {
+            throw std::runtime_error("could not open "+file);
+        }
+        struct stat status;
+        if (fstat(fd, &status)!=0 || (size_t)status.st_size<sizeof(BinaryFieldHeader))
+        {
+            close(fd);
+            throw std::runtime_error(file+" is not a binary field file (too short)");
+        }
+        bytes = status.st_size;
+        memory = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file open
+        close(fd);
+        if (memory==MAP_FAILED)
+        {
+            memory = nullptr;
+            throw std::runtime_error("could not map "+file);
+        }
+        madvise(memory, bytes, MADV_SEQUENTIAL);
+
+        const BinaryFieldHeader& h = header();
+        std::string error;
+        if (std::memcmp(h.magic, magic, sizeof(magic))!=0)
+        {
+            error = " is not a binary field file";
+        }
+        else if (h.version!=version)
+        {
+            error = " has the unsupported version "+std::to_string(h.version);
+        }
+        else if (h.elementSize!=sizeof(double) && h.elementSize!=sizeof(float))
+        {
+            error = " has values of "+std::to_string(h.elementSize)+" bytes";
+        }
+        else if (h.nx<0 || h.ny<0 || h.dataOffset<sizeof(BinaryFieldHeader) || h.dataOffset%alignment!=0
+            || h.dataOffset+(uint64_t)h.nx*h.ny*h.elementSize>bytes)
+        {
+            error = " is truncated or corrupted";
+        }
+        if (!error.empty())
+        {
+            munmap(memory, bytes);
+            memory = nullptr;
+            throw std::runtime_error(file+error);
+        }
+    }
+
+    MappedFieldFile::~MappedFieldFile()
+    {
+        if (memory!=nullptr)
+        {
+            munmap(memory, bytes);
+        }
+    }
+
+    void BinaryFieldFormat::readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field)
+    {
+        MappedFieldFile mapped(file);
+        const BinaryFieldHeader& h = mapped.header();
+        if (h.nx!=grid.nx() || h.ny!=grid.ny()) throw std::runtime_error("file has not the same dimension as the grid to load. "+std::to_string(h.nx)+" "+std::to_string(h.ny));
+        std::string projection(h.projection, strnlen(h.projection, sizeof(h.projection)));
+        if (projection!=projectionType(grid))
+        {
+            throw std::runtime_error(file+" is on a "+projection+" projection, the grid on a "+projectionType(grid)+" projection");
+        }
+        // a domain of the same size elsewhere
+        atlas::PointLonLat first = grid.lonlat(0, 0);
+        atlas::PointLonLat last = grid.lonlat(grid.nx()-1, grid.ny()-1);
+        if (!sameLonLat(h.lonFirst, h.latFirst, first) || !sameLonLat(h.lonLast, h.latLast, last))
+        {
+            throw std::runtime_error(file+" spans "+lonLatString(h.lonFirst, h.latFirst)+" to "
+                +lonLatString(h.lonLast, h.latLast)+", the grid "+lonLatString(first.lon(), first.lat())+" to "
+                +lonLatString(last.lon(), last.lat()));
+        }
+
+        auto field_view = atlas::array::make_view<double, 1>(field);
+        atlas::idx_t size = grid.nx()*grid.ny();
+        if (h.elementSize==sizeof(double))
+        {
+            const double* values = (const double*)mapped.values();
+            for (atlas::idx_t k=0;k<size;k++)
+            {
+                field_view(k) = values[k];
+            }
+        }
+        else
+        {
+            const float* values = (const float*)mapped.values();
+            for (atlas::idx_t k=0;k<size;k++)
+            {
+                field_view(k) = values[k];
+            }
+        }
+    }
+
+    void BinaryFieldFormat::writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+        double time, bool float32)
+    {
+        checkLittleEndian();
+        auto field_view = atlas::array::make_view<double, 1>(field);
+        atlas::idx_t size = grid.nx()*grid.ny();
+
+        BinaryFieldHeader h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.elementSize = float32 ? sizeof(float) : sizeof(double);
+        h.nx = grid.nx();
+        h.ny = grid.ny();
+        h.time = time;
+        h.dataOffset = (sizeof(h)+alignment-1)/alignment*alignment;
+        std::string projection = projectionType(grid);
+        std::memcpy(h.projection, projection.data(), projection.size());
+        atlas::PointLonLat first = grid.lonlat(0, 0);
+        atlas::PointLonLat last = grid.lonlat(grid.nx()-1, grid.ny()-1);
+        h.lonFirst = first.lon();
+        h.latFirst = first.lat();
+        h.lonLast = last.lon();
+        h.latLast = last.lat();
+
+        // the header, its padding and the values in one buffer and one write
+        std::vector<char> buffer(h.dataOffset+(size_t)size*h.elementSize, 0);
+        std::memcpy(buffer.data(), &h, sizeof(h));
+        if (float32)
+        {
+            float* values = (float*)(buffer.data()+h.dataOffset);
+            for (atlas::idx_t k=0;k<size;k++)
+            {
+                values[k] = (float)field_view(k);
+            }
+        }
+        else
+        {
+            double* values = (double*)(buffer.data()+h.dataOffset);
+            for (atlas::idx_t k=0;k<size;k++)
+            {
+                values[k] = field_view(k);
+            }
+        }
+
+        std::ofstream outfile(file, std::ofstream::binary | std::ofstream::trunc);
+        outfile.write(buffer.data(), buffer.size());
+        outfile.close();
+        if (!outfile)
+        {
+            throw std::runtime_error("could not write "+file);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "atlas/grid.h"
+#include "atlas/field.h"
+
+namespace pifo {
+    /**
+     * Header of a binary field file : the magic "PIFOFLD", the version, the
+     * size of the values (8 for double, 4 for float), the dimensions, the
+     * type of the projection and the longitudes and latitudes of the first
+     * and last points of the grid, the model time in seconds, and the
+     * offset of the values from the start of the file, a multiple of 64.
+     * The values follow, nx*ny little-endian values row after row as in
+     * the fields of the model.
+     */
+    struct BinaryFieldHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t elementSize;
+        int64_t nx;
+        int64_t ny;
+        double time;
+        uint64_t dataOffset;
+        char projection[32];
+        double lonFirst;
+        double latFirst;
+        double lonLast;
+        double latLast;
+    };
+
+    /**
+     * Binary field file mapped read-only in memory : the values are read
+     * from the page cache without a copy or a parse.
+     */
+    class MappedFieldFile {
+    public:
+        explicit MappedFieldFile(const std::string& file);
+        ~MappedFieldFile();
+
+        MappedFieldFile(const MappedFieldFile&) = delete;
+        MappedFieldFile& operator=(const MappedFieldFile&) = delete;
+
+        const BinaryFieldHeader& header() const
+        {
+            return *(const BinaryFieldHeader*)memory;
+        }
+
+        /**
+         * The values, double or float according to header().elementSize.
+         */
+        const void* values() const
+        {
+            return (const char*)memory+header().dataOffset;
+        }
+
+    private:
+        void* memory;
+        size_t bytes;
+    };
+
+    /**
+     * Binary format of the fields, replacing the text files of WGribFormat
+     * for the inputs and outputs of the model. Only little-endian hosts are
+     * supported.
+     */
+    class BinaryFieldFormat {
+        public:
+            static const char* extension()
+            {
+                return ".fld";
+            }
+
+            /**
+             * Read a global field of type double, after a check of the
+             * dimensions, the projection and the longitudes and latitudes
+             * of the first and last points (within 1e-6 degree) against 
+             * the grid.
+             */
+            static void readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field);
+
+            /**
+             * Write a global field of type double, with the model time, the
+             * values stored as float if float32 (half the size, about 7
+             * significant digits).
+             */
+            static void writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+                double time = 0, bool float32 = false);
+    };
+}
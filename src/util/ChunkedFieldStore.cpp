@@ -0,0 +1,490 @@
+#include "ChunkedFieldStore.h"
+#include "atlas/array/ArrayView.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace pifo {
+    namespace {
+        const char magic[8] = { 'P', 'I', 'F', 'O', 'C', 'F', 'S', 0 };
+        const char recordMagic[8] = { 'P', 'I', 'F', 'O', 'R', 'E', 'C', 0 };
+        const uint32_t version = 1;
+        const uint32_t storedMethod = 0;
+        const uint32_t deflateMethod = 1;
+        const int mantissaBits = 52;
+
+        // the layout of the headers is the same for all the compilers
+        static_assert(sizeof(ChunkedFieldHeader)==112, "unexpected padding of ChunkedFieldHeader");
+        static_assert(sizeof(ChunkedFieldRecord)==32, "unexpected padding of ChunkedFieldRecord");
+        static_assert(sizeof(ChunkedFieldChunk)==16, "unexpected padding of ChunkedFieldChunk");
+
+        void checkLittleEndian()
+        {
+            const uint16_t probe = 1;
+            if (*(const unsigned char*)&probe!=1)
+            {
+                throw std::runtime_error("the chunked field format is only supported on little-endian hosts");
+            }
+        }
+
+        std::string projectionType(const atlas::RegularGrid& grid)
+        {
+            return grid.projection().type().substr(0, sizeof(ChunkedFieldHeader::projection)-1);
+        }
+
+        /**
+         * The chunks of the grid, row of chunks after row of chunks.
+         */
+        struct ChunkGrid {
+            explicit ChunkGrid(const ChunkedFieldHeader& h)
+                : h(h), columns((h.nx+h.chunkNx-1)/h.chunkNx), rows((h.ny+h.chunkNy-1)/h.chunkNy)
+            {
+            }
+
+            int64_t count() const
+            {
+                return columns*rows;
+            }
+
+            int64_t i0(int64_t c) const
+            {
+                return c%columns*h.chunkNx;
+            }
+
+            int64_t j0(int64_t c) const
+            {
+                return c/columns*h.chunkNy;
+            }
+
+            int64_t ni(int64_t c) const
+            {
+                return std::min(h.chunkNx, h.nx-i0(c));
+            }
+
+            int64_t nj(int64_t c) const
+            {
+                return std::min(h.chunkNy, h.ny-j0(c));
+            }
+
+            const ChunkedFieldHeader& h;
+            int64_t columns;
+            int64_t rows;
+        };
+
+        // Round to the nearest value with keepBits bits of mantissa, ties to
+        // even : the trailing bits are 0, which the compression removes.
+        // Infinities and NaNs are left as they are, and so are the finite
+        // values whose carry would round them up to infinity.
+        void roundBits(double* values, size_t n, int keepBits)
+        {
+            if (keepBits<=0 || keepBits>=mantissaBits)
+            {
+                return;
+            }
+            const int shift = mantissaBits-keepBits;
+            const uint64_t exponent = 0x7ff0000000000000ull;
+            const uint64_t half = (uint64_t(1)<<(shift-1))-1;
+            const uint64_t mask = ~((uint64_t(1)<<shift)-1);
+            for (size_t k=0;k<n;k++)
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &values[k], sizeof(bits));
+                if ((bits & exponent)!=exponent)
+                {
+                    uint64_t rounded = (bits+half+((bits>>shift)&1)) & mask;
+                    if ((rounded & exponent)!=exponent)
+                    {
+                        std::memcpy(&values[k], &rounded, sizeof(rounded));
+                    }
+                }
+            }
+        }
+
+        // the bytes of the values regrouped by significance : the exponents
+        // and leading bits of neighbouring values compress together
+        void shuffle(const double* values, size_t n, unsigned char* bytes)
+        {
+            auto from = (const unsigned char*)values;
+            for (size_t k=0;k<n;k++)
+            {
+                for (size_t b=0;b<sizeof(double);b++)
+                {
+                    bytes[b*n+k] = from[k*sizeof(double)+b];
+                }
+            }
+        }
+
+        void unshuffle(const unsigned char* bytes, size_t n, double* values)
+        {
+            auto to = (unsigned char*)values;
+            for (size_t k=0;k<n;k++)
+            {
+                for (size_t b=0;b<sizeof(double);b++)
+                {
+                    to[k*sizeof(double)+b] = bytes[b*n+k];
+                }
+            }
+        }
+
+        /**
+         * Decode a chunk of n values.
+         */
+        void decodeChunk(const char* data, const ChunkedFieldChunk& chunk, size_t n, double* values, const std::string& file)
+        {
+            size_t raw = n*sizeof(double);
+            if (chunk.method==storedMethod && chunk.bytes==raw)
+            {
+                std::memcpy(values, data, raw);
+                return;
+            }
+            std::vector<unsigned char> bytes(raw);
+            uLongf length = raw;
+            if (chunk.method!=deflateMethod
+                || uncompress(bytes.data(), &length, (const Bytef*)data, chunk.bytes)!=Z_OK || length!=raw)
+            {
+                throw std::runtime_error(file+" has a corrupted chunk");
+            }
+            unshuffle(bytes.data(), n, values);
+        }
+
+        void readAt(int fd, void* data, size_t bytes, uint64_t offset, const std::string& file)
+        {
+            auto to = (char*)data;
+            while (bytes>0)
+            {
+                ssize_t n = pread(fd, to, bytes, offset);
+                if (n<=0)
+                {
+                    throw std::runtime_error(file+" is truncated");
+                }
+                to += n;
+                bytes -= n;
+                offset += n;
+            }
+        }
+
+        void writeAt(int fd, const char* data, size_t bytes, uint64_t offset, const std::string& file)
+        {
+            while (bytes>0)
+            {
+                ssize_t n = pwrite(fd, data, bytes, offset);
+                if (n<0)
+                {
+                    throw std::runtime_error("could not write "+file);
+                }
+                data += n;
+                bytes -= n;
+                offset += n;
+            }
+        }
+    }
+
+    ChunkedFieldWriter::ChunkedFieldWriter(const std::string& pFile, const atlas::RegularGrid& grid,
+        const ChunkedFieldEncoding& pEncoding)
+        : file(pFile), encoding(pEncoding), fd(-1), end(0), raw(0)
+    {
+        checkLittleEndian();
+        if (encoding.chunkNx<=0 || encoding.chunkNy<=0)
+        {
+            throw std::runtime_error("the chunks of "+file+" are empty");
+        }
+        if (encoding.keepBits<0 || encoding.keepBits>mantissaBits)
+        {
+            throw std::runtime_error("keepBits must be between 0 and "+std::to_string(mantissaBits));
+        }
+        // a chunk is compressed in one call of zlib
+        if ((uint64_t)encoding.chunkNx*encoding.chunkNy*sizeof(double)>=(uint64_t(1)<<31))
+        {
+            throw std::runtime_error("the chunks of "+file+" are larger than 2 GB");
+        }
+
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.keepBits = encoding.keepBits;
+        header.nx = grid.nx();
+        header.ny = grid.ny();
+        header.chunkNx = std::min<int64_t>(encoding.chunkNx, std::max<int64_t>(header.nx, 1));
+        header.chunkNy = std::min<int64_t>(encoding.chunkNy, std::max<int64_t>(header.ny, 1));
+        std::string projection = projectionType(grid);
+        std::memcpy(header.projection, projection.data(), projection.size());
+        atlas::PointLonLat first = grid.lonlat(0, 0);
+        atlas::PointLonLat last = grid.lonlat(grid.nx()-1, grid.ny()-1);
+        header.lonFirst = first.lon();
+        header.latFirst = first.lat();
+        header.lonLast = last.lon();
+        header.latLast = last.lat();
+
+        fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd<0)
+        {
+            throw std::runtime_error("could not create "+file);
+        }
+        writeAt(fd, (const char*)&header, sizeof(header), 0, file);
+        end = sizeof(header);
+    }
+
+    ChunkedFieldWriter::~ChunkedFieldWriter()
+    {
+        close(fd);
+    }
+
+    void ChunkedFieldWriter::write(const atlas::Field& field, double time)
+    {
+        auto field_view = atlas::array::make_view<double, 1>(field);
+        ChunkGrid chunks(header);
+        int64_t count = chunks.count();
+        std::vector<std::vector<char>> encoded(count);
+        std::vector<uint32_t> methods(count);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(std::max(encoding.threads, 1))
+        for (int64_t c=0;c<count;c++)
+        {
+            int64_t i0 = chunks.i0(c), j0 = chunks.j0(c), ni = chunks.ni(c), nj = chunks.nj(c);
+            size_t n = ni*nj;
+            std::vector<double> values(n);
+            for (int64_t j=0;j<nj;j++)
+            {
+                for (int64_t i=0;i<ni;i++)
+                {
+                    values[j*ni+i] = field_view((j0+j)*header.nx+i0+i);
+                }
+            }
+            roundBits(values.data(), n, encoding.keepBits);
+
+            std::vector<unsigned char> bytes(n*sizeof(double));
+            shuffle(values.data(), n, bytes.data());
+            uLongf length = compressBound(bytes.size());
+            encoded[c].resize(length);
+            if (compress2((Bytef*)encoded[c].data(), &length, bytes.data(), bytes.size(), encoding.level)==Z_OK
+                && length<bytes.size())
+            {
+                encoded[c].resize(length);
+                methods[c] = deflateMethod;
+            }
+            else
+            {
+                encoded[c].assign((const char*)values.data(), (const char*)values.data()+bytes.size());
+                methods[c] = storedMethod;
+            }
+        }
+
+        // the record in one buffer and one write
+        ChunkedFieldRecord record;
+        std::memset(&record, 0, sizeof(record));
+        std::memcpy(record.magic, recordMagic, sizeof(recordMagic));
+        record.time = time;
+        record.chunks = count;
+        std::vector<ChunkedFieldChunk> table(count);
+        uint64_t offset = sizeof(record)+count*sizeof(ChunkedFieldChunk);
+        for (int64_t c=0;c<count;c++)
+        {
+            table[c].offset = offset;
+            table[c].bytes = encoded[c].size();
+            table[c].method = methods[c];
+            offset += encoded[c].size();
+        }
+        record.bytes = offset;
+
+        std::vector<char> buffer(offset);
+        std::memcpy(buffer.data(), &record, sizeof(record));
+        std::memcpy(buffer.data()+sizeof(record), table.data(), count*sizeof(ChunkedFieldChunk));
+        for (int64_t c=0;c<count;c++)
+        {
+            std::memcpy(buffer.data()+table[c].offset, encoded[c].data(), encoded[c].size());
+        }
+        writeAt(fd, buffer.data(), buffer.size(), end, file);
+        end += buffer.size();
+        raw += (size_t)header.nx*header.ny*sizeof(double);
+    }
+
+    ChunkedFieldReader::ChunkedFieldReader(const std::string& pFile)
+        : file(pFile), fd(open(pFile.c_str(), O_RDONLY))
+    {
+        checkLittleEndian();
+        if (fd<0)
+        {
+            throw std::runtime_error("could not open "+file);
+        }
+        struct stat status;
+        if (fstat(fd, &status)!=0 || (size_t)status.st_size<sizeof(header))
+        {
+            close(fd);
+            throw std::runtime_error(file+" is not a chunked field file (too short)");
+        }
+        uint64_t size = status.st_size;
+        readAt(fd, &header, sizeof(header), 0, file);
+        std::string error;
+        if (std::memcmp(header.magic, magic, sizeof(magic))!=0)
+        {
+            error = " is not a chunked field file";
+        }
+        else if (header.version!=version)
+        {
+            error = " has the unsupported version "+std::to_string(header.version);
+        }
+        else if (header.nx<0 || header.ny<0 || header.chunkNx<=0 || header.chunkNy<=0)
+        {
+            error = " is corrupted";
+        }
+        if (!error.empty())
+        {
+            close(fd);
+            throw std::runtime_error(file+error);
+        }
+
+        // the headers of the records, up to the end of the file or to a
+        // record not written to its end
+        uint64_t count = ChunkGrid(header).count();
+        uint64_t offset = sizeof(header);
+        while (offset+sizeof(ChunkedFieldRecord)<=size)
+        {
+            ChunkedFieldRecord record;
+            readAt(fd, &record, sizeof(record), offset, file);
+            uint64_t tableEnd = sizeof(record)+count*sizeof(ChunkedFieldChunk);
+            if (std::memcmp(record.magic, recordMagic, sizeof(recordMagic))!=0 || record.chunks!=count
+                || record.bytes<tableEnd || offset+record.bytes>size)
+            {
+                break;
+            }
+            Record r{ record.time, offset, std::vector<ChunkedFieldChunk>(count) };
+            readAt(fd, r.chunks.data(), count*sizeof(ChunkedFieldChunk), offset+sizeof(record), file);
+            for (const ChunkedFieldChunk& chunk : r.chunks)
+            {
+                if (chunk.offset<tableEnd || chunk.offset+chunk.bytes>record.bytes)
+                {
+                    close(fd);
+                    throw std::runtime_error(file+" is corrupted");
+                }
+            }
+            records.push_back(std::move(r));
+            offset += record.bytes;
+        }
+    }
+
+    ChunkedFieldReader::~ChunkedFieldReader()
+    {
+        close(fd);
+    }
+
+    void ChunkedFieldReader::readField(size_t record, const atlas::RegularGrid& grid, atlas::Field& field) const
+    {
+        if (header.nx!=grid.nx() || header.ny!=grid.ny()) throw std::runtime_error("file has not the same dimension as the grid to load. "+std::to_string(header.nx)+" "+std::to_string(header.ny));
+        std::string projection(header.projection, strnlen(header.projection, sizeof(header.projection)));
+        if (projection!=projectionType(grid))
+        {
+            throw std::runtime_error(file+" is on a "+projection+" projection, the grid on a "+projectionType(grid)+" projection");
+        }
+        if (record>=records.size())
+        {
+            throw std::runtime_error(file+" has no record "+std::to_string(record));
+        }
+
+        // the record in one read, its chunks decoded in parallel
+        const Record& r = records[record];
+        const ChunkedFieldChunk& last = r.chunks.back();
+        std::vector<char> data(last.offset+last.bytes);
+        readAt(fd, data.data(), data.size(), r.offset, file);
+
+        auto field_view = atlas::array::make_view<double, 1>(field);
+        ChunkGrid chunks(header);
+        int64_t count = chunks.count();
+        std::vector<std::string> errors(count);
+        #pragma omp parallel for schedule(dynamic)
+        for (int64_t c=0;c<count;c++)
+        {
+            int64_t i0 = chunks.i0(c), j0 = chunks.j0(c), ni = chunks.ni(c), nj = chunks.nj(c);
+            std::vector<double> values(ni*nj);
+            try
+            {
+                decodeChunk(data.data()+r.chunks[c].offset, r.chunks[c], values.size(), values.data(), file);
+            }
+            catch (const std::exception& ex)
+            {
+                errors[c] = ex.what();
+                continue;
+            }
+            for (int64_t j=0;j<nj;j++)
+            {
+                for (int64_t i=0;i<ni;i++)
+                {
+                    field_view((j0+j)*header.nx+i0+i) = values[j*ni+i];
+                }
+            }
+        }
+        for (const std::string& error : errors)
+        {
+            if (!error.empty())
+            {
+                throw std::runtime_error(error);
+            }
+        }
+    }
+
+    void ChunkedFieldReader::readRegion(size_t record, int64_t i0, int64_t j0, int64_t ni, int64_t nj, double* values) const
+    {
+        if (record>=records.size())
+        {
+            throw std::runtime_error(file+" has no record "+std::to_string(record));
+        }
+        if (i0<0 || j0<0 || ni<0 || nj<0 || i0+ni>header.nx || j0+nj>header.ny)
+        {
+            throw std::runtime_error("the region is not inside the grid of "+file);
+        }
+        if (ni==0 || nj==0)
+        {
+            return;
+        }
+
+        // only the chunks covering the region are read and decoded
+        const Record& r = records[record];
+        ChunkGrid chunks(header);
+        std::vector<char> data;
+        std::vector<double> chunkValues;
+        for (int64_t cj=j0/header.chunkNy;cj<=(j0+nj-1)/header.chunkNy;cj++)
+        {
+            for (int64_t ci=i0/header.chunkNx;ci<=(i0+ni-1)/header.chunkNx;ci++)
+            {
+                int64_t c = cj*chunks.columns+ci;
+                const ChunkedFieldChunk& chunk = r.chunks[c];
+                data.resize(chunk.bytes);
+                readAt(fd, data.data(), chunk.bytes, r.offset+chunk.offset, file);
+                int64_t ci0 = chunks.i0(c), cj0 = chunks.j0(c), cni = chunks.ni(c), cnj = chunks.nj(c);
+                chunkValues.resize(cni*cnj);
+                decodeChunk(data.data(), chunk, chunkValues.size(), chunkValues.data(), file);
+
+                int64_t iBegin = std::max(i0, ci0), iEnd = std::min(i0+ni, ci0+cni);
+                int64_t jBegin = std::max(j0, cj0), jEnd = std::min(j0+nj, cj0+cnj);
+                for (int64_t j=jBegin;j<jEnd;j++)
+                {
+                    std::copy(chunkValues.begin()+(j-cj0)*cni+(iBegin-ci0), chunkValues.begin()+(j-cj0)*cni+(iEnd-ci0),
+                        values+(j-j0)*ni+(iBegin-i0));
+                }
+            }
+        }
+    }
+
+    void ChunkedFieldStore::readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field)
+    {
+        ChunkedFieldReader reader(file);
+        if (reader.times()==0)
+        {
+            throw std::runtime_error(file+" has no record");
+        }
+        reader.readField(reader.times()-1, grid, field);
+    }
+
+    void ChunkedFieldStore::writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+        double time, bool float32)
+    {
+        ChunkedFieldEncoding encoding;
+        encoding.keepBits = float32 ? 23 : 0;
+        ChunkedFieldWriter writer(file, grid, encoding);
+        writer.write(field, time);
+    }
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "atlas/grid.h"
+#include "atlas/field.h"
+
+namespace pifo {
+    /**
+     * Encoding of the chunks of a ChunkedFieldWriter.
+     */
+    struct ChunkedFieldEncoding {
+        // dimensions of the chunks, the last ones of a row or column are
+        // cut at the border of the grid
+        int64_t chunkNx = 256;
+        int64_t chunkNy = 256;
+        // significant bits kept of the 52 of the mantissa, 0 keeps all
+        // (lossless). The values are rounded to the nearest with keepBits
+        // bits : the relative error is at most 2^-(keepBits+1), 23 bits are
+        // the precision of a float.
+        int keepBits = 0;
+        // level of the deflate compression, 1 (fastest) to 9 (smallest)
+        int level = 1;
+        // threads encoding the chunks of a field
+        int threads = 1;
+    };
+
+    /**
+     * Header of a chunked field file : the magic "PIFOCFS", the version, the
+     * dimensions of the grid and of the chunks, the bits kept of the
+     * mantissa, the type of the projection and the longitudes and latitudes
+     * of the first and last points of the grid.
+     *
+     * <p>The records of the field follow, one per model time : a
+     * ChunkedFieldRecord, a ChunkedFieldChunk per chunk (row of chunks after
+     * row of chunks), and the encoded chunks. A chunk is its values row
+     * after row, little-endian doubles whose bytes are regrouped by
+     * significance (the 8 first bytes, then the 8 second ...) and
+     * compressed with deflate (zlib), or left as they are when the
+     * compression does not reduce them.</p>
+     */
+    struct ChunkedFieldHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t keepBits;
+        int64_t nx;
+        int64_t ny;
+        int64_t chunkNx;
+        int64_t chunkNy;
+        char projection[32];
+        double lonFirst;
+        double latFirst;
+        double lonLast;
+        double latLast;
+    };
+
+    struct ChunkedFieldRecord {
+        char magic[8];
+        double time;
+        // bytes of the record, its header and chunks included
+        uint64_t bytes;
+        uint64_t chunks;
+    };
+
+    struct ChunkedFieldChunk {
+        // from the start of the record
+        uint64_t offset;
+        uint32_t bytes;
+        // 0 as they are, 1 regrouped and compressed
+        uint32_t method;
+    };
+
+    /**
+     * Writes the values of a field at successive times to a chunked field
+     * file, created or truncated by the constructor. Each record is
+     * written whole at the end of the file : the records of a run killed
+     * while writing are readable but the last.
+     */
+    class ChunkedFieldWriter {
+    public:
+        ChunkedFieldWriter(const std::string& file, const atlas::RegularGrid& grid,
+            const ChunkedFieldEncoding& encoding = ChunkedFieldEncoding());
+        ~ChunkedFieldWriter();
+
+        ChunkedFieldWriter(const ChunkedFieldWriter&) = delete;
+        ChunkedFieldWriter& operator=(const ChunkedFieldWriter&) = delete;
+
+        /**
+         * Append the global field of type double at the model time, the
+         * chunks encoded in parallel by encoding.threads threads.
+         */
+        void write(const atlas::Field& field, double time);
+
+        /**
+         * Bytes of the file, and bytes of the values written as doubles.
+         */
+        size_t size() const
+        {
+            return end;
+        }
+
+        size_t rawSize() const
+        {
+            return raw;
+        }
+
+    private:
+        std::string file;
+        ChunkedFieldEncoding encoding;
+        ChunkedFieldHeader header;
+        int fd;
+        size_t end;
+        size_t raw;
+    };
+
+    /**
+     * Reads a chunked field file : the constructor reads the headers of the
+     * records only, a field or a region of it is read from the chunks it
+     * covers.
+     */
+    class ChunkedFieldReader {
+    public:
+        explicit ChunkedFieldReader(const std::string& file);
+        ~ChunkedFieldReader();
+
+        ChunkedFieldReader(const ChunkedFieldReader&) = delete;
+        ChunkedFieldReader& operator=(const ChunkedFieldReader&) = delete;
+
+        const ChunkedFieldHeader& getHeader() const
+        {
+            return header;
+        }
+
+        /**
+         * Number of records and model time of a record.
+         */
+        size_t times() const
+        {
+            return records.size();
+        }
+
+        double time(size_t record) const
+        {
+            return records[record].time;
+        }
+
+        /**
+         * Read a record into a global field of type double, after a check
+         * of the dimensions and of the projection against the grid.
+         */
+        void readField(size_t record, const atlas::RegularGrid& grid, atlas::Field& field) const;
+
+        /**
+         * Read the points [i0, i0+ni) x [j0, j0+nj) of a record, row after
+         * row, into values (ni*nj values).
+         */
+        void readRegion(size_t record, int64_t i0, int64_t j0, int64_t ni, int64_t nj, double* values) const;
+
+    private:
+        struct Record {
+            double time;
+            uint64_t offset;
+            std::vector<ChunkedFieldChunk> chunks;
+        };
+
+        std::string file;
+        ChunkedFieldHeader header;
+        int fd;
+        std::vector<Record> records;
+    };
+
+    /**
+     * Chunked, compressed format of the fields, for the outputs : a file
+     * holds the values of a field at several times, of which one time or
+     * one region is read without the rest of the file. Only little-endian
+     * hosts are supported.
+     */
+    class ChunkedFieldStore {
+        public:
+            static const char* extension()
+            {
+                return ".cfs";
+            }
+
+            /**
+             * Read the last record of a file.
+             */
+            static void readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field);
+
+            /**
+             * Write a file of one record, lossless or rounded to the 23 bits
+             * of a float if float32.
+             */
+            static void writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+                double time = 0, bool float32 = false);
+    };
+}
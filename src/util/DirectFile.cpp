@@ -0,0 +1,150 @@
+#include "DirectFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace pifo {
+    namespace {
+        // the direct writes are multiples of the logical blocks of the
+        // device, at most 4096 bytes
+        const size_t blockSize = 4096;
+
+        AllocationPolicy blockAligned()
+        {
+            return AllocationPolicy(atlas::util::Config("alignment", (long)blockSize));
+        }
+    }
+
+    DirectFileWriter::DirectFileWriter(const std::string& pFile, size_t bufferBytes)
+        : file(pFile), temporary(pFile+".tmp"), fd(-1), direct(false),
+        buffer(std::max((bufferBytes+blockSize-1)/blockSize*blockSize, blockSize), blockAligned()),
+        used(0), written(0)
+    {
+#ifdef O_DIRECT
+        fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        direct = fd>=0;
+#endif
+        if (fd<0)
+        {
+            fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (fd<0)
+        {
+            throw std::runtime_error("could not create "+temporary);
+        }
+    }
+
+    DirectFileWriter::~DirectFileWriter()
+    {
+        if (fd>=0)
+        {
+            ::close(fd);
+            std::remove(temporary.c_str());
+        }
+    }
+
+    void DirectFileWriter::write(const void* data, size_t bytes)
+    {
+        auto from = (const char*)data;
+        while (bytes>0)
+        {
+            size_t n = std::min(bytes, buffer.size()-used);
+            std::memcpy((char*)buffer.data()+used, from, n);
+            used += n;
+            from += n;
+            bytes -= n;
+            if (used==buffer.size())
+            {
+                writeBuffer(used);
+                written += used;
+                used = 0;
+            }
+        }
+    }
+
+    void DirectFileWriter::writeBuffer(size_t bytes)
+    {
+        auto data = (const char*)buffer.data();
+        while (bytes>0)
+        {
+            ssize_t n = ::write(fd, data, bytes);
+#ifdef O_DIRECT
+            if (n<0 && errno==EINVAL && direct)
+            {
+                // the file system accepted O_DIRECT at the open only
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+                direct = false;
+                continue;
+            }
+#endif
+            if (n<0)
+            {
+                throw std::runtime_error("could not write "+temporary+" : "+std::strerror(errno));
+            }
+            data += n;
+            bytes -= n;
+        }
+    }
+
+    void DirectFileWriter::close()
+    {
+        size_t total = size();
+        if (used>0)
+        {
+            // a direct write of whole blocks, the padding is truncated
+            size_t padded = direct ? (used+blockSize-1)/blockSize*blockSize : used;
+            std::memset((char*)buffer.data()+used, 0, padded-used);
+            writeBuffer(padded);
+            written += used;
+            used = 0;
+        }
+        if (ftruncate(fd, total)!=0 || fsync(fd)!=0 || ::close(fd)!=0)
+        {
+            fd = -1;
+            std::remove(temporary.c_str());
+            throw std::runtime_error("could not write "+temporary+" : "+std::strerror(errno));
+        }
+        fd = -1;
+        if (std::rename(temporary.c_str(), file.c_str())!=0)
+        {
+            throw std::runtime_error("could not rename "+temporary+" to "+file);
+        }
+    }
+
+    SequentialFileReader::SequentialFileReader(const std::string& pFile)
+        : file(pFile), fd(open(pFile.c_str(), O_RDONLY))
+    {
+        if (fd<0)
+        {
+            throw std::runtime_error("could not open "+file);
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    SequentialFileReader::~SequentialFileReader()
+    {
+        ::close(fd);
+    }
+
+    void SequentialFileReader::read(void* data, size_t bytes)
+    {
+        auto to = (char*)data;
+        while (bytes>0)
+        {
+            ssize_t n = ::read(fd, to, bytes);
+            if (n<=0)
+            {
+                throw std::runtime_error(file+" is truncated");
+            }
+            to += n;
+            bytes -= n;
+        }
+    }
+}
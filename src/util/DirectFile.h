@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "AlignedBuffer.h"
+
+namespace pifo {
+    /**
+     * File written sequentially with direct I/O (O_DIRECT, Linux) : the
+     * data goes from an aligned buffer to the disk without a copy in the
+     * page cache, which large checkpoints would otherwise fill. Falls back
+     * to buffered writes where the file system refuses direct I/O (tmpfs).
+     *
+     * <p>The data is written to file.tmp, which close() syncs and renames
+     * to file : a run killed while writing leaves the previous file
+     * intact.</p>
+     */
+    class DirectFileWriter {
+    public:
+        explicit DirectFileWriter(const std::string& file, size_t bufferBytes = 8*1024*1024);
+
+        /**
+         * Removes the temporary file if close() was not called.
+         */
+        ~DirectFileWriter();
+
+        DirectFileWriter(const DirectFileWriter&) = delete;
+        DirectFileWriter& operator=(const DirectFileWriter&) = delete;
+
+        void write(const void* data, size_t bytes);
+
+        /**
+         * Write the rest of the buffer, sync and rename the file.
+         */
+        void close();
+
+        /**
+         * Bytes written so far.
+         */
+        size_t size() const
+        {
+            return written+used;
+        }
+
+        bool isDirect() const
+        {
+            return direct;
+        }
+
+    private:
+        void writeBuffer(size_t bytes);
+
+        std::string file;
+        std::string temporary;
+        int fd;
+        bool direct;
+        AlignedBuffer buffer;
+        // bytes in the buffer, and bytes of the file before them
+        size_t used;
+        size_t written;
+    };
+
+    /**
+     * File read sequentially in large blocks.
+     */
+    class SequentialFileReader {
+    public:
+        explicit SequentialFileReader(const std::string& file);
+        ~SequentialFileReader();
+
+        SequentialFileReader(const SequentialFileReader&) = delete;
+        SequentialFileReader& operator=(const SequentialFileReader&) = delete;
+
+        /**
+         * Read exactly bytes, throws at the end of the file.
+         */
+        void read(void* data, size_t bytes);
+
+    private:
+        std::string file;
+        int fd;
+    };
+}
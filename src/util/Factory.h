@@ -2,7 +2,9 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <functional>
+#include <stdexcept>
 
 // Ref : https://stackoverflow.com/questions/5120768/how-to-implement-the-factory-method-pattern-in-c-correctly
 
@@ -23,10 +25,25 @@ public:
      */
     auto create(const std::string& key, Params... args)
     {
-        std::unique_ptr<Base> obj{creators[key](args...)};
+        auto creator = creators.find(key);
+        if (creator == creators.end())
+        {
+            throw std::runtime_error("Factory : no type registered with name '"+key+"'");
+        }
+        std::unique_ptr<Base> obj{creator->second(args...)};
         return obj;
     }
 
+    /**
+     * Tells if a type is registered with the given key name.
+     * 
+     * @param key key name of the type of object.
+     */
+    bool has(const std::string& key) const
+    {
+        return creators.find(key) != creators.end();
+    }
+
     /**
      * Register a type, creates a default creator function, and associates it with key name.
      * 
@@ -37,7 +54,7 @@ public:
     void registerType(const std::string& name)
     {
         static_assert(std::is_base_of<Base, TDerived>::value, "Factory::registerType doesn't accept this type because it doesn't derive from base class");
-        creators[name] = std::bind(&createFunc<TDerived>);
+        creators[name] = &createFunc<TDerived>;
     }
 
     /**
@@ -0,0 +1,63 @@
+#include "FieldFiles.h"
+#include "BinaryFieldFormat.h"
+#include "ChunkedFieldStore.h"
+#include "WGribFormat.h"
+#include "eckit/filesystem/PathName.h"
+
+namespace pifo {
+    namespace {
+        bool hasExtension(const std::string& file, const std::string& extension)
+        {
+            return file.size()>=extension.size() && file.compare(file.size()-extension.size(), extension.size(), extension)==0;
+        }
+    }
+
+    std::string FieldFiles::find(const std::string& name)
+    {
+        std::string binary = name+BinaryFieldFormat::extension();
+        return eckit::PathName(binary).exists() ? binary : name+".txt";
+    }
+
+    bool FieldFiles::isBinary(const std::string& file)
+    {
+        return hasExtension(file, BinaryFieldFormat::extension());
+    }
+
+    bool FieldFiles::isChunked(const std::string& file)
+    {
+        return hasExtension(file, ChunkedFieldStore::extension());
+    }
+
+    void FieldFiles::readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field)
+    {
+        if (isBinary(file))
+        {
+            BinaryFieldFormat::readField(file, grid, field);
+        }
+        else if (isChunked(file))
+        {
+            ChunkedFieldStore::readField(file, grid, field);
+        }
+        else
+        {
+            WGribFormat::readField(file, grid, field);
+        }
+    }
+
+    void FieldFiles::writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+        double time, bool float32)
+    {
+        if (isBinary(file))
+        {
+            BinaryFieldFormat::writeField(file, grid, field, time, float32);
+        }
+        else if (isChunked(file))
+        {
+            ChunkedFieldStore::writeField(file, grid, field, time, float32);
+        }
+        else
+        {
+            WGribFormat::writeField(file, grid, field);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include "atlas/grid.h"
+#include "atlas/field.h"
+
+namespace pifo {
+    /**
+     * Files of the global fields, in the binary format of BinaryFieldFormat
+     * if their extension is .fld, in the compressed format of
+     * ChunkedFieldStore if it is .cfs (its last time is read), else in the
+     * text format of WGribFormat.
+     */
+    class FieldFiles {
+        public:
+            /**
+             * The file of a field : <name>.fld if it exists, else <name>.txt.
+             */
+            static std::string find(const std::string& name);
+
+            static bool isBinary(const std::string& file);
+
+            static bool isChunked(const std::string& file);
+
+            static void readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field);
+
+            /**
+             * Write a field, with the model time and optionally stored as
+             * float in the binary format, or rounded to the precision of a
+             * float in the chunked format (the text format ignores both).
+             */
+            static void writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field,
+                double time = 0, bool float32 = false);
+    };
+}
@@ -28,7 +28,6 @@ namespace pifo {
         double x_in2, y_in2;
 
         double v1, v2, v3, v4;
-        double vv1, vv2;
         double alpha_x, alpha_y;
 
         Regridding::optimizeGridIndices(x_in, in_width, x_out, size_out, cyclic, tab_i_in1, tab_i_in2, tab_x_adj1, tab_x_adj2);
@@ -55,10 +54,7 @@ namespace pifo {
             v3 = data_in[i_in2+in_width*j_in1];
             v4 = data_in[i_in2+in_width*j_in2];
 
-            vv1 = alpha_y*v2 + (1-alpha_y)*v1;
-            vv2 = alpha_y*v4 + (1-alpha_y)*v3;
-
-            data_out[i] = alpha_x*vv2 + (1-alpha_x)*vv1 ;
+            data_out[i] = bilinear(v1, v2, v3, v4, alpha_x, alpha_y);
         }
 
         delete tab_i_in1;
@@ -48,6 +48,21 @@ namespace pifo {
          * x_out, y_out fournies.
          * @returns {undefined}
          */
+        /**
+         * Interpolation bilinéaire entre les 4 valeurs v1 (x1, y1), 
+         * v2 (x1, y2), v3 (x2, y1) et v4 (x2, y2), alpha_x et alpha_y étant
+         * les positions relatives du point dans la maille, entre 0 et 1.
+         * 
+         * <p>C'est le calcul fait pour chaque point par bilinearRegrid, 
+         * utilisable directement quand la maille est déjà connue.</p>
+         */
+        static inline double bilinear(double v1, double v2, double v3, double v4, double alpha_x, double alpha_y)
+        {
+            double vv1 = alpha_y*v2 + (1-alpha_y)*v1;
+            double vv2 = alpha_y*v4 + (1-alpha_y)*v3;
+            return alpha_x*vv2 + (1-alpha_x)*vv1;
+        }
+
         static void bilinearRegrid(double* x_in, long in_width, 
                             double* y_in, long in_height,
                             double* data_in, long size_in, 
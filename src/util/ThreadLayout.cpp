@@ -0,0 +1,289 @@
+#include "ThreadLayout.h"
+#include "atlas/parallel/omp/omp.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace pifo {
+    namespace {
+        struct Cpu {
+            int id;
+            int socket;
+            int core;
+        };
+
+        int readTopology(int cpu, const std::string& name)
+        {
+            std::ifstream in("/sys/devices/system/cpu/cpu"+std::to_string(cpu)+"/topology/"+name);
+            int value = 0;
+            in >> value;
+            return value;
+        }
+
+        // cpus the process may run on, one hardware thread of each core first
+        std::vector<Cpu> availableCpus()
+        {
+            std::vector<Cpu> result;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set)==0)
+            {
+                for (int c=0;c<CPU_SETSIZE;c++)
+                {
+                    if (CPU_ISSET(c, &set))
+                    {
+                        result.push_back({ c, readTopology(c, "physical_package_id"), readTopology(c, "core_id") });
+                    }
+                }
+            }
+#endif
+            std::set<std::pair<int, int>> cores;
+            std::vector<int> rank(result.size());
+            for (size_t i=0;i<result.size();i++)
+            {
+                rank[i] = cores.insert(std::make_pair(result[i].socket, result[i].core)).second ? 0 : 1;
+            }
+            std::vector<size_t> order(result.size());
+            for (size_t i=0;i<order.size();i++)
+            {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return std::make_tuple(rank[a], result[a].socket, result[a].core)
+                    < std::make_tuple(rank[b], result[b].socket, result[b].core);
+            });
+            std::vector<Cpu> sorted;
+            for (auto i : order)
+            {
+                sorted.push_back(result[i]);
+            }
+            return sorted;
+        }
+
+        // the available cpus not in used, or all of them if none is left
+        std::vector<int> spareCpusOf(const std::vector<Cpu>& available, const std::vector<int>& used)
+        {
+            std::vector<int> all;
+            std::vector<int> spare;
+            for (auto& c : available)
+            {
+                all.push_back(c.id);
+                if (std::find(used.begin(), used.end(), c.id)==used.end())
+                {
+                    spare.push_back(c.id);
+                }
+            }
+            std::sort(all.begin(), all.end());
+            std::sort(spare.begin(), spare.end());
+            return spare.empty() ? all : spare;
+        }
+    }
+
+    ThreadLayout::ThreadLayout(const atlas::util::Config& config)
+    {
+        threads = config.getInt("threads", std::max(atlas_omp_get_max_threads()/2, 1));
+        if (threads<1)
+        {
+            throw std::runtime_error("threads must be positive");
+        }
+        layout = config.getString("thread_layout", "none");
+        std::string cpuList = config.getString("cpus", "");
+        if (!cpuList.empty())
+        {
+            layout = "cpus";
+        }
+        if (layout=="none")
+        {
+            return;
+        }
+
+        std::vector<Cpu> available = availableCpus();
+        if (available.empty())
+        {
+            throw std::runtime_error("thread_layout "+layout+" needs the cpu topology of Linux");
+        }
+        if (layout=="cpus")
+        {
+            std::vector<int> list = parseCpuList(cpuList);
+            for (int t=0;t<threads;t++)
+            {
+                int cpu = list[t%list.size()];
+                auto it = std::find_if(available.begin(), available.end(), [&](const Cpu& c) { return c.id==cpu; });
+                if (it==available.end())
+                {
+                    throw std::runtime_error("cpu "+std::to_string(cpu)+" is not available to the process");
+                }
+                cpus.push_back(cpu);
+                sockets.push_back(it->socket);
+            }
+            spareCpus = spareCpusOf(available, cpus);
+            return;
+        }
+        if (layout!="compact" && layout!="scatter")
+        {
+            throw std::runtime_error("unknown thread_layout '"+layout+"'");
+        }
+
+        // the cpus of each socket used, in the order of availableCpus()
+        std::vector<int> socketIds;
+        for (auto& c : available)
+        {
+            if (std::find(socketIds.begin(), socketIds.end(), c.socket)==socketIds.end())
+            {
+                socketIds.push_back(c.socket);
+            }
+        }
+        std::sort(socketIds.begin(), socketIds.end());
+        int used = std::min(config.getInt("sockets", (int)socketIds.size()), (int)socketIds.size());
+        if (used<1)
+        {
+            throw std::runtime_error("sockets must be positive");
+        }
+        std::vector<std::vector<Cpu>> perSocket(used);
+        for (auto& c : available)
+        {
+            auto s = std::find(socketIds.begin(), socketIds.begin()+used, c.socket)-socketIds.begin();
+            if (s<used)
+            {
+                perSocket[s].push_back(c);
+            }
+        }
+
+        std::vector<Cpu> order;
+        if (layout=="compact")
+        {
+            // the cores before their hardware threads, in each socket
+            for (auto& socket : perSocket)
+            {
+                order.insert(order.end(), socket.begin(), socket.end());
+            }
+        }
+        else
+        {
+            for (size_t i=0;order.size()<available.size();i++)
+            {
+                bool any = false;
+                for (auto& socket : perSocket)
+                {
+                    if (i<socket.size())
+                    {
+                        order.push_back(socket[i]);
+                        any = true;
+                    }
+                }
+                if (!any)
+                {
+                    break;
+                }
+            }
+        }
+        for (int t=0;t<threads;t++)
+        {
+            // more threads than cpus share them
+            const Cpu& c = order[t%order.size()];
+            cpus.push_back(c.id);
+            sockets.push_back(c.socket);
+        }
+        spareCpus = spareCpusOf(available, cpus);
+    }
+
+    void ThreadLayout::apply() const
+    {
+        atlas_omp_set_num_threads(threads);
+        if (cpus.empty())
+        {
+            return;
+        }
+#ifdef __linux__
+        int failures = 0;
+        #pragma omp parallel reduction(+:failures)
+        {
+            if (!pinThread({ cpus[atlas_omp_get_thread_num()%cpus.size()] }))
+            {
+                failures++;
+            }
+        }
+        if (failures>0)
+        {
+            throw std::runtime_error("could not pin "+std::to_string(failures)+" threads");
+        }
+#endif
+    }
+
+    std::string ThreadLayout::describe() const
+    {
+        std::ostringstream out;
+        out << threads << " threads, layout " << layout;
+        if (!cpus.empty())
+        {
+            std::set<int> used(sockets.begin(), sockets.end());
+            out << " on " << used.size() << " sockets, cpus";
+            for (size_t t=0;t<cpus.size();t++)
+            {
+                out << (t==0 ? " " : ",") << cpus[t];
+            }
+            out << ", writer cpus";
+            for (size_t c=0;c<spareCpus.size();c++)
+            {
+                out << (c==0 ? " " : ",") << spareCpus[c];
+            }
+        }
+        return out.str();
+    }
+
+    bool ThreadLayout::pinThread(const std::vector<int>& cpus)
+    {
+#ifdef __linux__
+        if (cpus.empty())
+        {
+            return true;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set)==0;
+#else
+        return true;
+#endif
+    }
+
+    std::vector<int> ThreadLayout::parseCpuList(const std::string& list)
+    {
+        std::vector<int> result;
+        std::istringstream in(list);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            auto dash = item.find('-');
+            try
+            {
+                int first = std::stoi(item.substr(0, dash));
+                int last = dash==std::string::npos ? first : std::stoi(item.substr(dash+1));
+                for (int c=first;c<=last;c++)
+                {
+                    result.push_back(c);
+                }
+            }
+            catch (const std::logic_error&)
+            {
+                throw std::runtime_error("invalid cpu list '"+list+"'");
+            }
+        }
+        if (result.empty())
+        {
+            throw std::runtime_error("invalid cpu list '"+list+"'");
+        }
+        return result;
+    }
+}
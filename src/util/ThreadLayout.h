@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "atlas/util/Config.h"
+
+namespace pifo {
+    /**
+     * Number of OpenMP threads and their placement on the cores of the node.
+     *
+     * <p>Configuration keys :</p>
+     * <ul>
+     * <li>threads : number of threads (default half of the maximum, one
+     * per core with two hardware threads per core).</li>
+     * <li>thread_layout : none (default) leaves the placement to the
+     * OpenMP runtime (OMP_PLACES, OMP_PROC_BIND). compact pins the threads
+     * to the cores of the first socket, then of the next ones. scatter
+     * pins them in turn on each socket, so that a few threads already use
+     * the memory bandwidth of all the sockets.</li>
+     * <li>sockets : number of sockets used by the compact and scatter
+     * layouts (default all).</li>
+     * <li>cpus : explicit list of cpus, as "0-7,16-23", the thread i being
+     * pinned to the i-th one. Overrides thread_layout.</li>
+     * </ul>
+     *
+     * <p>The cores are taken from the cpus the process may run on, one
+     * hardware thread of each core before their siblings. The topology is
+     * read from /sys, the pinning is only done on Linux. Threads are pinned
+     * once by apply() : the OpenMP runtime keeps the same threads from a
+     * parallel region to the next, as long as their number doesn't change.</p>
+     *
+     * <p>With a pinned layout, the fields should be first written by the
+     * threads that compute them, as ModelT does, so that their pages are
+     * allocated on the socket of these threads.</p>
+     *
+     * <p>apply() also pins the calling thread, and the threads it creates
+     * afterwards inherit its single cpu. The threads that run beside the
+     * OpenMP team (the output writer) are pinned with pinThread() to 
+     * getSpareCpus() instead, the cpus of the process taken before the 
+     * pinning.</p>
+     */
+    class ThreadLayout {
+    public:
+        ThreadLayout(const atlas::util::Config& config = atlas::util::Config());
+
+        /**
+         * Set the number of threads and pin them.
+         */
+        void apply() const;
+
+        int getThreads() const
+        {
+            return threads;
+        }
+
+        /**
+         * Cpu of each thread, empty if the threads are not pinned.
+         */
+        const std::vector<int>& getCpus() const
+        {
+            return cpus;
+        }
+
+        /**
+         * Socket of each thread, empty if the threads are not pinned.
+         */
+        const std::vector<int>& getSockets() const
+        {
+            return sockets;
+        }
+
+        /**
+         * Cpus of the process that the threads are not pinned to, or all 
+         * the cpus of the process if the threads use them all. Empty if 
+         * the threads are not pinned.
+         */
+        const std::vector<int>& getSpareCpus() const
+        {
+            return spareCpus;
+        }
+
+        /**
+         * Description of the layout for the log.
+         */
+        std::string describe() const;
+
+        /**
+         * Parse a list of cpus as "0-3,8,10-11".
+         */
+        static std::vector<int> parseCpuList(const std::string& list);
+
+        /**
+         * Pin the calling thread to a set of cpus, false if it failed. 
+         * Nothing is done for an empty set, nor out of Linux.
+         */
+        static bool pinThread(const std::vector<int>& cpus);
+
+    private:
+        int threads;
+        std::string layout;
+        std::vector<int> cpus;
+        std::vector<int> sockets;
+        std::vector<int> spareCpus;
+    };
+}
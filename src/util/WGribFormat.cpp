@@ -1,73 +1,241 @@
 #include "WGribFormat.h"
 #include "atlas/array/ArrayShape.h"
 #include "atlas/array/ArrayView.h"
+#include "atlas/parallel/omp/omp.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
-#include <fstream>
+#include <vector>
+
+#if __cplusplus>=201703L
+#include <charconv>
+#endif
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace pifo {
+    namespace {
+        // values formatted by a thread before the buffer is written
+        const atlas::idx_t blockValues = 1<<16;
+        // longest value with 6 significant digits (-1.23457e-308), the
+        // newline and the terminating 0 of snprintf
+        const size_t maxValueChars = 16;
+
+        bool isSpace(char c)
+        {
+            return c==' ' || c=='\n' || c=='\r' || c=='\t';
+        }
+
+        // The streams print a double as "%g", 6 significant digits : the
+        // general format of to_chars with a precision of 6 gives the same
+        // characters. from_chars and strtod are both correctly rounded, as
+        // the streams. Without the floating-point charconv of C++17
+        // (libstdc++ before GCC 11, libc++), snprintf and strtod.
+        char* formatValue(char* out, double value)
+        {
+#if defined(__cpp_lib_to_chars)
+            out = std::to_chars(out, out+maxValueChars, value, std::chars_format::general, 6).ptr;
+#else
+            out += std::snprintf(out, maxValueChars, "%g", value);
+#endif
+            *out++ = '\n';
+            return out;
+        }
+
+        // end of the number at p, nullptr if it is not one. The text ends
+        // with a 0 (strtod).
+        const char* parseValue(const char* p, const char* end, double& value)
+        {
+            // the streams accept a plus sign, from_chars does not. strtod
+            // would also take a second sign or the spaces after it.
+            if (p<end && *p=='+')
+            {
+                p++;
+                if (p==end || *p=='+' || *p=='-' || isSpace(*p))
+                {
+                    return nullptr;
+                }
+            }
+#if defined(__cpp_lib_to_chars)
+            auto result = std::from_chars(p, end, value);
+            const char* stop = result.ec==std::errc() ? result.ptr : nullptr;
+#else
+            char* stop = nullptr;
+            value = std::strtod(p, &stop);
+            if (stop==p) stop = nullptr;
+#endif
+            return stop!=nullptr && (stop==end || isSpace(*stop)) ? stop : nullptr;
+        }
+
+        std::vector<char> readText(const std::string& file)
+        {
+            int fd = open(file.c_str(), O_RDONLY);
+            struct stat status;
+            if (fd<0 || fstat(fd, &status)!=0)
+            {
+                if (fd>=0) close(fd);
+                throw std::runtime_error("could not open "+file);
+            }
+            std::vector<char> text(status.st_size+1, 0);
+            size_t done = 0;
+            while (done<(size_t)status.st_size)
+            {
+                ssize_t n = read(fd, text.data()+done, status.st_size-done);
+                if (n<=0) break;
+                done += n;
+            }
+            close(fd);
+            if (done<(size_t)status.st_size)
+            {
+                throw std::runtime_error("could not read "+file);
+            }
+            return text;
+        }
+
+        void writeAll(int fd, const char* data, size_t bytes, const std::string& file)
+        {
+            while (bytes>0)
+            {
+                ssize_t n = write(fd, data, bytes);
+                if (n<0)
+                {
+                    close(fd);
+                    throw std::runtime_error("could not write "+file);
+                }
+                data += n;
+                bytes -= n;
+            }
+        }
+
+        /**
+         * Write "nx ny" and the nx*ny values value(k), one per line. Each
+         * thread formats a block of values into its buffer, and the buffers
+         * are written in order, one write each.
+         */
+        template <typename Value>
+        void writeValues(const std::string& file, const atlas::RegularGrid& grid, const Value& value)
+        {
+            int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd<0)
+            {
+                throw std::runtime_error("could not create "+file);
+            }
+            std::string header = std::to_string(grid.nx())+" "+std::to_string(grid.ny())+"\n";
+            writeAll(fd, header.data(), header.size(), file);
+
+            atlas::idx_t size = grid.nx()*grid.ny();
+            int threads = atlas_omp_get_max_threads();
+            std::vector<std::vector<char>> buffers(threads, std::vector<char>(blockValues*maxValueChars));
+            std::vector<size_t> lengths(threads);
+            for (atlas::idx_t batch=0;batch<size;batch+=threads*blockValues)
+            {
+                #pragma omp parallel for schedule(static, 1)
+                for (int b=0;b<threads;b++)
+                {
+                    atlas::idx_t begin = std::min(batch+b*blockValues, size);
+                    atlas::idx_t end = std::min(begin+blockValues, size);
+                    char* out = buffers[b].data();
+                    for (atlas::idx_t k=begin;k<end;k++)
+                    {
+                        out = formatValue(out, value(k));
+                    }
+                    lengths[b] = out-buffers[b].data();
+                }
+                for (int b=0;b<threads;b++)
+                {
+                    writeAll(fd, buffers[b].data(), lengths[b], file);
+                }
+            }
+            if (close(fd)!=0)
+            {
+                throw std::runtime_error("could not write "+file);
+            }
+        }
+    }
 
     void WGribFormat::readField(const std::string& file, const atlas::RegularGrid& grid, atlas::Field& field)
     {
         auto field_view = atlas::array::make_view<double, 1>(field);
-        std::ifstream infile;
-        atlas::idx_t nx, ny;
-        double val;
-        atlas::idx_t k=0;
-        infile.open(file);
-        infile >> nx;
-        infile >> ny;
+        std::vector<char> text = readText(file);
+        char* p = text.data();
+        const char* end = text.data()+text.size()-1;
+        atlas::idx_t nx = std::strtol(p, &p, 10);
+        atlas::idx_t ny = std::strtol(p, &p, 10);
         if (nx!=grid.nx() || ny!=grid.ny()) throw std::runtime_error("file has not the same dimension as the grid to load. "+std::to_string(nx)+" "+std::to_string(ny));
-        for (atlas::idx_t j=0;j<grid.ny();j++)
+        atlas::idx_t size = grid.nx()*grid.ny();
+
+        // chunks of the text cut after a number, one per thread : the
+        // numbers of each chunk are counted, then parsed into the field
+        // from the index of their first one
+        int chunks = atlas_omp_get_max_threads();
+        std::vector<const char*> bounds(chunks+1, end);
+        bounds[0] = p;
+        for (int c=1;c<chunks;c++)
+        {
+            const char* b = std::max<const char*>(bounds[c-1], p+(end-p)/chunks*c);
+            while (b<end && !isSpace(*b)) b++;
+            bounds[c] = b;
+        }
+        std::vector<atlas::idx_t> first(chunks+1, 0);
+        std::vector<atlas::idx_t> errors(chunks, -1);
+        #pragma omp parallel for schedule(static, 1)
+        for (int c=0;c<chunks;c++)
+        {
+            atlas::idx_t count = 0;
+            for (const char* q=bounds[c];q<bounds[c+1];q++)
+            {
+                if (!isSpace(*q) && (q==bounds[c] || isSpace(q[-1]))) count++;
+            }
+            first[c+1] = count;
+        }
+        for (int c=0;c<chunks;c++)
         {
-            for (atlas::idx_t i=0;i<grid.nx();i++)
+            first[c+1] += first[c];
+        }
+        #pragma omp parallel for schedule(static, 1)
+        for (int c=0;c<chunks;c++)
+        {
+            atlas::idx_t k = first[c];
+            const char* q = bounds[c];
+            while (k<size)
             {
-                if (!infile.eof())
+                while (q<bounds[c+1] && isSpace(*q)) q++;
+                if (q==bounds[c+1]) break;
+                double val;
+                q = parseValue(q, bounds[c+1], val);
+                if (q==nullptr)
                 {
-                    infile >> val;
-                    field_view(k) = val;
+                    errors[c] = k;
+                    break;
                 }
+                field_view(k) = val;
                 k++;
             }
         }
-        infile.close();        
+        // as the streams, the values missing at the end of the file are
+        // left unchanged
+        for (int c=0;c<chunks;c++)
+        {
+            if (errors[c]>=0)
+            {
+                throw std::runtime_error("value "+std::to_string(errors[c])+" of "+file+" is not a number");
+            }
+        }
     }
 
     void WGribFormat::writeField(const std::string& file, const atlas::RegularGrid& grid, const atlas::Field& field)
     {
         auto field_view = atlas::array::make_view<double, 1>(field);
-        std::ofstream outfile;
-        atlas::idx_t k=0;
-        outfile.open(file, std::ofstream::trunc);
-        outfile << grid.nx() << " " << grid.ny() << std::endl;
-        for (atlas::idx_t j=0;j<grid.ny();j++)
-        {
-            for (atlas::idx_t i=0;i<grid.nx();i++)
-            {
-                outfile << field_view(k) << std::endl;
-                k++;
-            }
-        }
-        outfile.close();        
+        writeValues(file, grid, [&](atlas::idx_t k) { return field_view(k); });
     }
 
     void WGribFormat::writeLonLat(const std::string& lonfile, const std::string& latfile, const atlas::RegularGrid& grid)
     {
-        std::ofstream outlonfile;
-        std::ofstream outlatfile;
-        outlonfile.open(lonfile, std::ofstream::trunc);
-        outlatfile.open(latfile, std::ofstream::trunc);
-        outlonfile << grid.nx() << " " << grid.ny() << std::endl;
-        outlatfile << grid.nx() << " " << grid.ny() << std::endl;
-        for (atlas::idx_t j=0;j<grid.ny();j++)
-        {
-            for (atlas::idx_t i=0;i<grid.nx();i++)
-            {
-                atlas::PointLonLat lonlat = grid.lonlat(i, j);
-                outlonfile << lonlat.lon() << std::endl;
-                outlatfile << lonlat.lat() << std::endl;
-            }
-        }
-        outlonfile.close();
-        outlatfile.close();
+        atlas::idx_t nx = grid.nx();
+        writeValues(lonfile, grid, [&](atlas::idx_t k) { return grid.lonlat(k%nx, k/nx).lon(); });
+        writeValues(latfile, grid, [&](atlas::idx_t k) { return grid.lonlat(k%nx, k/nx).lat(); });
     }
 }
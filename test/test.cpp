@@ -1,8 +1,866 @@
-#define BOOST_TEST_DYN_LINK  
+#define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE PifoTestcases
 
 #include <boost/test/unit_test.hpp>
 
-BOOST_AUTO_TEST_CASE(PifoTest) {
-  BOOST_CHECK_EQUAL(1., 1.);
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atlas/library/Library.h"
+#include "atlas/grid.h"
+#include "atlas/field.h"
+#include "atlas/array/ArrayView.h"
+#include "atlas/parallel/omp/omp.h"
+#include "atlas/util/Config.h"
+#include "app/AsyncOutputWriter.h"
+#include "app/DistributedFields.h"
+#include "model/Model.h"
+#include "util/BinaryFieldFormat.h"
+#include "util/ChunkedFieldStore.h"
+#include "util/WGribFormat.h"
+
+// width of the grid of the tests, also built as a fixed row length of the
+// agrid kernels (see CMakeLists.txt)
+#ifndef PIFO_TEST_NX
+#define PIFO_TEST_NX 48
+#endif
+
+using namespace pifo;
+
+namespace {
+    struct AtlasLibrary {
+        AtlasLibrary()
+        {
+            auto& suite = boost::unit_test::framework::master_test_suite();
+            atlas::Library::instance().initialise(suite.argc, suite.argv);
+        }
+
+        ~AtlasLibrary()
+        {
+            atlas::Library::instance().finalise();
+        }
+    };
+
+    atlas::RegularGrid testGrid(atlas::idx_t nx, atlas::idx_t ny, double lonCentre = 5.)
+    {
+        atlas::util::Config config;
+        config.set("type", "regional");
+        config.set("nx", nx);
+        config.set("ny", ny);
+        config.set("dx", 20000.);
+        config.set("dy", 20000.);
+        config.set("lonlat(centre)", std::vector<double>{ lonCentre, 45. });
+        config.set("projection", atlas::util::Config("type", "mercator"));
+        return atlas::RegularGrid(config);
+    }
+
+    /**
+     * Smooth initial state on the owned rows of the model, m and f depending
+     * on the latitude only (held per row by the method) unless pointMetrics.
+     * amplitude scales the waves of U, V and phi.
+     */
+    template <typename Model>
+    void initialState(Model& model, bool pointMetrics = false, double amplitude = 1)
+    {
+        auto& fs = model.getFunctionSpace();
+        auto U = atlas::array::make_view<double, 1>(model.pronosticFieldSet().field("U"));
+        auto V = atlas::array::make_view<double, 1>(model.pronosticFieldSet().field("V"));
+        auto phi = atlas::array::make_view<double, 1>(model.pronosticFieldSet().field("phi"));
+        auto m = atlas::array::make_view<double, 1>(model.parameterFieldSet().field("m"));
+        auto f = atlas::array::make_view<double, 1>(model.parameterFieldSet().field("f"));
+        for (atlas::idx_t j=fs.j_begin();j<fs.j_end();j++)
+        {
+            for (atlas::idx_t i=fs.i_begin(j);i<fs.i_end(j);i++)
+            {
+                atlas::idx_t k = fs.index(i, j);
+                double lat = (30+0.2*j)*M_PI/180;
+                m(k) = 1/std::cos(lat)*(pointMetrics ? 1+1e-3*std::sin(0.3*i) : 1);
+                f(k) = 2*7.292115e-5*std::sin(lat);
+                U(k) = amplitude*10*std::sin(0.1*i)*std::cos(0.13*j)/m(k);
+                V(k) = amplitude*8*std::cos(0.07*i+1)*std::sin(0.11*j)/m(k);
+                phi(k) = 15000+amplitude*300*std::sin(0.05*i)*std::cos(0.06*j);
+            }
+        }
+        fs.haloExchange(model.parameterFieldSet());
+    }
+
+    /**
+     * U, V and phi of the owned points, in this order, of the given member
+     * of an ensemble.
+     */
+    template <typename Model>
+    std::vector<double> modelState(Model& model, int member = 0)
+    {
+        auto& fs = model.getFunctionSpace();
+        std::vector<double> state;
+        for (const char* name : { "U", "V", "phi" })
+        {
+            atlas::Field& field = model.pronosticFieldSet().field(name);
+            for (atlas::idx_t j=fs.j_begin();j<fs.j_end();j++)
+            {
+                for (atlas::idx_t i=fs.i_begin(j);i<fs.i_end(j);i++)
+                {
+                    state.push_back(model.getMembers()>1
+                        ? atlas::array::make_view<double, 2>(field)(fs.index(i, j), member)
+                        : atlas::array::make_view<double, 1>(field)(fs.index(i, j)));
+                }
+            }
+        }
+        return state;
+    }
+
+    /**
+     * Copy the state of a single model into a member of an ensemble of the
+     * same grid, m and f included.
+     */
+    template <typename Model>
+    void copyMember(Model& single, Model& ensemble, int member)
+    {
+        auto& fs = single.getFunctionSpace();
+        for (const char* name : { "U", "V", "phi" })
+        {
+            auto from = atlas::array::make_view<double, 1>(single.pronosticFieldSet().field(name));
+            auto to = atlas::array::make_view<double, 2>(ensemble.pronosticFieldSet().field(name));
+            for (atlas::idx_t j=fs.j_begin();j<fs.j_end();j++)
+            {
+                for (atlas::idx_t i=fs.i_begin(j);i<fs.i_end(j);i++)
+                {
+                    to(fs.index(i, j), member) = from(fs.index(i, j));
+                }
+            }
+        }
+        for (const char* name : { "m", "f" })
+        {
+            auto from = atlas::array::make_view<double, 1>(single.parameterFieldSet().field(name));
+            auto to = atlas::array::make_view<double, 1>(ensemble.parameterFieldSet().field(name));
+            for (atlas::idx_t k=0;k<fs.size();k++)
+            {
+                to(k) = from(k);
+            }
+        }
+    }
+
+    /**
+     * Number of values that differ, NaNs being equal to each other.
+     */
+    size_t differences(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        if (a.size()!=b.size())
+        {
+            return std::max(a.size(), b.size());
+        }
+        size_t count = 0;
+        for (size_t k=0;k<a.size();k++)
+        {
+            if (a[k]!=b[k] && !(std::isnan(a[k]) && std::isnan(b[k])))
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Bytes of a file, and a file of these bytes.
+     */
+    std::vector<char> readBytes(const std::string& file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeBytes(const std::string& file, const std::vector<char>& bytes)
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    /**
+     * State after the given number of steps of a model of the configuration.
+     */
+    std::vector<double> forecast(const atlas::RegularGrid& grid, const atlas::util::Config& config, int steps,
+        bool pointMetrics = false)
+    {
+        Model model(grid, config);
+        initialState(model, pointMetrics);
+        model.advanceUntil(steps*model.getDt(), [](double) {});
+        BOOST_REQUIRE_EQUAL(model.getSteps(), steps);
+        return modelState(model);
+    }
+}
+
+BOOST_GLOBAL_FIXTURE(AtlasLibrary);
+
+// The variants of the dynamics and the execution modes compute the same
+// operations in the same order as the reference agrid kernels
+BOOST_AUTO_TEST_CASE(DynamicsBitIdenticalToAGrid) {
+    typedef atlas::util::Config Config;
+    std::vector<std::pair<std::string, Config>> variants = {
+        { "agrid_fused", Config("dynamics", "agrid_fused") },
+        { "agrid_expression", Config("dynamics", "agrid_expression") },
+        { "raw array access", Config("array_access", "raw") },
+        { "overlapped halo exchange", Config("halo_exchange", "overlap") },
+        { "task graph", Config("task_graph", true) },
+        { "agrid_fused task graph", Config("dynamics", "agrid_fused") | Config("task_graph", true) },
+        { "persistent region", Config("dynamics", "agrid_fused") | Config("persistent_region", true) },
+        { "temporal blocking", Config("dynamics", "agrid_fused") | Config("temporal_blocking", 4) },
+        { "interleaved layout", Config("layout", "interleaved") },
+        { "agrid_interleaved", Config("dynamics", "agrid_interleaved") | Config("layout", "interleaved") },
+        { "agrid_ensemble", Config("dynamics", "agrid_ensemble") | Config("members", 1) },
+    };
+    for (const simd::StencilKernels* kernels : simd::availableKernels())
+    {
+        variants.push_back({ std::string("agrid_simd ")+kernels->name,
+            Config("dynamics", "agrid_simd") | Config("simd", std::string(kernels->name)) });
+    }
+
+    const int steps = 12;
+    // a width with fixed-size agrid kernels and one without
+    for (atlas::idx_t nx : { PIFO_TEST_NX, PIFO_TEST_NX-1 })
+    {
+        atlas::RegularGrid grid = testGrid(nx, 40);
+        for (bool pointMetrics : { false, true })
+        {
+            std::vector<double> reference = forecast(grid, Config("dynamics", "agrid"), steps, pointMetrics);
+            for (auto& variant : variants)
+            {
+                size_t count = differences(forecast(grid, variant.second, steps, pointMetrics), reference);
+                BOOST_CHECK_MESSAGE(count==0, variant.first << " (nx=" << nx << ", point metrics=" << pointMetrics
+                    << ") differs from agrid at " << count << " values");
+            }
+        }
+    }
+}
+
+// With adaptive_dt, the Courant rate reduced along K by the agrid kernels
+// and the fused sweep is the one of the separate sweep of the model (the
+// dynamics that don't reduce it, as agrid_ensemble)
+BOOST_AUTO_TEST_CASE(AdaptiveDtCourantRate) {
+    typedef atlas::util::Config Config;
+    std::vector<std::pair<std::string, Config>> variants = {
+        { "agrid", Config("dynamics", "agrid") },
+        { "raw array access", Config("array_access", "raw") },
+        { "agrid_fused", Config("dynamics", "agrid_fused") },
+        { "agrid_fused overlapped halo exchange", Config("dynamics", "agrid_fused") | Config("halo_exchange", "overlap") },
+    };
+    const int steps = 12;
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    for (bool pointMetrics : { false, true })
+    {
+        Model reference(grid, Config("dynamics", "agrid_ensemble") | Config("adaptive_dt", true));
+        initialState(reference, pointMetrics);
+        reference.advance(steps);
+        BOOST_REQUIRE(reference.getDtChanges()>0);
+        for (auto& variant : variants)
+        {
+            Model model(grid, variant.second | Config("adaptive_dt", true));
+            initialState(model, pointMetrics);
+            model.advance(steps);
+            BOOST_CHECK_EQUAL(model.getDtChanges(), reference.getDtChanges());
+            BOOST_CHECK_EQUAL(model.getDt(), reference.getDt());
+            BOOST_CHECK_EQUAL(model.getCourant(), reference.getCourant());
+            size_t count = differences(modelState(model), modelState(reference));
+            BOOST_CHECK_MESSAGE(count==0, variant.first << " (point metrics=" << pointMetrics
+                << ") differs from the separate Courant sweep at " << count << " values");
+        }
+    }
+}
+
+// Each member of an agrid_ensemble run, identical or not, ends bit for bit
+// as the single agrid run of its initial state
+BOOST_AUTO_TEST_CASE(EnsembleMembersMatchSingleRuns) {
+    typedef atlas::util::Config Config;
+    const int steps = 12;
+    const int members = 3;
+    for (atlas::idx_t nx : { PIFO_TEST_NX, PIFO_TEST_NX-1 })
+    {
+        atlas::RegularGrid grid = testGrid(nx, 40);
+        for (auto amplitudes : { std::vector<double>{ 1, 1, 1 }, std::vector<double>{ 1, 0.5, -0.8 } })
+        {
+            Model ensemble(grid, Config("members", members));
+            BOOST_REQUIRE_EQUAL(ensemble.getMembers(), members);
+            std::vector<std::vector<double>> singles;
+            for (int k=0;k<members;k++)
+            {
+                Model single(grid, Config("dynamics", "agrid"));
+                initialState(single, true, amplitudes[k]);
+                copyMember(single, ensemble, k);
+                single.advanceUntil(steps*single.getDt(), [](double) {});
+                singles.push_back(modelState(single));
+            }
+            ensemble.advanceUntil(steps*ensemble.getDt(), [](double) {});
+            for (int k=0;k<members;k++)
+            {
+                size_t count = differences(modelState(ensemble, k), singles[k]);
+                BOOST_CHECK_MESSAGE(count==0, "member " << k << " of " << members << " (nx=" << nx << ", amplitude "
+                    << amplitudes[k] << ") differs from its single run at " << count << " values");
+            }
+        }
+    }
+}
+
+// A run restarted from a checkpoint continues bit for bit as the run that
+// wrote it, with the state of the leapfrog and of the time scheme. The
+// checkpoint is written between the steps as ModelRun does, after a block
+// of steps with temporal blocking.
+BOOST_AUTO_TEST_CASE(CheckpointRestartBitIdentical) {
+    typedef atlas::util::Config Config;
+    std::vector<std::pair<std::string, Config>> configs = {
+        { "agrid", Config("dynamics", "agrid") },
+        { "interleaved layout", Config("layout", "interleaved") },
+        { "semi_implicit", Config("time_scheme", "semi_implicit") | Config("dt", 60.) },
+        // a forward step and a block of 4 steps before the checkpoint
+        { "temporal blocking", Config("dynamics", "agrid_fused") | Config("temporal_blocking", 4) },
+    };
+    const std::string file = "test_checkpoint.ckp";
+    const int before = 5;
+    const int after = 7;
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    for (auto& config : configs)
+    {
+        std::vector<double> reference = forecast(grid, config.second, before+after, true);
+
+        Model first(grid, config.second);
+        initialState(first, true);
+        std::vector<double> checkpointState;
+        first.advanceUntil((before+after)*first.getDt(), [&](double time)
+        {
+            if (checkpointState.empty() && time>=before*first.getDt())
+            {
+                BOOST_REQUIRE(first.writeCheckpoint(file)>0);
+                checkpointState = modelState(first);
+            }
+        });
+        BOOST_CHECK(differences(modelState(first), reference)==0);
+
+        Model restarted(grid, config.second);
+        restarted.readCheckpoint(file);
+        BOOST_CHECK_EQUAL(restarted.getSteps(), before);
+        BOOST_CHECK_EQUAL(restarted.getTime(), before*restarted.getDt());
+        BOOST_CHECK(differences(modelState(restarted), checkpointState)==0);
+        restarted.advanceUntil((before+after)*restarted.getDt(), [](double) {});
+        BOOST_CHECK_EQUAL(restarted.getSteps(), before+after);
+        size_t count = differences(modelState(restarted), reference);
+        BOOST_CHECK_MESSAGE(count==0, config.first << " restarted after " << before << " steps differs at "
+            << count << " values");
+    }
+    std::remove(file.c_str());
+}
+
+// readCheckpoint rejects the files that are not a whole checkpoint of a
+// model of the same precision and partition
+BOOST_AUTO_TEST_CASE(CheckpointRejected) {
+    const std::string file = "test_checkpoint.ckp";
+    const std::string damaged = "test_checkpoint_damaged.ckp";
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    Model model(grid);
+    initialState(model);
+    model.advanceUntil(3*model.getDt(), [](double) {});
+    model.writeCheckpoint(file);
+    std::vector<char> bytes = readBytes(file);
+
+    // truncated in the header and in the fields
+    for (size_t size : { (size_t)16, bytes.size()/2, bytes.size()-1 })
+    {
+        writeBytes(damaged, std::vector<char>(bytes.begin(), bytes.begin()+size));
+        Model restarted(grid);
+        BOOST_CHECK_THROW(restarted.readCheckpoint(damaged), std::runtime_error);
+    }
+
+    // not a checkpoint
+    std::vector<char> garbage = bytes;
+    garbage[0] = 'X';
+    writeBytes(damaged, garbage);
+    Model restarted(grid);
+    BOOST_CHECK_THROW(restarted.readCheckpoint(damaged), std::runtime_error);
+
+    // another grid, precision or number of members
+    Model narrower(testGrid(PIFO_TEST_NX-1, 40));
+    BOOST_CHECK_THROW(narrower.readCheckpoint(file), std::runtime_error);
+    ModelT<SinglePrecision> single(grid);
+    BOOST_CHECK_THROW(single.readCheckpoint(file), std::runtime_error);
+    Model ensemble(grid, atlas::util::Config("members", 2));
+    BOOST_CHECK_THROW(ensemble.readCheckpoint(file), std::runtime_error);
+
+    std::remove(file.c_str());
+    std::remove(damaged.c_str());
+}
+
+namespace {
+    /**
+     * Global field of a grid, smooth but for the infinities, NaN, zeros,
+     * extreme and subnormal values of its first points.
+     */
+    atlas::Field globalField(const atlas::RegularGrid& grid, double time)
+    {
+        atlas::Field field("f", atlas::array::make_datatype<double>(), atlas::array::make_shape(grid.size()));
+        auto values = atlas::array::make_view<double, 1>(field);
+        for (atlas::idx_t j=0;j<grid.ny();j++)
+        {
+            for (atlas::idx_t i=0;i<grid.nx();i++)
+            {
+                values(j*grid.nx()+i) = 1000*std::sin(0.3*i+time)*std::cos(0.2*j)+0.001*i-1e-7*j+time;
+            }
+        }
+        const double specials[] = { INFINITY, -INFINITY, NAN, 0., -0., 1e300, -1e-300, 4.9e-324,
+            1.7976931348623157e308 };
+        for (size_t k=0;k<sizeof(specials)/sizeof(specials[0]);k++)
+        {
+            values(k) = specials[k];
+        }
+        return field;
+    }
+
+    /**
+     * Values of the points [i0, i0+ni) x [j0, j0+nj) of a global field, row
+     * after row.
+     */
+    std::vector<double> region(const atlas::RegularGrid& grid, const atlas::Field& field,
+        atlas::idx_t i0, atlas::idx_t j0, atlas::idx_t ni, atlas::idx_t nj)
+    {
+        auto values = atlas::array::make_view<double, 1>(field);
+        std::vector<double> result;
+        for (atlas::idx_t j=j0;j<j0+nj;j++)
+        {
+            for (atlas::idx_t i=i0;i<i0+ni;i++)
+            {
+                result.push_back(values(j*grid.nx()+i));
+            }
+        }
+        return result;
+    }
+
+    bool sameBits(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        return a.size()==b.size() && std::memcmp(a.data(), b.data(), a.size()*sizeof(double))==0;
+    }
+
+    atlas::Field filledField(const atlas::RegularGrid& grid, double value)
+    {
+        atlas::Field field("f", atlas::array::make_datatype<double>(), atlas::array::make_shape(grid.size()));
+        auto values = atlas::array::make_view<double, 1>(field);
+        for (atlas::idx_t k=0;k<grid.size();k++)
+        {
+            values(k) = value;
+        }
+        return field;
+    }
+
+    // chunks that don't divide the grid of the chunked store tests : the
+    // last column and row of chunks are partial
+    const atlas::idx_t storeNx = 37;
+    const atlas::idx_t storeNy = 23;
+
+    ChunkedFieldEncoding storeEncoding(int keepBits)
+    {
+        ChunkedFieldEncoding encoding;
+        encoding.chunkNx = 8;
+        encoding.chunkNy = 5;
+        encoding.keepBits = keepBits;
+        encoding.threads = 2;
+        return encoding;
+    }
+}
+
+// The lossless encoding gives back every bit of the values, of each record
+BOOST_AUTO_TEST_CASE(ChunkedFieldStoreLossless) {
+    const std::string file = "test_store.cfs";
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    {
+        ChunkedFieldWriter writer(file, grid, storeEncoding(0));
+        for (int t=0;t<3;t++)
+        {
+            writer.write(globalField(grid, t), 3600.*t);
+        }
+        BOOST_CHECK_EQUAL(writer.rawSize(), 3*grid.size()*sizeof(double));
+    }
+    ChunkedFieldReader reader(file);
+    BOOST_REQUIRE_EQUAL(reader.times(), 3);
+    atlas::Field read("f", atlas::array::make_datatype<double>(), atlas::array::make_shape(grid.size()));
+    for (int t=0;t<3;t++)
+    {
+        BOOST_CHECK_EQUAL(reader.time(t), 3600.*t);
+        reader.readField(t, grid, read);
+        BOOST_CHECK(sameBits(region(grid, read, 0, 0, storeNx, storeNy),
+            region(grid, globalField(grid, t), 0, 0, storeNx, storeNy)));
+    }
+
+    ChunkedFieldStore::writeField(file, grid, globalField(grid, 5), 5.);
+    ChunkedFieldStore::readField(file, grid, read);
+    BOOST_CHECK(sameBits(region(grid, read, 0, 0, storeNx, storeNy),
+        region(grid, globalField(grid, 5), 0, 0, storeNx, storeNy)));
+    std::remove(file.c_str());
+}
+
+// Values rounded to keepBits bits are within 2^-(keepBits+1) of the
+// originals, the largest finite value does not round up to infinity, and the
+// infinities and NaNs are unchanged
+BOOST_AUTO_TEST_CASE(ChunkedFieldStoreKeepBits) {
+    const std::string file = "test_store.cfs";
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    atlas::Field field = globalField(grid, 1);
+    std::vector<double> original = region(grid, field, 0, 0, storeNx, storeNy);
+    for (int keepBits : { 7, 23, 40 })
+    {
+        {
+            ChunkedFieldWriter writer(file, grid, storeEncoding(keepBits));
+            writer.write(field, 0);
+        }
+        ChunkedFieldReader reader(file);
+        BOOST_CHECK_EQUAL(reader.getHeader().keepBits, keepBits);
+        atlas::Field read("f", atlas::array::make_datatype<double>(), atlas::array::make_shape(grid.size()));
+        reader.readField(0, grid, read);
+        std::vector<double> rounded = region(grid, read, 0, 0, storeNx, storeNy);
+
+        double bound = std::ldexp(1., -(keepBits+1));
+        double maxError = 0;
+        for (size_t k=0;k<original.size();k++)
+        {
+            double x = original[k];
+            if (std::isnan(x) || std::isinf(x))
+            {
+                BOOST_CHECK(std::memcmp(&x, &rounded[k], sizeof(x))==0);
+            }
+            else if (x!=0 && std::fpclassify(x)!=FP_SUBNORMAL)
+            {
+                maxError = std::max(maxError, std::abs(rounded[k]-x)/std::abs(x));
+            }
+            else if (x==0)
+            {
+                BOOST_CHECK_EQUAL(rounded[k], 0.);
+            }
+        }
+        BOOST_CHECK_MESSAGE(maxError<=bound, keepBits << " bits : relative error " << maxError
+            << " above " << bound);
+        BOOST_CHECK(maxError>0);
+    }
+    std::remove(file.c_str());
+}
+
+// A region is read from the chunks it covers, across their edges and in
+// the partial chunks of the last column and row
+BOOST_AUTO_TEST_CASE(ChunkedFieldReadRegion) {
+    const std::string file = "test_store.cfs";
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    atlas::Field field = globalField(grid, 2);
+    {
+        ChunkedFieldWriter writer(file, grid, storeEncoding(0));
+        writer.write(globalField(grid, 1), 0);
+        writer.write(field, 60);
+    }
+    ChunkedFieldReader reader(file);
+    struct Region { atlas::idx_t i0, j0, ni, nj; };
+    for (const Region& r : std::vector<Region>{ { 0, 0, storeNx, storeNy }, { 6, 3, 13, 9 }, { 33, 21, 4, 2 },
+        { 30, 18, 7, 5 }, { 8, 5, 8, 5 }, { 17, 11, 1, 1 } })
+    {
+        std::vector<double> values(r.ni*r.nj);
+        reader.readRegion(1, r.i0, r.j0, r.ni, r.nj, values.data());
+        BOOST_CHECK_MESSAGE(sameBits(values, region(grid, field, r.i0, r.j0, r.ni, r.nj)),
+            "region (" << r.i0 << "," << r.j0 << ") " << r.ni << "x" << r.nj << " differs");
+    }
+    std::vector<double> values(4*4);
+    BOOST_CHECK_THROW(reader.readRegion(1, storeNx-3, 0, 4, 4, values.data()), std::runtime_error);
+    BOOST_CHECK_THROW(reader.readRegion(2, 0, 0, 4, 4, values.data()), std::runtime_error);
+    std::remove(file.c_str());
+}
+
+// The binary format gives back the doubles, or the values rounded to float
+// with float32, and rejects the files that are not a whole field of the grid
+BOOST_AUTO_TEST_CASE(BinaryFieldFormatRoundTrip) {
+    const std::string file = "test_field.fld";
+    const std::string damaged = "test_field_damaged.fld";
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    atlas::Field field = globalField(grid, 1);
+    std::vector<double> values = region(grid, field, 0, 0, storeNx, storeNy);
+    for (bool float32 : { false, true })
+    {
+        BinaryFieldFormat::writeField(file, grid, field, 3600., float32);
+        {
+            MappedFieldFile mapped(file);
+            BOOST_CHECK_EQUAL(mapped.header().time, 3600.);
+            BOOST_CHECK_EQUAL(mapped.header().elementSize, float32 ? sizeof(float) : sizeof(double));
+        }
+        atlas::Field read = filledField(grid, 0);
+        BinaryFieldFormat::readField(file, grid, read);
+        std::vector<double> expected = values;
+        if (float32)
+        {
+            std::transform(expected.begin(), expected.end(), expected.begin(), [](double x) { return (double)(float)x; });
+        }
+        BOOST_CHECK(sameBits(region(grid, read, 0, 0, storeNx, storeNy), expected));
+    }
+
+    BinaryFieldFormat::writeField(file, grid, field);
+    std::vector<char> bytes = readBytes(file);
+    atlas::Field read = filledField(grid, 0);
+    // truncated in the header and in the values
+    for (size_t size : { (size_t)50, bytes.size()/2, bytes.size()-1 })
+    {
+        writeBytes(damaged, std::vector<char>(bytes.begin(), bytes.begin()+size));
+        BOOST_CHECK_THROW(BinaryFieldFormat::readField(damaged, grid, read), std::runtime_error);
+    }
+    std::vector<char> garbage = bytes;
+    garbage[0] = 'X';
+    writeBytes(damaged, garbage);
+    BOOST_CHECK_THROW(BinaryFieldFormat::readField(damaged, grid, read), std::runtime_error);
+
+    // another size, or the same size on another domain
+    BOOST_CHECK_THROW(BinaryFieldFormat::readField(file, testGrid(storeNx+1, storeNy), read), std::runtime_error);
+    BOOST_CHECK_THROW(BinaryFieldFormat::readField(file, testGrid(storeNx, storeNy, 7.), read), std::runtime_error);
+    std::remove(file.c_str());
+    std::remove(damaged.c_str());
+}
+
+// The record that a killed run did not write to its end is skipped, the
+// previous ones are read
+BOOST_AUTO_TEST_CASE(ChunkedFieldTruncatedRecord) {
+    const std::string file = "test_store.cfs";
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    size_t twoRecords;
+    {
+        ChunkedFieldWriter writer(file, grid, storeEncoding(0));
+        writer.write(globalField(grid, 0), 0);
+        writer.write(globalField(grid, 1), 60);
+        twoRecords = writer.size();
+        writer.write(globalField(grid, 2), 120);
+    }
+    std::vector<char> bytes = readBytes(file);
+    // in the header of the record, in its table of chunks and in the chunks
+    for (size_t size : { twoRecords+8, twoRecords+sizeof(ChunkedFieldRecord)+4, bytes.size()-1 })
+    {
+        writeBytes(file, std::vector<char>(bytes.begin(), bytes.begin()+size));
+        ChunkedFieldReader reader(file);
+        BOOST_CHECK_EQUAL(reader.times(), 2);
+        atlas::Field read("f", atlas::array::make_datatype<double>(), atlas::array::make_shape(grid.size()));
+        reader.readField(1, grid, read);
+        BOOST_CHECK(sameBits(region(grid, read, 0, 0, storeNx, storeNy),
+            region(grid, globalField(grid, 1), 0, 0, storeNx, storeNy)));
+    }
+    std::remove(file.c_str());
+}
+
+namespace {
+    /**
+     * Text of a wgrib file of grid with the values, separated by runs of
+     * spaces, tabs and line ends of varying length.
+     */
+    std::string wgribText(const atlas::RegularGrid& grid, const std::vector<std::string>& values)
+    {
+        const char* separators[] = { "\n", " ", "\t", "\r\n", "  \n\n", "\n \t" };
+        std::string text = std::to_string(grid.nx())+" "+std::to_string(grid.ny())+"\n";
+        for (size_t k=0;k<values.size();k++)
+        {
+            text += values[k]+separators[k%6];
+        }
+        return text;
+    }
+
+    void writeText(const std::string& file, const std::string& text)
+    {
+        writeBytes(file, std::vector<char>(text.begin(), text.end()));
+    }
+}
+
+// writeField writes the same characters as the streams, "nx ny" then each
+// value with std::endl, whatever the number of threads formatting them
+BOOST_AUTO_TEST_CASE(WGribWriteFieldAsStreams) {
+    const std::string file = "test_field.wgrib";
+    int maxThreads = atlas_omp_get_max_threads();
+    // more values than a thread formats in one block
+    atlas::RegularGrid grid = testGrid(300, 250);
+    atlas::Field field = globalField(grid, 1);
+    auto values = atlas::array::make_view<double, 1>(field);
+    std::ostringstream expected;
+    expected << grid.nx() << " " << grid.ny() << "\n";
+    for (atlas::idx_t k=0;k<grid.size();k++)
+    {
+        expected << values(k) << std::endl;
+    }
+    for (int threads : { 1, 3 })
+    {
+        atlas_omp_set_num_threads(threads);
+        WGribFormat::writeField(file, grid, field);
+        std::vector<char> bytes = readBytes(file);
+        BOOST_CHECK_MESSAGE(std::string(bytes.begin(), bytes.end())==expected.str(),
+            threads << " threads : the file differs from the streams");
+    }
+    atlas_omp_set_num_threads(maxThreads);
+    std::remove(file.c_str());
+}
+
+// The values are read whatever the number of threads, the chunks of the
+// text then starting and ending in the middle of numbers
+BOOST_AUTO_TEST_CASE(WGribReadChunkBoundaries) {
+    const std::string file = "test_field.wgrib";
+    int maxThreads = atlas_omp_get_max_threads();
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    std::vector<std::string> text;
+    std::vector<double> expected;
+    for (atlas::idx_t k=0;k<grid.size();k++)
+    {
+        std::ostringstream value;
+        value.precision(1+k%17);
+        value << (k%10==0 ? "+" : "") << (k%2 ? -1. : 1.)*std::abs(std::sin(0.1*k))*std::pow(10., k%41-20);
+        text.push_back(value.str());
+        expected.push_back(std::strtod(text.back().c_str(), nullptr));
+    }
+    writeText(file, wgribText(grid, text));
+    for (int threads=1;threads<=8;threads++)
+    {
+        atlas_omp_set_num_threads(threads);
+        atlas::Field read = filledField(grid, 0);
+        WGribFormat::readField(file, grid, read);
+        BOOST_CHECK_MESSAGE(sameBits(region(grid, read, 0, 0, storeNx, storeNy), expected),
+            threads << " threads : the values differ");
+    }
+    atlas_omp_set_num_threads(maxThreads);
+    std::remove(file.c_str());
+}
+
+// As the streams, readField parses the subnormals, leaves the values
+// missing at the end of the file unchanged, and fails on what is not a
+// number or on another grid
+BOOST_AUTO_TEST_CASE(WGribReadValues) {
+    const std::string file = "test_field.wgrib";
+    int maxThreads = atlas_omp_get_max_threads();
+    atlas_omp_set_num_threads(3);
+    atlas::RegularGrid grid = testGrid(storeNx, storeNy);
+    std::vector<std::string> text(grid.size(), "1.5");
+    text[0] = "4.94066e-324";
+    text[1] = "-2.2250738585072009e-309";
+    text[2] = "1e-310";
+    text[3] = "inf";
+    text[4] = "-inf";
+    writeText(file, wgribText(grid, text));
+    atlas::Field read = filledField(grid, 0);
+    WGribFormat::readField(file, grid, read);
+    auto values = atlas::array::make_view<double, 1>(read);
+    for (int k=0;k<3;k++)
+    {
+        BOOST_CHECK_EQUAL(std::fpclassify(values(k)), FP_SUBNORMAL);
+        BOOST_CHECK_EQUAL(values(k), std::strtod(text[k].c_str(), nullptr));
+    }
+    BOOST_CHECK_EQUAL(values(3), INFINITY);
+    BOOST_CHECK_EQUAL(values(4), -INFINITY);
+    BOOST_CHECK_EQUAL(values(grid.size()-1), 1.5);
+
+    // the values after the 100 first ones are missing
+    writeText(file, wgribText(grid, std::vector<std::string>(100, "2.5")));
+    read = filledField(grid, 42);
+    WGribFormat::readField(file, grid, read);
+    values = atlas::array::make_view<double, 1>(read);
+    std::vector<double> expected(grid.size(), 42);
+    std::fill(expected.begin(), expected.begin()+100, 2.5);
+    BOOST_CHECK(sameBits(region(grid, read, 0, 0, storeNx, storeNy), expected));
+
+    for (const char* value : { "abc", "1.5x", "--1", "+-1", "+", "1,5", "e5" })
+    {
+        text = std::vector<std::string>(grid.size(), "1.5");
+        text[grid.size()/2] = value;
+        writeText(file, wgribText(grid, text));
+        BOOST_CHECK_THROW(WGribFormat::readField(file, grid, read), std::runtime_error);
+    }
+    writeText(file, wgribText(testGrid(storeNx+1, storeNy), text));
+    BOOST_CHECK_THROW(WGribFormat::readField(file, grid, read), std::runtime_error);
+    BOOST_CHECK_THROW(WGribFormat::readField("test_missing.wgrib", grid, read), std::runtime_error);
+    atlas_omp_set_num_threads(maxThreads);
+    std::remove(file.c_str());
+}
+
+// The background writer writes the same bytes as writeDistributedField, in
+// each format
+BOOST_AUTO_TEST_CASE(AsyncOutputWriterAsSynchronous) {
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    Model model(grid);
+    initialState(model);
+    model.advance(2);
+    const atlas::Field& U = model.pronosticFieldSet().field("U");
+    for (const char* extension : { ".fld", ".txt", ".cfs" })
+    {
+        for (bool float32 : { false, true })
+        {
+            std::string async = std::string("test_async")+extension;
+            std::string sync = std::string("test_sync")+extension;
+            {
+                app::AsyncOutputWriter writer(grid, model.getFunctionSpace(), 1<<30, float32);
+                writer.write(async, U, model.getTime());
+                writer.flush();
+            }
+            app::writeDistributedField(sync, grid, model.getFunctionSpace(), U, model.getTime(), float32);
+            // the chunked files of the writer take its encoding, not float32
+            if (std::string(extension)!=".cfs" || !float32)
+            {
+                BOOST_CHECK_MESSAGE(readBytes(async)==readBytes(sync), extension << " (float32=" << float32
+                    << ") differs from writeDistributedField");
+            }
+            std::remove(async.c_str());
+            std::remove(sync.c_str());
+        }
+    }
+}
+
+// The fields waiting to be written take at most maxBytes, or a single field
+// larger than the bound, and they are all written
+BOOST_AUTO_TEST_CASE(AsyncOutputWriterBackPressure) {
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    Model model(grid);
+    initialState(model);
+    const atlas::Field& phi = model.pronosticFieldSet().field("phi");
+    const size_t fieldBytes = grid.size()*sizeof(double);
+    const int fields = 6;
+    for (size_t maxBytes : { (size_t)1, fieldBytes*5/2 })
+    {
+        {
+            app::AsyncOutputWriter writer(grid, model.getFunctionSpace(), maxBytes);
+            for (int k=0;k<fields;k++)
+            {
+                writer.write("test_async_"+std::to_string(k)+".fld", phi, k);
+            }
+            writer.flush();
+            BOOST_CHECK(writer.getPeakBytes()>=fieldBytes);
+            BOOST_CHECK_MESSAGE(writer.getPeakBytes()<=std::max(maxBytes, fieldBytes), "peak of "
+                << writer.getPeakBytes() << " bytes above the bound of " << maxBytes);
+        }
+        for (int k=0;k<fields;k++)
+        {
+            std::string file = "test_async_"+std::to_string(k)+".fld";
+            MappedFieldFile mapped(file);
+            BOOST_CHECK_EQUAL(mapped.header().time, k);
+            std::remove(file.c_str());
+        }
+    }
+}
+
+// An error of the writer thread is thrown by the next write() or flush(),
+// once, and the writer goes on with the next fields
+BOOST_AUTO_TEST_CASE(AsyncOutputWriterError) {
+    atlas::RegularGrid grid = testGrid(PIFO_TEST_NX, 40);
+    Model model(grid);
+    initialState(model);
+    const atlas::Field& V = model.pronosticFieldSet().field("V");
+    const std::string missing = "test_missing_directory/V.fld";
+    const std::string file = "test_async_V.fld";
+
+    app::AsyncOutputWriter writer(grid, model.getFunctionSpace(), 1<<30);
+    writer.write(missing, V, 0);
+    BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+    writer.write(file, V, 0);
+    BOOST_CHECK_NO_THROW(writer.flush());
+    BOOST_CHECK(!readBytes(file).empty());
+
+    // with a bound of one byte, the next write waits for the failed field
+    app::AsyncOutputWriter bounded(grid, model.getFunctionSpace(), 1);
+    bounded.write(missing, V, 0);
+    BOOST_CHECK_THROW(bounded.write(file, V, 0), std::runtime_error);
+    BOOST_CHECK_NO_THROW(bounded.flush());
+    std::remove(file.c_str());
 }